@@ -18,7 +18,10 @@
 #include "duplicate_set.h"
 #include "log.h"
 #include "gateway_default_handler.h"
+#include "gateway_bandwidth_handler.h"
 #include "gateway.h"
+#include "tc_set.h"
+#include "lq_plugin.h"
 
 #include <assert.h>
 #include <net/if.h>
@@ -34,6 +37,12 @@ static struct olsr_gw_handler *gw_handler;
 static struct olsr_iptunnel_entry *v4gw_tunnel, *v6gw_tunnel;
 static bool v4gw_choosen_external, v6gw_choosen_external;
 
+/* gateways of each family ordered by path cost */
+static struct avl_tree gw_cost_tree[GW_FAMILY_COUNT];
+
+/* switch to a better gateway if it is cheaper by this percentage, 0 = never */
+static unsigned int gw_hysteresis = 0;
+
 /**
  * Reconstructs an uplink/downlink speed value from the encoded
  * 1 byte transport value (3 bit mantissa, 5 bit exponent)
@@ -73,6 +82,94 @@ serialize_gw_speed(uint32_t speed) {
   return ((speed-1) << 3) | exp;
 }
 
+/**
+ * compare two path costs for the gateway cost index
+ * @param cost1
+ * @param cost2
+ * @return -1, 0 or +1
+ */
+static int
+avl_comp_gw_cost(const void *cost1, const void *cost2)
+{
+  if (*(const olsr_linkcost *)cost1 < *(const olsr_linkcost *)cost2) {
+    return -1;
+  }
+  if (*(const olsr_linkcost *)cost1 > *(const olsr_linkcost *)cost2) {
+    return +1;
+  }
+  return 0;
+}
+
+static struct gateway_entry *
+cost_node2gateway(struct avl_node *node, enum gateway_family family)
+{
+  return (struct gateway_entry *)((char *)(node - family) - offsetof(struct gateway_entry, cost_node));
+}
+
+/**
+ * @param gw gateway entry
+ * @return path cost to the gateway according to the last SPF run
+ */
+static olsr_linkcost
+gw_lookup_path_cost(struct gateway_entry *gw)
+{
+  struct tc_entry *tc = olsr_lookup_tc_entry(&gw->originator);
+
+  return tc == NULL ? ROUTE_COST_BROKEN : tc->path_cost;
+}
+
+/**
+ * Remove a gateway from all path cost indexes
+ * @param gw gateway entry
+ */
+static void
+gw_index_remove(struct gateway_entry *gw)
+{
+  int i;
+
+  for (i = 0; i < GW_FAMILY_COUNT; i++) {
+    if (gw->cost_indexed & (1 << i)) {
+      avl_delete(&gw_cost_tree[i], &gw->cost_node[i]);
+    }
+  }
+  gw->cost_indexed = 0;
+}
+
+/**
+ * (Re)insert a gateway into the path cost indexes of the families
+ * it currently announces
+ * @param gw gateway entry
+ * @param cost new path cost of the gateway
+ */
+static void
+gw_index_update(struct gateway_entry *gw, olsr_linkcost cost)
+{
+  uint8_t families = 0;
+  int i;
+
+  if (gw->ipv4) {
+    families |= 1 << (gw->ipv4nat ? GW_FAMILY_IPV4NAT : GW_FAMILY_IPV4);
+  }
+  if (gw->ipv6) {
+    families |= 1 << GW_FAMILY_IPV6;
+  }
+
+  if (families == gw->cost_indexed && cost == gw->path_cost) {
+    return;
+  }
+
+  gw_index_remove(gw);
+  gw->path_cost = cost;
+
+  for (i = 0; i < GW_FAMILY_COUNT; i++) {
+    if (families & (1 << i)) {
+      gw->cost_node[i].key = &gw->path_cost;
+      avl_insert(&gw_cost_tree[i], &gw->cost_node[i], AVL_DUP);
+    }
+  }
+  gw->cost_indexed = families;
+}
+
 /**
  * Callback for tunnel interface monitoring which will set the route into the tunnel
  * when the interface comes up again.
@@ -103,10 +200,15 @@ static void smartgw_tunnel_monitor (int if_index,
  */
 int
 olsr_init_gateways(void) {
+  int i;
+
   gw_mem_cookie = olsr_alloc_cookie("Gateway cookie", OLSR_COOKIE_TYPE_MEMORY);
   olsr_cookie_set_memory_size(gw_mem_cookie, sizeof(struct gateway_entry));
 
   avl_init(&gateway_tree, avl_comp_default);
+  for (i = 0; i < GW_FAMILY_COUNT; i++) {
+    avl_init(&gw_cost_tree[i], avl_comp_gw_cost);
+  }
   current_ipv4_gw = NULL;
   current_ipv6_gw = NULL;
 
@@ -126,6 +228,7 @@ olsr_init_gateways(void) {
    * can be overwritten with olsr_set_inetgw_handler
    */
   olsr_gw_default_init();
+  olsr_gw_bandwidth_init();
   return 0;
 }
 
@@ -188,29 +291,70 @@ olsr_trigger_inetgw_selection(bool ipv4, bool ipv6) {
   return ((ipv4 && current_ipv4_gw == NULL) || (ipv6 && current_ipv6_gw == NULL)) ? -1 : 0;
 }
 
+/**
+ * Checks if a gateway should be replaced, either because it was
+ * lost or because the gateway handler wants to switch to a better one.
+ * @param gw current gateway
+ * @param family gateway family the gateway was chosen from
+ * @param external true if the gateway was set by the user
+ * @return true if a new gateway should be selected
+ */
+static bool
+gw_needs_reselection(struct gateway_entry *gw, enum gateway_family family, bool external) {
+  if (gw->path_cost == ROUTE_COST_BROKEN) {
+    return true;
+  }
+  if (gw_hysteresis == 0 || external) {
+    return false;
+  }
+  return gw_handler->needs_switch != NULL && gw_handler->needs_switch(gw, family);
+}
+
 /**
  * Triggers a check if the one of the gateways have been lost
- * through ETX = infinity
+ * through ETX = infinity, or if the gateway handler wants to
+ * switch to a better one.
  */
 void olsr_trigger_gatewayloss_check(void) {
-  struct tc_entry *tc;
   bool ipv4 = false, ipv6 = false;
   if (current_ipv4_gw) {
-    tc = olsr_lookup_tc_entry(&current_ipv4_gw->originator);
-    if (tc == NULL || tc->path_cost == ROUTE_COST_BROKEN) {
-      ipv4 = true;
-    }
+    ipv4 = gw_needs_reselection(current_ipv4_gw, olsr_get_ipv4_gateway_family(), v4gw_choosen_external);
   }
   if (current_ipv6_gw) {
-    tc = olsr_lookup_tc_entry(&current_ipv6_gw->originator);
-    if (tc == NULL || tc->path_cost == ROUTE_COST_BROKEN) {
-      ipv6 = true;
-    }
+    ipv6 = gw_needs_reselection(current_ipv6_gw, GW_FAMILY_IPV6, v6gw_choosen_external);
   }
   if (ipv4 || ipv6) {
     olsr_trigger_inetgw_selection(ipv4, ipv6);
   }
 }
+
+/**
+ * Refresh the path cost index of all gateways, must be called
+ * after each SPF run.
+ */
+void olsr_update_gateway_costs(void) {
+  struct gateway_entry *gw;
+
+  OLSR_FOR_ALL_GATEWAY_ENTRIES(gw) {
+    gw_index_update(gw, gw_lookup_path_cost(gw));
+  } OLSR_FOR_ALL_GATEWAY_ENTRIES_END(gw)
+}
+
+/**
+ * Set the hysteresis for switching to a cheaper gateway.
+ * @param percent a new gateway must be cheaper than the current one
+ *   by this percentage of its path cost, 0 disables switching
+ */
+void olsr_set_gateway_hysteresis(unsigned int percent) {
+  gw_hysteresis = percent;
+}
+
+/**
+ * @return hysteresis for switching to a cheaper gateway in percent
+ */
+unsigned int olsr_get_gateway_hysteresis(void) {
+  return gw_hysteresis;
+}
 /**
  * Set a new gateway handler. Do only call this once during startup from
  * a plugin to overwrite the default handler.
@@ -319,6 +463,45 @@ struct gateway_entry *olsr_get_ipv6_inet_gateway(bool *ext) {
   return current_ipv6_gw;
 }
 
+/**
+ * @return the family IPv4 gateways are selected from
+ */
+enum gateway_family olsr_get_ipv4_gateway_family(void) {
+  return olsr_cnf->smart_gw_allow_nat ? GW_FAMILY_IPV4NAT : GW_FAMILY_IPV4;
+}
+
+/**
+ * @param family gateway family
+ * @return reachable gateway with the lowest path cost of the family
+ *   according to the last SPF run, NULL if there is none
+ */
+struct gateway_entry *
+olsr_get_best_gateway(enum gateway_family family) {
+  struct avl_node *node = avl_walk_first(&gw_cost_tree[family]);
+  struct gateway_entry *gw;
+
+  if (node == NULL) {
+    return NULL;
+  }
+  gw = cost_node2gateway(node, family);
+  return gw->path_cost == ROUTE_COST_BROKEN ? NULL : gw;
+}
+
+/**
+ * Walk the gateways of a family in order of their path cost,
+ * unreachable gateways come last.
+ * @param gw previous gateway, NULL to get the cheapest one
+ * @param family gateway family
+ * @return next gateway of the family, NULL if there is none
+ */
+struct gateway_entry *
+olsr_get_next_gateway(struct gateway_entry *gw, enum gateway_family family) {
+  struct avl_node *node;
+
+  node = gw == NULL ? avl_walk_first(&gw_cost_tree[family]) : avl_walk_next(&gw->cost_node[family]);
+  return node == NULL ? NULL : cost_node2gateway(node, family);
+}
+
 /**
  * @param originator
  * @return gateway_entry for corresponding router
@@ -395,6 +578,8 @@ olsr_update_gateway_entry(union olsr_ip_addr *originator, union olsr_ip_addr *ma
     gw->cleanup_timer = NULL;
   }
 
+  gw_index_update(gw, gw_lookup_path_cost(gw));
+
   /* call update handler */
   gw_handler->handle_update_gw(gw);
 }
@@ -407,6 +592,7 @@ static void cleanup_gateway_handler(void *ptr) {
   }
 
   /* remove gateway entry */
+  gw_index_remove(gw);
   avl_delete(&gateway_tree, &gw->node);
   olsr_cookie_free(gw_mem_cookie, gw);
 }
@@ -444,6 +630,7 @@ olsr_delete_gateway_entry(union olsr_ip_addr *originator, uint8_t prefixlen) {
       gw->ipv4 = false;
       gw->ipv4nat = false;
       gw->ipv6 = false;
+      gw_index_remove(gw);
 
       /* handle gateway loss */
       gw_handler->handle_delete_gw(gw);
@@ -468,6 +655,7 @@ olsr_delete_gateway_entry(union olsr_ip_addr *originator, uint8_t prefixlen) {
       olsr_set_timer(&gw->cleanup_timer, GW_CLEANUP_INTERVAL, 0, false, cleanup_gateway_handler, gw, NULL);
     }
     else if (change) {
+      gw_index_update(gw, gw->path_cost);
       gw_handler->handle_update_gw(gw);
     }
   }
@@ -523,22 +711,24 @@ void
 olsr_print_gateway_entries(void) {
 #ifndef NODEBUG
   struct ipaddr_str buf;
+  struct lqtextbuffer lqbuf;
   struct gateway_entry *gw;
   const int addrsize = olsr_cnf->ip_version == AF_INET ? 15 : 39;
 
   OLSR_PRINTF(0, "\n--- %s ---------------------------------------------------- GATEWAYS\n\n",
       olsr_wallclock_string());
-  OLSR_PRINTF(0, "%-*s %-6s %-9s %-9s %s\n", addrsize, "IP address", "Type", "Uplink", "Downlink",
+  OLSR_PRINTF(0, "%-*s %-6s %-9s %-9s %-8s %s\n", addrsize, "IP address", "Type", "Uplink", "Downlink", "Cost",
       olsr_cnf->ip_version == AF_INET ? "" : "External Prefix");
 
   OLSR_FOR_ALL_GATEWAY_ENTRIES(gw) {
-    OLSR_PRINTF(0, "%-*s %s%c%s%c%c %-9u %-9u %s\n", addrsize, olsr_ip_to_string(&buf, &gw->originator),
+    OLSR_PRINTF(0, "%-*s %s%c%s%c%c %-9u %-9u %-8s %s\n", addrsize, olsr_ip_to_string(&buf, &gw->originator),
         gw->ipv4nat ? "" : "   ",
         gw->ipv4 ? '4' : ' ',
         gw->ipv4nat ? "(N)" : "",
         (gw->ipv4 && gw->ipv6) ? ',' : ' ',
         gw->ipv6 ? '6' : ' ',
         gw->uplink, gw->downlink,
+        get_linkcost_text(gw->path_cost, true, &lqbuf),
         gw->external_prefix.prefix_len == 0 ? "" : olsr_ip_prefix_to_string(&gw->external_prefix));
   } OLSR_FOR_ALL_GATEWAY_ENTRIES_END(gw)
 #endif
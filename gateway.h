@@ -41,8 +41,17 @@ enum gateway_hna_fields {
   GW_HNA_V6PREFIX    = 5
 };
 
+/* gateway families with their own path cost index */
+enum gateway_family {
+  GW_FAMILY_IPV4     = 0,
+  GW_FAMILY_IPV4NAT  = 1,
+  GW_FAMILY_IPV6     = 2,
+  GW_FAMILY_COUNT    = 3
+};
+
 struct gateway_entry {
   struct avl_node node;
+  struct avl_node cost_node[GW_FAMILY_COUNT];
   union olsr_ip_addr originator;
   struct olsr_ip_prefix external_prefix;
   uint32_t uplink, downlink;
@@ -50,6 +59,9 @@ struct gateway_entry {
 
   struct timer_entry *cleanup_timer;
   uint16_t seqno;
+
+  olsr_linkcost path_cost;             /* tc->path_cost of the last SPF run */
+  uint8_t cost_indexed;                /* bitmask of gateway_family indexes */
 };
 
 AVLNODE2STRUCT(node2gateway, struct gateway_entry, node);
@@ -71,6 +83,9 @@ void refresh_smartgw_netmask(void);
 void olsr_trigger_inetgw_startup(void);
 int olsr_trigger_inetgw_selection(bool ipv4, bool ipv6);
 void olsr_trigger_gatewayloss_check(void);
+void olsr_update_gateway_costs(void);
+void olsr_set_gateway_hysteresis(unsigned int percent);
+unsigned int olsr_get_gateway_hysteresis(void);
 
 struct gateway_entry *olsr_find_gateway_entry(union olsr_ip_addr *originator);
 void olsr_update_gateway_entry(union olsr_ip_addr *originator, union olsr_ip_addr *mask, int prefixlen, uint16_t seqno);
@@ -80,6 +95,9 @@ void olsr_print_gateway_entries(void);
 bool olsr_set_inet_gateway(union olsr_ip_addr *originator, bool ipv4, bool ipv6, bool external);
 struct gateway_entry *olsr_get_ipv4_inet_gateway(bool *);
 struct gateway_entry *olsr_get_ipv6_inet_gateway(bool *);
+enum gateway_family olsr_get_ipv4_gateway_family(void);
+struct gateway_entry *olsr_get_best_gateway(enum gateway_family family);
+struct gateway_entry *olsr_get_next_gateway(struct gateway_entry *gw, enum gateway_family family);
 bool olsr_is_smart_gateway(struct olsr_ip_prefix *prefix, union olsr_ip_addr *net);
 void olsr_modifiy_inetgw_netmask(union olsr_ip_addr *mask, int prefixlen);
 
@@ -88,6 +106,7 @@ struct olsr_gw_handler {
   void (* select_gateway) (bool ipv4, bool ipv6);
   void (* handle_update_gw)(struct gateway_entry *);
   void (* handle_delete_gw)(struct gateway_entry *);
+  bool (* needs_switch)(struct gateway_entry *, enum gateway_family);
 };
 
 void olsr_set_inetgw_handler(struct olsr_gw_handler *l);
@@ -0,0 +1,299 @@
+/*
+ * gateway_bandwidth_handler.c
+ *
+ * Gateway handler scoring gateways by path cost and advertised uplink
+ */
+
+#include "defs.h"
+#include "gateway.h"
+#include "gateway_bandwidth_handler.h"
+#include "scheduler.h"
+#include "log.h"
+#include "lq_plugin.h"
+
+#ifdef LINUX_NETLINK_ROUTING
+/* path cost added for an uplink of GW_BANDWIDTH_REFERENCE kbit/s, 0 = handler not used */
+static unsigned int gw_bw_weight = 0;
+
+/* percentage a gateway must be better to replace the current one */
+static unsigned int gw_bw_damping = 0;
+
+static struct timer_entry *gw_bw_timer;
+
+/* gateway which has been better than the current one for gw_bw_rounds */
+static struct gateway_entry *gw_bw_candidate_ipv4, *gw_bw_candidate_ipv6;
+static unsigned int gw_bw_rounds_ipv4, gw_bw_rounds_ipv6;
+
+static void gw_bandwidth_startup_handler(void);
+static void gw_bandwidth_choosegw_handler(bool ipv4, bool ipv6);
+static void gw_bandwidth_update_handler(struct gateway_entry *);
+static void gw_bandwidth_delete_handler(struct gateway_entry *);
+static bool gw_bandwidth_needs_switch(struct gateway_entry *, enum gateway_family);
+
+static struct olsr_gw_handler gw_bw_handler = {
+  &gw_bandwidth_startup_handler,
+  &gw_bandwidth_choosegw_handler,
+  &gw_bandwidth_update_handler,
+  &gw_bandwidth_delete_handler,
+  &gw_bandwidth_needs_switch
+};
+
+/**
+ * Score of a gateway, lower is better. The path cost is increased
+ * inversely proportional to the advertised uplink.
+ *
+ * @param gw gateway entry
+ * @return score
+ */
+static uint64_t
+gw_bandwidth_score(struct gateway_entry *gw) {
+  uint32_t uplink = gw->uplink > 0 ? gw->uplink : 1;
+
+  return (uint64_t)gw->path_cost + (uint64_t)gw_bw_weight * GW_BANDWIDTH_REFERENCE / uplink;
+}
+
+/**
+ * @param gw gateway entry
+ * @param family gateway family
+ * @return true if the gateway is reachable and announces the family
+ */
+static bool
+gw_bandwidth_usable(struct gateway_entry *gw, enum gateway_family family) {
+  if (gw->path_cost == ROUTE_COST_BROKEN) {
+    return false;
+  }
+  if (family == GW_FAMILY_IPV6) {
+    return gw->ipv6;
+  }
+  return gw->ipv4 && gw->ipv4nat == (family == GW_FAMILY_IPV4NAT);
+}
+
+/**
+ * Walks the path cost index of the family. The path cost is a lower
+ * bound of the score, so the walk stops at the first gateway whose
+ * path cost alone is no better than the best score found.
+ *
+ * @param family gateway family
+ * @return usable gateway of the family with the lowest score, NULL if none
+ */
+static struct gateway_entry *
+gw_bandwidth_best(enum gateway_family family) {
+  struct gateway_entry *gw, *best = NULL;
+  uint64_t score, best_score = 0;
+
+  for (gw = olsr_get_next_gateway(NULL, family); gw != NULL; gw = olsr_get_next_gateway(gw, family)) {
+    if (gw->path_cost == ROUTE_COST_BROKEN || (best != NULL && gw->path_cost >= best_score)) {
+      break;
+    }
+    score = gw_bandwidth_score(gw);
+    if (best == NULL || score < best_score) {
+      best = gw;
+      best_score = score;
+    }
+  }
+  return best;
+}
+
+/**
+ * Check if the best gateway of a family should replace the current one.
+ * A lost gateway is replaced right away. Otherwise the best gateway must
+ * beat the current one by the damping percentage (or the -gwhyst
+ * hysteresis, if larger) for GW_BANDWIDTH_DAMPING_ROUNDS periodic
+ * evaluations in a row, and a gateway set by the user is never replaced.
+ * Selections triggered by SPF runs or HNA updates only replace a lost
+ * gateway, they do not count as an evaluation.
+ *
+ * @param current current gateway, NULL if none
+ * @param external true if the current gateway was set by the user
+ * @param best best gateway of the family
+ * @param family gateway family
+ * @param candidate pointer to the candidate of the family
+ * @param rounds pointer to the number of rounds the candidate won
+ * @param periodic true if called by the periodic evaluation
+ * @return true if the gateway should be switched
+ */
+static bool
+gw_bandwidth_damped_switch(struct gateway_entry *current, bool external, struct gateway_entry *best,
+    enum gateway_family family, struct gateway_entry **candidate, unsigned int *rounds, bool periodic) {
+  unsigned int damping = gw_bw_damping;
+
+  if (best == NULL || best == current) {
+    *candidate = NULL;
+    return false;
+  }
+  if (current == NULL || !gw_bandwidth_usable(current, family)) {
+    *candidate = NULL;
+    return true;
+  }
+  if (external) {
+    *candidate = NULL;
+    return false;
+  }
+  if (!periodic) {
+    return false;
+  }
+
+  if (olsr_get_gateway_hysteresis() > damping) {
+    damping = olsr_get_gateway_hysteresis();
+  }
+  if (gw_bandwidth_score(best) * (100 + damping) >= gw_bandwidth_score(current) * 100) {
+    *candidate = NULL;
+    return false;
+  }
+
+  if (*candidate != best) {
+    *candidate = best;
+    *rounds = 0;
+  }
+  if (++*rounds < GW_BANDWIDTH_DAMPING_ROUNDS) {
+    return false;
+  }
+  *candidate = NULL;
+  return true;
+}
+
+/**
+ * Select new gateways for the given families
+ *
+ * @param ipv4 select a new ipv4 gateway
+ * @param ipv6 select a new ipv6 gateway
+ * @param damped only switch if the damping rules allow it
+ * @param periodic true if called by the periodic evaluation
+ */
+static void
+gw_bandwidth_choose_gateway(bool ipv4, bool ipv6, bool damped, bool periodic) {
+  struct gateway_entry *inet_ipv4 = NULL, *inet_ipv6 = NULL;
+  bool ext;
+
+  /* get new ipv4 GW if we use OLSRv4 or NIIT and are no gateway ourself */
+  ipv4 &= (olsr_cnf->ip_version == AF_INET || olsr_cnf->use_niit) && !olsr_cnf->has_ipv4_gateway;
+  ipv6 &= olsr_cnf->ip_version == AF_INET6 && !olsr_cnf->has_ipv6_gateway;
+
+  if (ipv4) {
+    enum gateway_family family = olsr_get_ipv4_gateway_family();
+
+    inet_ipv4 = gw_bandwidth_best(family);
+    if (damped) {
+      struct gateway_entry *current = olsr_get_ipv4_inet_gateway(&ext);
+
+      if (!gw_bandwidth_damped_switch(current, ext, inet_ipv4, family, &gw_bw_candidate_ipv4, &gw_bw_rounds_ipv4,
+          periodic)) {
+        inet_ipv4 = NULL;
+      }
+    }
+  }
+  if (ipv6) {
+    inet_ipv6 = gw_bandwidth_best(GW_FAMILY_IPV6);
+    if (damped) {
+      struct gateway_entry *current = olsr_get_ipv6_inet_gateway(&ext);
+
+      if (!gw_bandwidth_damped_switch(current, ext, inet_ipv6, GW_FAMILY_IPV6, &gw_bw_candidate_ipv6,
+          &gw_bw_rounds_ipv6, periodic)) {
+        inet_ipv6 = NULL;
+      }
+    }
+  }
+
+  if (inet_ipv4 && inet_ipv4 == inet_ipv6) {
+    olsr_set_inet_gateway(&inet_ipv4->originator, true, true, false);
+    return;
+  }
+  if (inet_ipv4) {
+    olsr_set_inet_gateway(&inet_ipv4->originator, true, false, false);
+  }
+  if (inet_ipv6) {
+    olsr_set_inet_gateway(&inet_ipv6->originator, false, true, false);
+  }
+}
+
+/* timer for periodic gateway re-evaluation */
+static void gw_bandwidth_timer(void *unused __attribute__ ((unused))) {
+  gw_bandwidth_choose_gateway(true, true, true, true);
+}
+
+/* gateway handler callbacks */
+static void gw_bandwidth_startup_handler(void) {
+  gw_bw_candidate_ipv4 = NULL;
+  gw_bw_candidate_ipv6 = NULL;
+
+  olsr_set_timer(&gw_bw_timer, GW_BANDWIDTH_TIMER_INTERVAL, 0, true, &gw_bandwidth_timer, NULL, 0);
+}
+
+static void gw_bandwidth_update_handler(struct gateway_entry *gw) {
+  bool v4changed, v6changed;
+
+  v4changed = (gw == olsr_get_ipv4_inet_gateway(NULL))
+      && (!gw->ipv4 || (gw->ipv4nat && !olsr_cnf->smart_gw_allow_nat));
+  v6changed = (gw == olsr_get_ipv6_inet_gateway(NULL)) && !gw->ipv6;
+
+  if (v4changed || v6changed) {
+    gw_bandwidth_choose_gateway(v4changed, v6changed, olsr_get_gateway_hysteresis() > 0, false);
+  }
+}
+
+static void gw_bandwidth_delete_handler(struct gateway_entry *gw) {
+  bool isv4, isv6;
+
+  if (gw == gw_bw_candidate_ipv4) {
+    gw_bw_candidate_ipv4 = NULL;
+  }
+  if (gw == gw_bw_candidate_ipv6) {
+    gw_bw_candidate_ipv6 = NULL;
+  }
+
+  isv4 = gw == olsr_get_ipv4_inet_gateway(NULL);
+  isv6 = gw == olsr_get_ipv6_inet_gateway(NULL);
+
+  if (gw != NULL && (isv4 || isv6)) {
+    gw_bandwidth_choose_gateway(isv4, isv6, olsr_get_gateway_hysteresis() > 0, false);
+  }
+}
+
+/*
+ * Switching to a better scoring gateway is left to the damped periodic
+ * evaluation, an SPF run never warrants it. Lost gateways are replaced
+ * by the gateway code anyway.
+ */
+static bool gw_bandwidth_needs_switch(struct gateway_entry *gw __attribute__ ((unused)),
+    enum gateway_family family __attribute__ ((unused))) {
+  return false;
+}
+
+/* with -gwhyst the selections triggered after each SPF only replace a lost gateway */
+static void gw_bandwidth_choosegw_handler(bool ipv4, bool ipv6) {
+  gw_bandwidth_choose_gateway(ipv4, ipv6, olsr_get_gateway_hysteresis() > 0, false);
+}
+
+/**
+ * Configure the bandwidth weighted gateway handler, must be called
+ * before the gateway system is initialized.
+ *
+ * @param weight path cost added to a gateway with an uplink of
+ *   GW_BANDWIDTH_REFERENCE kbit/s, scaled inversely with the uplink.
+ *   0 keeps the default gateway handler.
+ * @param damping percentage a gateway must be better than the current
+ *   one before the periodic re-evaluation switches to it
+ */
+void olsr_gw_bandwidth_configure(unsigned int weight, unsigned int damping) {
+  gw_bw_weight = weight;
+  gw_bw_damping = damping;
+}
+
+/**
+ * initialization of bandwidth weighted gateway handler,
+ * replaces the default handler if it has been configured
+ */
+void olsr_gw_bandwidth_init(void) {
+  if (gw_bw_weight == 0) {
+    return;
+  }
+
+  gw_bw_timer = NULL;
+  gw_bw_candidate_ipv4 = NULL;
+  gw_bw_candidate_ipv6 = NULL;
+  gw_bw_rounds_ipv4 = 0;
+  gw_bw_rounds_ipv6 = 0;
+
+  olsr_set_inetgw_handler(&gw_bw_handler);
+}
+#endif
@@ -0,0 +1,23 @@
+/*
+ * gateway_bandwidth_handler.h
+ *
+ * Gateway handler scoring gateways by path cost and advertised uplink
+ */
+
+#ifndef GATEWAY_BANDWIDTH_HANDLER_H_
+#define GATEWAY_BANDWIDTH_HANDLER_H_
+
+#ifndef WIN32
+#include "gateway.h"
+
+#define GW_BANDWIDTH_TIMER_INTERVAL 10*1000
+#define GW_BANDWIDTH_DAMPING_ROUNDS 3
+
+/* uplink speed (kbit/s) which adds exactly the configured weight */
+#define GW_BANDWIDTH_REFERENCE      1000
+
+void olsr_gw_bandwidth_configure(unsigned int weight, unsigned int damping);
+void olsr_gw_bandwidth_init(void);
+
+#endif /* !WIN32 */
+#endif /* GATEWAY_BANDWIDTH_HANDLER_H_ */
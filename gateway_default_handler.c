@@ -25,46 +25,33 @@ static void gw_default_startup_handler(void);
 static void gw_default_choosegw_handler(bool ipv4, bool ipv6);
 static void gw_default_update_handler(struct gateway_entry *);
 static void gw_default_delete_handler(struct gateway_entry *);
+static bool gw_default_needs_switch(struct gateway_entry *, enum gateway_family);
 
 static struct olsr_gw_handler gw_def_handler = {
   &gw_default_startup_handler,
   &gw_default_choosegw_handler,
   &gw_default_update_handler,
-  &gw_default_delete_handler
+  &gw_default_delete_handler,
+  &gw_default_needs_switch
 };
 
 /**
- * Look through the gateway list and select the best gateway
- * depending on the distance to this router
+ * Select the best gateway depending on the distance to this router,
+ * taken from the path cost index of the gateway families
  */
 static void gw_default_choose_gateway(void) {
-  struct tc_entry *tc;
   struct gateway_entry *inet_ipv4, *inet_ipv6;
-  olsr_linkcost cost_ipv4, cost_ipv6;
-  struct gateway_entry *gw;
   bool dual;
 
-  cost_ipv4 = ROUTE_COST_BROKEN;
-  cost_ipv6 = ROUTE_COST_BROKEN;
-
   inet_ipv4 = NULL;
   inet_ipv6 = NULL;
 
-  OLSR_FOR_ALL_GATEWAY_ENTRIES(gw) {
-    /* gateways should not exist without tc entry */
-    if ((tc = olsr_lookup_tc_entry(&gw->originator)) == NULL) {
-      continue;
-    }
-
-    if (!gw_def_finished_ipv4 && gw->ipv4 && gw->ipv4nat == olsr_cnf->smart_gw_allow_nat && tc->path_cost < cost_ipv4) {
-      inet_ipv4 = gw;
-      cost_ipv4 = tc->path_cost;
-    }
-    if (!gw_def_finished_ipv6 && gw->ipv6 && tc->path_cost < cost_ipv6) {
-      inet_ipv6 = gw;
-      cost_ipv6 = tc->path_cost;
-    }
-  } OLSR_FOR_ALL_GATEWAY_ENTRIES_END(gw)
+  if (!gw_def_finished_ipv4) {
+    inet_ipv4 = olsr_get_best_gateway(olsr_get_ipv4_gateway_family());
+  }
+  if (!gw_def_finished_ipv6) {
+    inet_ipv6 = olsr_get_best_gateway(GW_FAMILY_IPV6);
+  }
 
   /* found an IPv4 gateway ? */
   gw_def_finished_ipv4 |= inet_ipv4 != NULL;
@@ -146,6 +133,14 @@ static void gw_default_delete_handler(struct gateway_entry *gw) {
   }
 }
 
+/* switch if a gateway is cheaper than the current one by the -gwhyst percentage */
+static bool gw_default_needs_switch(struct gateway_entry *gw, enum gateway_family family) {
+  struct gateway_entry *best = olsr_get_best_gateway(family);
+
+  return best != NULL && best != gw
+      && (uint64_t)best->path_cost * (100 + olsr_get_gateway_hysteresis()) < (uint64_t)gw->path_cost * 100;
+}
+
 static void gw_default_choosegw_handler(bool ipv4, bool ipv6) {
   olsr_gw_default_lookup_gateway(ipv4, ipv6);
 
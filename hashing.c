@@ -43,82 +43,104 @@
 #include "hashing.h"
 #include "defs.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static uint32_t olsr_ip_hashing_generic(const union olsr_ip_addr *);
+
+/* per-process seed, keeps remote nodes from aiming addresses at one bucket */
+static uint32_t hash_seed;
+
+/* width specific hash, selected by olsr_init_hashing() */
+static uint32_t (*ip_hash_func) (const union olsr_ip_addr *) = olsr_ip_hashing_generic;
+
 /*
- * Taken from lookup2.c by Bob Jenkins.  (http://burtleburtle.net/bob/c/lookup2.c).
- * --------------------------------------------------------------------
- * lookup2.c, by Bob Jenkins, December 1996, Public Domain.
- * You can use this free for any purpose.  It has no warranty.
- * --------------------------------------------------------------------
+ * Final avalanche step of MurmurHash3 (public domain, Austin Appleby).
+ * Every input bit affects every output bit, so the low HASHMASK bits
+ * are as good as the high ones.
  */
+static inline uint32_t
+olsr_hash_fmix(uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
 
-#define __jhash_mix(a, b, c) \
-{ \
-  a -= b; a -= c; a ^= (c>>13); \
-  b -= c; b -= a; b ^= (a<<8); \
-  c -= a; c -= b; c ^= (b>>13); \
-  a -= b; a -= c; a ^= (c>>12);  \
-  b -= c; b -= a; b ^= (a<<16); \
-  c -= a; c -= b; c ^= (b>>5); \
-  a -= b; a -= c; a ^= (c>>3);  \
-  b -= c; b -= a; b ^= (a<<10); \
-  c -= a; c -= b; c ^= (b>>15); \
+/* mix one 32 bit word of the key into the running hash */
+static inline uint32_t
+olsr_hash_word(uint32_t h, uint32_t k)
+{
+  k *= 0xcc9e2d51;
+  k = (k << 15) | (k >> 17);
+  k *= 0x1b873593;
+  h ^= k;
+  h = (h << 13) | (h >> 19);
+  return h * 5 + 0xe6546b64;
 }
 
 static uint32_t
-jenkins_hash(const uint8_t * k, uint32_t length)
+olsr_ip_hashing_v4(const union olsr_ip_addr *address)
 {
-  /* k: the key
-   * length: length of the key
-   * initval: the previous hash, or an arbitrary value
-   */
-  uint32_t a, b, c, len;
-
-  /* Set up the internal state */
-  len = length;
-  a = b = 0x9e3779b9;           /* the golden ratio; an arbitrary value */
-  c = 0;                        /* the previous hash value */
-
-  /* handle most of the key */
-  while (len >= 12) {
-    a += (k[0] + ((uint32_t) k[1] << 8) + ((uint32_t) k[2] << 16) + ((uint32_t) k[3] << 24));
-    b += (k[4] + ((uint32_t) k[5] << 8) + ((uint32_t) k[6] << 16) + ((uint32_t) k[7] << 24));
-    c += (k[8] + ((uint32_t) k[9] << 8) + ((uint32_t) k[10] << 16) + ((uint32_t) k[11] << 24));
-
-    __jhash_mix(a, b, c);
-
-    k += 12;
-    len -= 12;
-  }
+  uint32_t k;
+
+  memcpy(&k, &address->v4, sizeof(k));
+  return olsr_hash_fmix(hash_seed ^ k);
+}
 
-  c += length;
-  switch (len) {
-  case 11:
-    c += ((uint32_t) k[10] << 24);
-  case 10:
-    c += ((uint32_t) k[9] << 16);
-  case 9:
-    c += ((uint32_t) k[8] << 8);
-    /* the first byte of c is reserved for the length */
-  case 8:
-    b += ((uint32_t) k[7] << 24);
-  case 7:
-    b += ((uint32_t) k[6] << 16);
-  case 6:
-    b += ((uint32_t) k[5] << 8);
-  case 5:
-    b += k[4];
-  case 4:
-    a += ((uint32_t) k[3] << 24);
-  case 3:
-    a += ((uint32_t) k[2] << 16);
-  case 2:
-    a += ((uint32_t) k[1] << 8);
-  case 1:
-    a += k[0];
+static uint32_t
+olsr_ip_hashing_v6(const union olsr_ip_addr *address)
+{
+  uint32_t k[4];
+  uint32_t h;
+
+  memcpy(k, &address->v6, sizeof(k));
+  h = olsr_hash_word(hash_seed, k[0]);
+  h = olsr_hash_word(h, k[1]);
+  h = olsr_hash_word(h, k[2]);
+  h = olsr_hash_word(h, k[3]);
+  return olsr_hash_fmix(h ^ sizeof(k));
+}
+
+/*
+ * Used until olsr_init_hashing() has run, all hash tables are
+ * still empty at that point.
+ */
+static uint32_t
+olsr_ip_hashing_generic(const union olsr_ip_addr *address)
+{
+  return olsr_cnf->ip_version == AF_INET ? olsr_ip_hashing_v4(address) : olsr_ip_hashing_v6(address);
+}
+
+/**
+ * Pick a random seed and the hash function matching the
+ * configured address width. Must be called before the first
+ * entry is added to any of the address hash tables.
+ */
+void
+olsr_init_hashing(void)
+{
+  uint32_t seed = 0;
+#ifndef WIN32
+  int fd;
+
+  fd = open("/dev/urandom", O_RDONLY);
+  if (fd >= 0) {
+    if (read(fd, &seed, sizeof(seed)) != sizeof(seed)) {
+      seed = 0;
+    }
+    close(fd);
   }
-  __jhash_mix(a, b, c);
+#endif
+  /* random() has been seeded from the pid in main() */
+  hash_seed = seed ^ (uint32_t)random() ^ ((uint32_t)random() << 16);
 
-  return c;
+  ip_hash_func = olsr_cnf->ip_version == AF_INET ? olsr_ip_hashing_v4 : olsr_ip_hashing_v6;
 }
 
 /**
@@ -129,21 +151,46 @@ jenkins_hash(const uint8_t * k, uint32_t length)
 uint32_t
 olsr_ip_hashing(const union olsr_ip_addr * address)
 {
-  uint32_t hash;
-
-  switch (olsr_cnf->ip_version) {
-  case AF_INET:
-    hash = jenkins_hash((const uint8_t *)&address->v4, sizeof(uint32_t));
-    break;
-  case AF_INET6:
-    hash = jenkins_hash((const uint8_t *)&address->v6, sizeof(struct in6_addr));
-    break;
-  default:
-    hash = 0;
-    break;
+  return ip_hash_func(address) & HASHMASK;
+}
 
+/**
+ * Seeded hash over an arbitrary buffer, used as a cheap digest to
+ * recognize unchanged message payloads.
+ * @param buf start of the data
+ * @param len length of the data in bytes
+ * @return the unmasked 32 bit hash
+ */
+uint32_t
+olsr_buf_hash(const void *buf, size_t len)
+{
+  const uint8_t *ptr = buf;
+  uint32_t h = hash_seed;
+  uint32_t k;
+  size_t i;
+
+  for (i = 0; i + sizeof(k) <= len; i += sizeof(k)) {
+    memcpy(&k, ptr + i, sizeof(k));
+    h = olsr_hash_word(h, k);
+  }
+  if (i < len) {
+    k = 0;
+    memcpy(&k, ptr + i, len - i);
+    h = olsr_hash_word(h, k);
   }
-  return hash & HASHMASK;
+  return olsr_hash_fmix(h ^ (uint32_t)len);
+}
+
+/**
+ * Full width variant of olsr_ip_hashing(), for users that need
+ * more bits than the HASHMASK bucket index.
+ * @param address the address to hash
+ * @return the unmasked 32 bit hash
+ */
+uint32_t
+olsr_ip_hash32(const union olsr_ip_addr * address)
+{
+  return ip_hash_func(address);
 }
 
 /*
@@ -47,7 +47,10 @@
 
 #include "olsr_types.h"
 
+void olsr_init_hashing(void);
 uint32_t olsr_ip_hashing(const union olsr_ip_addr *);
+uint32_t olsr_ip_hash32(const union olsr_ip_addr *);
+uint32_t olsr_buf_hash(const void *, size_t);
 
 #endif
 
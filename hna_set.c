@@ -48,9 +48,12 @@
 #include "parser.h"
 #include "gateway.h"
 #include "duplicate_handler.h"
+#include "olsr_trace.h"
 
 struct hna_entry hna_set[HASHSIZE];
+struct hna_digest_stats hna_digest_stats;
 struct olsr_cookie_info *hna_net_timer_cookie = NULL;
+struct olsr_cookie_info *hna_gw_timer_cookie = NULL;
 struct olsr_cookie_info *hna_entry_mem_cookie = NULL;
 struct olsr_cookie_info *hna_net_mem_cookie = NULL;
 
@@ -70,6 +73,7 @@ olsr_init_hna_set(void)
   }
 
   hna_net_timer_cookie = olsr_alloc_cookie("HNA Network", OLSR_COOKIE_TYPE_TIMER);
+  hna_gw_timer_cookie = olsr_alloc_cookie("HNA Gateway", OLSR_COOKIE_TYPE_TIMER);
 
   hna_net_mem_cookie = olsr_alloc_cookie("hna_net", OLSR_COOKIE_TYPE_MEMORY);
   olsr_cookie_set_memory_size(hna_net_mem_cookie, sizeof(struct hna_net));
@@ -84,36 +88,34 @@ void
 olsr_cleanup_hna(union olsr_ip_addr *orig) {
   struct hna_entry *hna;
 
-  OLSR_FOR_ALL_HNA_ENTRIES(hna) {
-    if (hna->networks.next != &hna->networks && ipequal(&hna->A_gateway_addr, orig)) {
-      while (!olsr_delete_hna_net_entry(hna->networks.next));
-    }
-  } OLSR_FOR_ALL_HNA_ENTRIES_END(hna)
+  hna = olsr_lookup_hna_gw(orig);
+  if (hna != NULL && hna->networks.next != &hna->networks) {
+    while (!olsr_delete_hna_net_entry(hna->networks.next));
+  }
 }
 
 /**
- * Lookup a network entry in a networkentry list.
+ * Lookup a network entry of a gateway.
  *
- * @param nets the network list to look in
+ * @param hna_gw the gateway entry to look in
  * @param net the network to look for
- * @param mask the netmask to look for
+ * @param prefixlen the prefix length to look for
  *
  * @return the localized entry or NULL of not found
  */
 struct hna_net *
-olsr_lookup_hna_net(const struct hna_net *nets, const union olsr_ip_addr *net, uint8_t prefixlen)
+olsr_lookup_hna_net(struct hna_entry *hna_gw, const union olsr_ip_addr *net, uint8_t prefixlen)
 {
-  struct hna_net *tmp;
+  struct olsr_ip_prefix prefix;
+  struct avl_node *node;
 
-  /* Loop trough entrys */
-  for (tmp = nets->next; tmp != nets; tmp = tmp->next) {
-    if (tmp->hna_prefix.prefix_len == prefixlen && ipequal(&tmp->hna_prefix.prefix, net)) {
-      return tmp;
-    }
-  }
+  memset(&prefix, 0, sizeof(prefix));
+  prefix.prefix = *net;
+  prefix.prefix_len = prefixlen;
 
-  /* Not found */
-  return NULL;
+  node = avl_find(&hna_gw->net_tree, &prefix);
+
+  return node ? net_tree2hna_net(node) : NULL;
 }
 
 /**
@@ -164,6 +166,7 @@ olsr_add_hna_entry(const union olsr_ip_addr *addr)
   /* Link nets */
   new_entry->networks.next = &new_entry->networks;
   new_entry->networks.prev = &new_entry->networks;
+  avl_init(&new_entry->net_tree, avl_comp_prefix_default);
 
   /* queue */
   hash = olsr_ip_hashing(addr);
@@ -199,6 +202,10 @@ olsr_add_hna_net(struct hna_entry *hna_gw, const union olsr_ip_addr *net, uint8_
   /* Set backpointer */
   new_net->hna_gw = hna_gw;
 
+  /* Index */
+  new_net->net_tree_node.key = &new_net->hna_prefix;
+  avl_insert(&hna_gw->net_tree, &new_net->net_tree_node, AVL_DUP_NO);
+
   /* Queue */
   hna_gw->networks.next->prev = new_net;
   new_net->next = hna_gw->networks.next;
@@ -239,10 +246,13 @@ olsr_delete_hna_net_entry(struct hna_net *net_to_delete) {
   olsr_delete_routing_table(&net_to_delete->hna_prefix.prefix,
       net_to_delete->hna_prefix.prefix_len, &hna_gw->A_gateway_addr);
 
+  avl_delete(&hna_gw->net_tree, &net_to_delete->net_tree_node);
   DEQUEUE_ELEM(net_to_delete);
 
   /* Delete hna_gw if empty */
   if (hna_gw->networks.next == &hna_gw->networks) {
+    olsr_stop_timer(hna_gw->hna_gw_timer);
+    hna_gw->hna_gw_timer = NULL;
     DEQUEUE_ELEM(hna_gw);
     olsr_cookie_free(hna_entry_mem_cookie, hna_gw);
     removed_entry = true;
@@ -254,11 +264,40 @@ olsr_delete_hna_net_entry(struct hna_net *net_to_delete) {
 
 /**
  * Callback for the hna_net timer.
+ * Networks which were refreshed by unchanged HNA messages
+ * live on until the gateway timer runs out.
  */
 static void
 olsr_expire_hna_net_entry(void *context)
 {
-  olsr_delete_hna_net_entry(context);
+  struct hna_net *net = context;
+  struct hna_entry *hna_gw = net->hna_gw;
+
+  if (net->hna_digested && hna_gw->hna_gw_timer) {
+    int32_t due = olsr_getTimeDue(hna_gw->hna_gw_timer->timer_clock);
+
+    if (due > 0) {
+      hna_digest_stats.deferred_expiries++;
+
+      /* the expired timer is stopped by the scheduler, start a fresh one */
+      net->hna_net_timer = NULL;
+      olsr_set_timer(&net->hna_net_timer, due, 0, OLSR_TIMER_ONESHOT, &olsr_expire_hna_net_entry, net,
+                     hna_net_timer_cookie);
+      return;
+    }
+  }
+  olsr_delete_hna_net_entry(net);
+}
+
+/**
+ * Callback for the hna_gw timer, the digest is no longer valid.
+ */
+static void
+olsr_expire_hna_gw_timer(void *context)
+{
+  struct hna_entry *hna_gw = context;
+
+  hna_gw->hna_gw_timer = NULL;
 }
 
 /**
@@ -272,9 +311,9 @@ olsr_expire_hna_net_entry(void *context)
  *@param mask the netmask
  *@param vtime the validitytime of the entry
  *
- *@return nada
+ *@return the updated network entry
  */
-void
+struct hna_net *
 olsr_update_hna_entry(const union olsr_ip_addr *gw, const union olsr_ip_addr *net, uint8_t prefixlen, olsr_reltime vtime)
 {
   struct hna_entry *gw_entry;
@@ -287,7 +326,7 @@ olsr_update_hna_entry(const union olsr_ip_addr *gw, const union olsr_ip_addr *ne
     gw_entry = olsr_add_hna_entry(gw);
   }
 
-  net_entry = olsr_lookup_hna_net(&gw_entry->networks, net, prefixlen);
+  net_entry = olsr_lookup_hna_net(gw_entry, net, prefixlen);
   if (net_entry == NULL) {
 
     /* Need to add the net */
@@ -306,6 +345,8 @@ olsr_update_hna_entry(const union olsr_ip_addr *gw, const union olsr_ip_addr *ne
    */
   olsr_set_timer(&net_entry->hna_net_timer, vtime, OLSR_HNA_NET_JITTER, OLSR_TIMER_ONESHOT, &olsr_expire_hna_net_entry, net_entry,
                  hna_net_timer_cookie);
+
+  return net_entry;
 }
 
 /**
@@ -353,6 +394,9 @@ olsr_print_hna_set(void)
     }
   }
 #endif
+
+  OLSR_PRINTF(1, "\nHNA messages unchanged: %u, changed: %u, deferred expiries: %u\n", hna_digest_stats.unchanged,
+              hna_digest_stats.changed, hna_digest_stats.deferred_expiries);
 }
 
 /**
@@ -379,6 +423,10 @@ olsr_input_hna(union olsr_message *m, struct interface *in_if __attribute__ ((un
 
   int hnasize;
   const uint8_t *curr, *curr_end;
+  struct hna_entry *gw_entry;
+  struct hna_net *net_entry;
+  uint32_t digest;
+  bool smart_gw = false;
 
   struct ipaddr_str buf;
 #ifdef DEBUG
@@ -432,9 +480,33 @@ olsr_input_hna(union olsr_message *m, struct interface *in_if __attribute__ ((un
    *      message MUST be discarded.
    */
   if (check_neighbor_link(from_addr) != SYM_LINK) {
-    OLSR_PRINTF(2, "Received HNA from NON SYM neighbor %s\n", olsr_ip_to_string(&buf, from_addr));
+    OLSR_TRACE_PRINTF(2, TRACE_HNA_NONSYM, from_addr, NULL, 0, 0, "Received HNA from NON SYM neighbor %s\n",
+                      olsr_ip_to_string(&buf, from_addr));
     return false;
   }
+
+  /*
+   * Most HNAs repeat the last one of their originator. If the payload
+   * is unchanged only the gateway timer needs a refresh, the networks
+   * follow it when their own timers run out.
+   */
+  digest = olsr_buf_hash(curr, hnasize);
+  gw_entry = olsr_lookup_hna_gw(&originator);
+  if (gw_entry != NULL && gw_entry->hna_gw_timer != NULL && !gw_entry->hna_smart_gw
+      && gw_entry->hna_digest == digest && gw_entry->hna_digest_len == hnasize) {
+    hna_digest_stats.unchanged++;
+    olsr_set_timer(&gw_entry->hna_gw_timer, vtime, OLSR_HNA_NET_JITTER, OLSR_TIMER_ONESHOT, &olsr_expire_hna_gw_timer,
+                   gw_entry, hna_gw_timer_cookie);
+    return true;
+  }
+  hna_digest_stats.changed++;
+
+  if (gw_entry != NULL) {
+    for (net_entry = gw_entry->networks.next; net_entry != &gw_entry->networks; net_entry = net_entry->next) {
+      net_entry->hna_digested = false;
+    }
+  }
+
   while (curr < curr_end) {
     struct olsr_ip_prefix prefix;
     union olsr_ip_addr mask;
@@ -449,6 +521,8 @@ olsr_input_hna(union olsr_message *m, struct interface *in_if __attribute__ ((un
 
 #ifdef LINUX_NETLINK_ROUTING
     if (olsr_cnf->smart_gw_active && olsr_is_smart_gateway(&prefix, &mask)) {
+      /* gateway entries track the HNA seqno, never skip these */
+      smart_gw = true;
       olsr_update_gateway_entry(&originator, &mask, prefix.prefix_len, msg_seq_number);
     }
 #endif
@@ -475,9 +549,19 @@ olsr_input_hna(union olsr_message *m, struct interface *in_if __attribute__ ((un
     entry = ip_prefix_list_find(olsr_cnf->hna_entries, &prefix.prefix, prefix.prefix_len);
     if (entry == NULL) {
       /* only update if it's not from us */
-      olsr_update_hna_entry(&originator, &prefix.prefix, prefix.prefix_len, vtime);
+      net_entry = olsr_update_hna_entry(&originator, &prefix.prefix, prefix.prefix_len, vtime);
+      net_entry->hna_digested = true;
     }
   }
+
+  gw_entry = olsr_lookup_hna_gw(&originator);
+  if (gw_entry != NULL) {
+    gw_entry->hna_digest = digest;
+    gw_entry->hna_digest_len = hnasize;
+    gw_entry->hna_smart_gw = smart_gw;
+    olsr_set_timer(&gw_entry->hna_gw_timer, vtime, OLSR_HNA_NET_JITTER, OLSR_TIMER_ONESHOT, &olsr_expire_hna_gw_timer,
+                   gw_entry, hna_gw_timer_cookie);
+  }
   /* Forward the message */
   return true;
 }
@@ -46,6 +46,7 @@
 #include "olsr_types.h"
 #include "olsr_protocol.h"
 #include "mantissa.h"
+#include "common/avl.h"
 
 #include <time.h>
 
@@ -55,15 +56,24 @@ struct hna_net {
   struct olsr_ip_prefix hna_prefix;
   struct timer_entry *hna_net_timer;
   struct hna_entry *hna_gw;            /* backpointer to the owning HNA entry */
+  struct avl_node net_tree_node;       /* node in the net_tree of the gateway, key is hna_prefix */
+  bool hna_digested;                   /* announced in the payload covered by hna_digest */
   struct hna_net *next;
   struct hna_net *prev;
 };
 
+AVLNODE2STRUCT(net_tree2hna_net, struct hna_net, net_tree_node);
+
 #define OLSR_HNA_NET_JITTER 5   /* percent */
 
 struct hna_entry {
   union olsr_ip_addr A_gateway_addr;
   struct hna_net networks;
+  struct avl_tree net_tree;            /* index of networks, keyed by prefix */
+  uint32_t hna_digest;                 /* hash of the last fully processed HNA payload */
+  uint16_t hna_digest_len;
+  bool hna_smart_gw;                   /* payload carries a smart gateway announcement */
+  struct timer_entry *hna_gw_timer;    /* validity of hna_digest, refreshed by unchanged HNAs */
   struct hna_entry *next;
   struct hna_entry *prev;
 };
@@ -81,10 +91,18 @@ struct hna_entry {
 
 extern struct hna_entry hna_set[HASHSIZE];
 
+struct hna_digest_stats {
+  uint32_t unchanged;                  /* HNAs handled by refreshing the gateway timer */
+  uint32_t changed;                    /* HNAs processed prefix by prefix */
+  uint32_t deferred_expiries;          /* net timers pushed out to the gateway timer */
+};
+
+extern struct hna_digest_stats hna_digest_stats;
+
 int olsr_init_hna_set(void);
 void olsr_cleanup_hna(union olsr_ip_addr *orig);
 
-struct hna_net *olsr_lookup_hna_net(const struct hna_net *, const union olsr_ip_addr *, uint8_t);
+struct hna_net *olsr_lookup_hna_net(struct hna_entry *, const union olsr_ip_addr *, uint8_t);
 
 struct hna_entry *olsr_lookup_hna_gw(const union olsr_ip_addr *);
 
@@ -92,7 +110,7 @@ struct hna_entry *olsr_add_hna_entry(const union olsr_ip_addr *);
 
 struct hna_net *olsr_add_hna_net(struct hna_entry *, const union olsr_ip_addr *, uint8_t);
 
-void olsr_update_hna_entry(const union olsr_ip_addr *, const union olsr_ip_addr *, uint8_t, olsr_reltime);
+struct hna_net *olsr_update_hna_entry(const union olsr_ip_addr *, const union olsr_ip_addr *, uint8_t, olsr_reltime);
 
 void olsr_print_hna_set(void);
 
@@ -53,6 +53,7 @@
 
 #include "olsr_types.h"
 #include "mantissa.h"
+#include "common/list.h"
 
 #define IPV6_ADDR_ANY		0x0000U
 
@@ -102,6 +103,21 @@ struct vtimes {
   uint8_t hna;
 };
 
+/* Maximum number of received messages one output buffer can reference */
+#define NETBUF_MAX_SEGMENTS 16
+
+/*
+ * A forwarded message that is not copied into the output buffer but
+ * referenced in the (refcounted) buffer it was received in.
+ * The bytes at the same offset in the output buffer are left unused.
+ */
+struct olsr_netbuf_seg {
+  struct olsr_pktbuf *pktbuf;          /* Received packet holding the data */
+  uint8_t *data;                       /* Start of the message within pktbuf */
+  uint16_t offset;                     /* Payload offset within the output buffer */
+  uint16_t size;                       /* Length of the message */
+};
+
 /* Output buffer structure. This should actually be in net_olsr.h but we have circular references then.
  */
 struct olsr_netbuf {
@@ -110,6 +126,19 @@ struct olsr_netbuf {
   int maxsize;                         /* Max bytes of payload that can be added to the buffer */
   int pending;                         /* How much data is currently pending in the buffer */
   int reserved;                        /* Plugins can reserve space in buffers */
+  struct olsr_netbuf_seg *segs;        /* Referenced messages (scatter-gather output only) */
+  int segcount;                        /* Number of referenced messages pending */
+  struct list_node txqueue;            /* Finished packets waiting for batched transmission */
+  struct list_node txfree;             /* Spare packets for the transmit queue */
+  struct olsr_txsched *txsched;        /* Priority queues and pacing, NULL if not used */
+};
+
+/* Traffic counters of an interface, see olsr_metrics.h */
+struct olsr_if_counters {
+  uint64_t rx_packets;
+  uint64_t rx_bytes;
+  uint64_t tx_packets;
+  uint64_t tx_bytes;
 };
 
 /**
@@ -167,6 +196,9 @@ struct interface {
   /* the buffer to construct the packet data */
   struct olsr_netbuf netbuf;
 
+  /* traffic counters */
+  struct olsr_if_counters counters;
+
   /* Generic interface properties */
   struct if_gen_property *gen_properties;
 
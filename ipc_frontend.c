@@ -54,6 +54,11 @@
 #include "scheduler.h"
 #include "net_olsr.h"
 #include "ipcalc.h"
+#include "routing_table.h"
+
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
 
 #ifdef WIN32
 #define close(x) closesocket(x)
@@ -65,13 +70,29 @@ void WinSockPError(const char *);
 #define MSG_NOSIGNAL 0
 #endif
 
+/*
+ * A connected front-end. All output is queued in a bounded ring
+ * buffer and written when the socket becomes writable, so a slow
+ * front-end never blocks the daemon. If route changes do not fit
+ * into the buffer they are dropped and the front-end gets a fresh
+ * snapshot of the routing table instead.
+ */
+struct ipc_client {
+  int fd;
+  bool resync;                         /* a route snapshot is due */
+  bool snapshot;                       /* snapshot in progress, cursor is valid */
+  bool dropped;                        /* route changes were lost, send RESYNC_IPC first */
+  struct olsr_ip_prefix cursor;        /* last route of the snapshot queued */
+  size_t head, len;                    /* ring buffer content */
+  uint8_t buf[IPC_CLIENT_BUFSIZE];
+};
+
 static int ipc_sock = -1;
-static int ipc_conn = -1;
-static int ipc_active = false;
+static struct ipc_client **ipc_clients = NULL;
 
-static int ipc_send_all_routes(int fd);
+static void ipc_client_io(int fd, void *data, unsigned int flags);
 
-static int ipc_send_net_info(int fd);
+static void ipc_send_net_info(struct ipc_client *client);
 
 /**
  *Create the socket to use for IPC to the
@@ -89,6 +110,8 @@ ipc_init(void)
   /* Add parser function */
   olsr_parser_add_function(&frontend_msgparser, PROMISCUOUS);
 
+  ipc_clients = olsr_malloc(sizeof(*ipc_clients) * olsr_cnf->ipc_connections, "IPC clients");
+
   /* get an internet domain socket */
   if ((ipc_sock = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
     perror("IPC socket");
@@ -130,34 +153,305 @@ ipc_init(void)
   return ipc_sock;
 }
 
+/**
+ * Append data to the output buffer of a front-end
+ *
+ * @param client front-end
+ * @param data pointer to data
+ * @param len length of data
+ * @return false if the data did not fit into the buffer
+ */
+static bool
+ipc_client_put(struct ipc_client *client, const void *data, size_t len)
+{
+  size_t tail, first;
+
+  if (IPC_CLIENT_BUFSIZE - client->len < len) {
+    return false;
+  }
+
+  tail = (client->head + client->len) % IPC_CLIENT_BUFSIZE;
+  first = IPC_CLIENT_BUFSIZE - tail < len ? IPC_CLIENT_BUFSIZE - tail : len;
+  memcpy(&client->buf[tail], data, first);
+  memcpy(&client->buf[0], (const uint8_t *)data + first, len - first);
+
+  if (client->len == 0) {
+    enable_olsr_socket(client->fd, &ipc_client_io, NULL, SP_PR_WRITE);
+  }
+  client->len += len;
+  return true;
+}
+
+/**
+ * Copy an interface name into the fixed size device field of
+ * a message, cutting it short if necessary
+ *
+ * @param dst the device field
+ * @param size size of the device field
+ * @param name interface name
+ */
+static void
+ipc_copy_device(char *dst, size_t size, const char *name)
+{
+  size_t len = strlen(name);
+
+  if (len > size - 1) {
+    len = size - 1;
+  }
+  memcpy(dst, name, len);
+  dst[len] = 0;
+}
+
+/**
+ * Fill an IPC route message
+ *
+ * @param packet message to fill
+ * @param rt route entry
+ * @param add true for a new or changed route, false for a deleted one
+ */
+static void
+ipc_fill_route_msg(struct ipcmsg *packet, const struct rt_entry *rt, bool add)
+{
+  memset(packet, 0, sizeof(*packet));
+  packet->size = htons(IPC_PACK_SIZE);
+  packet->msgtype = ROUTE_IPC;
+
+  packet->target_addr = rt->rt_dst.prefix;
+
+  if (add && rt->rt_best != NULL) {
+    packet->add = 1;
+    packet->metric = (uint8_t) (rt->rt_best->rtp_metric.hops);
+    packet->gateway_addr = rt->rt_nexthop.gateway;
+    ipc_copy_device(packet->device, sizeof(packet->device), if_ifwithindex_name(rt->rt_nexthop.iif_index));
+  }
+}
+
+/**
+ * Find the first route after a prefix, the prefix itself
+ * does not need to be in the routing table.
+ *
+ * @param prefix prefix to start after
+ * @return node of the route, NULL if there is none
+ */
+static struct avl_node *
+ipc_route_after(const struct olsr_ip_prefix *prefix)
+{
+  struct avl_node *node = routingtree.root, *next = NULL;
+
+  while (node != NULL) {
+    if (routingtree.comp(prefix, node->key) < 0) {
+      next = node;
+      node = node->left;
+    }
+    else {
+      node = node->right;
+    }
+  }
+  return next;
+}
+
+/**
+ * Queue the next part of a routing table snapshot for a front-end.
+ * The snapshot is limited to half of the buffer at a time, so live
+ * route changes still fit. It is continued after the buffer drained,
+ * with the route following the last one queued. If that route was
+ * deleted meanwhile, its deletion was streamed like any other change.
+ *
+ * @param client front-end
+ */
+static void
+ipc_client_fill_snapshot(struct ipc_client *client)
+{
+  struct avl_node *node = NULL;
+  struct ipcmsg packet;
+
+  if (client->snapshot) {
+    node = ipc_route_after(&client->cursor);
+  }
+
+  if (!client->snapshot) {
+    if (client->len >= IPC_CLIENT_BUFSIZE / 2) {
+      /* wait for the buffer to drain before starting over */
+      return;
+    }
+    if (client->dropped) {
+      memset(&packet, 0, sizeof(packet));
+      packet.size = htons(IPC_PACK_SIZE);
+      packet.msgtype = RESYNC_IPC;
+      if (!ipc_client_put(client, &packet, IPC_PACK_SIZE)) {
+        return;
+      }
+      client->dropped = false;
+    }
+    client->snapshot = true;
+    node = avl_walk_first(&routingtree);
+  }
+
+  for (; node != NULL && client->len < IPC_CLIENT_BUFSIZE / 2; node = avl_walk_next(node)) {
+    struct rt_entry *rt = rt_tree2rt(node);
+
+    ipc_fill_route_msg(&packet, rt, true);
+    ipc_client_put(client, &packet, IPC_PACK_SIZE);
+    client->cursor = rt->rt_dst;
+  }
+
+  if (node == NULL) {
+    client->snapshot = false;
+    client->resync = false;
+  }
+}
+
+/**
+ * Close the connection to a front-end
+ *
+ * @param client front-end
+ */
+static void
+ipc_client_close(struct ipc_client *client)
+{
+  int i;
+
+  for (i = 0; i < olsr_cnf->ipc_connections; i++) {
+    if (ipc_clients[i] == client) {
+      ipc_clients[i] = NULL;
+    }
+  }
+
+  remove_olsr_socket(client->fd, &ipc_client_io, NULL);
+  CLOSE(client->fd);
+  free(client);
+}
+
+/**
+ * Write as much of the output buffer of a front-end as the socket
+ * accepts, both parts of the ring buffer in a single call.
+ *
+ * @param client front-end
+ * @return false if the connection was lost
+ */
+static bool
+ipc_client_flush(struct ipc_client *client)
+{
+  size_t first;
+  ssize_t n;
+
+  first = IPC_CLIENT_BUFSIZE - client->head < client->len ? IPC_CLIENT_BUFSIZE - client->head : client->len;
+
+#ifdef WIN32
+  n = send(client->fd, (const char *)&client->buf[client->head], first, MSG_NOSIGNAL);
+#else
+  {
+    struct iovec iov[2];
+
+    iov[0].iov_base = &client->buf[client->head];
+    iov[0].iov_len = first;
+    iov[1].iov_base = &client->buf[0];
+    iov[1].iov_len = client->len - first;
+
+    n = writev(client->fd, iov, client->len > first ? 2 : 1);
+  }
+#endif
+  if (n < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return true;
+    }
+    OLSR_PRINTF(1, "(OUTPUT)IPC connection lost!\n");
+    ipc_client_close(client);
+    return false;
+  }
+
+  client->head = (client->head + n) % IPC_CLIENT_BUFSIZE;
+  client->len -= n;
+
+  if (client->resync) {
+    ipc_client_fill_snapshot(client);
+  }
+  if (client->len == 0) {
+    client->head = 0;
+    disable_olsr_socket(client->fd, &ipc_client_io, NULL, SP_PR_WRITE);
+  }
+  return true;
+}
+
+/**
+ * Socket handler of a connected front-end
+ */
+static void
+ipc_client_io(int fd, void *data, unsigned int flags)
+{
+  struct ipc_client *client = data;
+
+  if (flags & SP_PR_READ) {
+    char dummy[128];
+    ssize_t n = recv(fd, dummy, sizeof(dummy), 0);
+
+    /* front-ends do not talk to us, only notice when they hang up */
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      OLSR_PRINTF(1, "Front end disconnected\n");
+      ipc_client_close(client);
+      return;
+    }
+  }
+
+  if (flags & SP_PR_WRITE) {
+    ipc_client_flush(client);
+  }
+}
 
 void
 ipc_accept(int fd, void *data __attribute__ ((unused)), unsigned int flags __attribute__ ((unused)))
 {
   socklen_t addrlen;
   struct sockaddr_in pin;
+  struct ipc_client *client;
   char *addr;
+  int conn, i;
 
   addrlen = sizeof(struct sockaddr_in);
 
-  if ((ipc_conn = accept(fd, (struct sockaddr *)&pin, &addrlen)) == -1) {
+  if ((conn = accept(fd, (struct sockaddr *)&pin, &addrlen)) == -1) {
     perror("IPC accept");
     olsr_exit("IPC accept", EXIT_FAILURE);
-  } else {
-    OLSR_PRINTF(1, "Front end connected\n");
-    addr = inet_ntoa(pin.sin_addr);
-    if (ipc_check_allowed_ip((union olsr_ip_addr *)&pin.sin_addr.s_addr)) {
-      ipc_active = true;
-      ipc_send_net_info(ipc_conn);
-      ipc_send_all_routes(ipc_conn);
-      OLSR_PRINTF(1, "Connection from %s\n", addr);
-    } else {
-      OLSR_PRINTF(1, "Front end-connection from foregin host(%s) not allowed!\n", addr);
-      olsr_syslog(OLSR_LOG_ERR, "OLSR: Front end-connection from foregin host(%s) not allowed!\n", addr);
-      CLOSE(ipc_conn);
-    }
   }
 
+  OLSR_PRINTF(1, "Front end connected\n");
+  addr = inet_ntoa(pin.sin_addr);
+  if (!ipc_check_allowed_ip((union olsr_ip_addr *)&pin.sin_addr.s_addr)) {
+    OLSR_PRINTF(1, "Front end-connection from foregin host(%s) not allowed!\n", addr);
+    olsr_syslog(OLSR_LOG_ERR, "OLSR: Front end-connection from foregin host(%s) not allowed!\n", addr);
+    CLOSE(conn);
+    return;
+  }
+
+  for (i = 0; i < olsr_cnf->ipc_connections && ipc_clients[i] != NULL; i++);
+  if (i == olsr_cnf->ipc_connections) {
+    OLSR_PRINTF(1, "Too many front ends, connection from %s refused\n", addr);
+    CLOSE(conn);
+    return;
+  }
+
+#ifdef WIN32
+  {
+    unsigned long on = 1;
+    ioctlsocket(conn, FIONBIO, &on);
+  }
+#else
+  fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) | O_NONBLOCK);
+#endif
+
+  client = olsr_malloc(sizeof(*client), "IPC client");
+  client->fd = conn;
+  ipc_clients[i] = client;
+
+  add_olsr_socket(conn, &ipc_client_io, NULL, client, SP_PR_READ);
+
+  ipc_send_net_info(client);
+
+  /* the routing table follows as a snapshot */
+  client->resync = true;
+  ipc_client_fill_snapshot(client);
+
+  OLSR_PRINTF(1, "Connection from %s\n", addr);
 }
 
 bool
@@ -206,6 +500,7 @@ ipc_input(int sock __attribute__ ((unused)))
 
 /**
  *Sends a olsr packet on the IPC socket.
+ *Packets are dropped for front-ends without enough buffer space.
  *
  *@param olsr the olsr struct representing the packet
  *
@@ -215,9 +510,9 @@ bool
 frontend_msgparser(union olsr_message * msg, struct interface * in_if __attribute__ ((unused)), union olsr_ip_addr * from_addr
                    __attribute__ ((unused)))
 {
-  int size;
+  int i, size;
 
-  if (!ipc_active)
+  if (ipc_clients == NULL)
     return true;
 
   if (olsr_cnf->ip_version == AF_INET)
@@ -225,14 +520,60 @@ frontend_msgparser(union olsr_message * msg, struct interface * in_if __attribut
   else
     size = ntohs(msg->v6.olsr_msgsize);
 
-  if (send(ipc_conn, (void *)msg, size, MSG_NOSIGNAL) < 0) {
-    OLSR_PRINTF(1, "(OUTPUT)IPC connection lost!\n");
-    CLOSE(ipc_conn);
-    ipc_active = false;
+  for (i = 0; i < olsr_cnf->ipc_connections; i++) {
+    if (ipc_clients[i] != NULL) {
+      ipc_client_put(ipc_clients[i], msg, size);
+    }
   }
   return true;
 }
 
+/**
+ * Queue a route message for all front-ends. A front-end without
+ * enough buffer space loses it and is scheduled for a resync.
+ *
+ * @param packet route message
+ */
+static void
+ipc_queue_route_msg(const struct ipcmsg *packet)
+{
+  struct ipc_client *client;
+  int i;
+
+  for (i = 0; i < olsr_cnf->ipc_connections; i++) {
+    client = ipc_clients[i];
+    if (client == NULL || (client->resync && !client->snapshot)) {
+      /* the pending snapshot will contain the change */
+      continue;
+    }
+    if (!ipc_client_put(client, packet, IPC_PACK_SIZE)) {
+      OLSR_PRINTF(1, "IPC front end too slow, scheduling resync\n");
+      client->resync = true;
+      client->snapshot = false;
+      client->dropped = true;
+    }
+  }
+}
+
+/**
+ * Stream a route change from the kernel change queues to the front-ends.
+ *
+ * @param rt route entry
+ * @param add true if the route was added or changed, false if deleted
+ */
+void
+ipc_queue_route(const struct rt_entry *rt, bool add)
+{
+  struct ipcmsg packet;
+
+  if (ipc_clients == NULL) {
+    return;
+  }
+
+  ipc_fill_route_msg(&packet, rt, add);
+  ipc_queue_route_msg(&packet);
+}
+
 /**
  *Send a route table update to the front-end.
  *
@@ -246,13 +587,12 @@ int
 ipc_route_send_rtentry(const union olsr_ip_addr *dst, const union olsr_ip_addr *gw, int met, int add, const char *int_name)
 {
   struct ipcmsg packet;
-  char *tmp;
 
   if (olsr_cnf->ipc_connections <= 0) {
     return -1;
   }
 
-  if (!ipc_active) {
+  if (ipc_clients == NULL) {
     return 0;
   }
   memset(&packet, 0, sizeof(struct ipcmsg));
@@ -272,71 +612,7 @@ ipc_route_send_rtentry(const union olsr_ip_addr *dst, const union olsr_ip_addr *
   else
     memset(&packet.device[0], 0, 4);
 
-  tmp = (char *)&packet;
-  /*
-     x = 0;
-     for(i = 0; i < IPC_PACK_SIZE;i++)
-     {
-     if(x == 4)
-     {
-     x = 0;
-     printf("\n\t");
-     }
-     x++;
-     printf(" %03i", (u_char) tmp[i]);
-     }
-
-     printf("\n");
-   */
-
-  if (send(ipc_conn, tmp, IPC_PACK_SIZE, MSG_NOSIGNAL) < 0)     // MSG_NOSIGNAL to avoid sigpipe
-  {
-    OLSR_PRINTF(1, "(RT_ENTRY)IPC connection lost!\n");
-    CLOSE(ipc_conn);
-
-    ipc_active = false;
-    return -1;
-  }
-
-  return 1;
-}
-
-static int
-ipc_send_all_routes(int fd)
-{
-  struct rt_entry *rt;
-  struct ipcmsg packet;
-  char *tmp;
-
-  if (!ipc_active)
-    return 0;
-
-  OLSR_FOR_ALL_RT_ENTRIES(rt) {
-
-    memset(&packet, 0, sizeof(struct ipcmsg));
-    packet.size = htons(IPC_PACK_SIZE);
-    packet.msgtype = ROUTE_IPC;
-
-    packet.target_addr = rt->rt_dst.prefix;
-
-    packet.add = 1;
-    packet.metric = (uint8_t) (rt->rt_best->rtp_metric.hops);
-
-    packet.gateway_addr = rt->rt_nexthop.gateway;
-
-    memcpy(&packet.device[0], if_ifwithindex_name(rt->rt_nexthop.iif_index), 4);
-
-    tmp = (char *)&packet;
-
-    /* MSG_NOSIGNAL to avoid sigpipe */
-    if (send(fd, tmp, IPC_PACK_SIZE, MSG_NOSIGNAL) < 0) {
-      OLSR_PRINTF(1, "(RT_ENTRY)IPC connection lost!\n");
-      CLOSE(ipc_conn);
-      ipc_active = false;
-      return -1;
-    }
-  }
-  OLSR_FOR_ALL_RT_ENTRIES_END(rt);
+  ipc_queue_route_msg(&packet);
   return 1;
 }
 
@@ -344,83 +620,62 @@ ipc_send_all_routes(int fd)
  *Sends OLSR info to the front-end. This info consists of
  *the different time intervals and holding times, number
  *of interfaces, HNA routes and main address.
- *
- *@return negative on error
  */
-static int
-ipc_send_net_info(int fd)
+static void
+ipc_send_net_info(struct ipc_client *client)
 {
-  struct ipc_net_msg *net_msg;
-  //int x, i;
-  char *msg;
-
-  net_msg = olsr_malloc(sizeof(struct ipc_net_msg), "send net info");
-
-  msg = (char *)net_msg;
+  struct ipc_net_msg net_msg;
 
   OLSR_PRINTF(1, "Sending net-info to front end...\n");
 
-  memset(net_msg, 0, sizeof(struct ipc_net_msg));
+  memset(&net_msg, 0, sizeof(struct ipc_net_msg));
 
   /* Message size */
-  net_msg->size = htons(sizeof(struct ipc_net_msg));
+  net_msg.size = htons(sizeof(struct ipc_net_msg));
   /* Message type */
-  net_msg->msgtype = NET_IPC;
+  net_msg.msgtype = NET_IPC;
 
   /* MIDs */
   /* XXX fix IPC MIDcnt */
-  net_msg->mids = (ifnet != NULL && ifnet->int_next != NULL) ? 1 : 0;
+  net_msg.mids = (ifnet != NULL && ifnet->int_next != NULL) ? 1 : 0;
 
   /* HNAs */
-  net_msg->hnas = olsr_cnf->hna_entries == NULL ? 0 : 1;
+  net_msg.hnas = olsr_cnf->hna_entries == NULL ? 0 : 1;
 
   /* Different values */
   /* Temporary fixes */
   /* XXX fix IPC intervals */
-  net_msg->hello_int = 0;       //htons((uint16_t)hello_int);
-  net_msg->hello_lan_int = 0;   //htons((uint16_t)hello_int_nw);
-  net_msg->tc_int = 0;          //htons((uint16_t)tc_int);
-  net_msg->neigh_hold = 0;      //htons((uint16_t)neighbor_hold_time);
-  net_msg->topology_hold = 0;   //htons((uint16_t)topology_hold_time);
+  net_msg.hello_int = 0;        //htons((uint16_t)hello_int);
+  net_msg.hello_lan_int = 0;    //htons((uint16_t)hello_int_nw);
+  net_msg.tc_int = 0;           //htons((uint16_t)tc_int);
+  net_msg.neigh_hold = 0;       //htons((uint16_t)neighbor_hold_time);
+  net_msg.topology_hold = 0;    //htons((uint16_t)topology_hold_time);
 
-  net_msg->ipv6 = olsr_cnf->ip_version == AF_INET ? 0 : 1;
+  net_msg.ipv6 = olsr_cnf->ip_version == AF_INET ? 0 : 1;
 
   /* Main addr */
-  net_msg->main_addr = olsr_cnf->main_addr;
-
-  /*
-     printf("\t");
-     x = 0;
-     for(i = 0; i < sizeof(struct ipc_net_msg);i++)
-     {
-     if(x == 4)
-     {
-     x = 0;
-     printf("\n\t");
-     }
-     x++;
-     printf(" %03i", (u_char) msg[i]);
-     }
-
-     printf("\n");
-   */
-
-  if (send(fd, (char *)net_msg, sizeof(struct ipc_net_msg), MSG_NOSIGNAL) < 0) {
-    OLSR_PRINTF(1, "(NETINFO)IPC connection lost!\n");
-    CLOSE(ipc_conn);
-    return -1;
-  }
+  net_msg.main_addr = olsr_cnf->main_addr;
 
-  free(net_msg);
-  return 0;
+  ipc_client_put(client, &net_msg, sizeof(struct ipc_net_msg));
 }
 
 int
 shutdown_ipc(void)
 {
+  int i;
+
   OLSR_PRINTF(1, "Shutting down IPC...\n");
   CLOSE(ipc_sock);
-  CLOSE(ipc_conn);
+
+  if (ipc_clients != NULL) {
+    for (i = 0; i < olsr_cnf->ipc_connections; i++) {
+      if (ipc_clients[i] != NULL) {
+        ipc_client_close(ipc_clients[i]);
+      }
+    }
+    free(ipc_clients);
+    ipc_clients = NULL;
+  }
 
   return 1;
 }
@@ -62,6 +62,9 @@
 #define IPC_PACK_SIZE 44        /* Size of the IPC_ROUTE packet */
 #define	ROUTE_IPC 11            /* IPC to front-end telling of route changes */
 #define NET_IPC 12              /* IPC to front end net-info */
+#define RESYNC_IPC 13           /* IPC telling the front-end to drop its routes, a snapshot follows */
+
+#define IPC_CLIENT_BUFSIZE (64*1024)    /* output buffer of each front-end */
 
 /*
  *IPC message sent to the front-end
@@ -102,6 +105,9 @@ bool frontend_msgparser(union olsr_message *, struct interface *, union olsr_ip_
 
 int ipc_route_send_rtentry(const union olsr_ip_addr *, const union olsr_ip_addr *, int, int, const char *);
 
+struct rt_entry;
+void ipc_queue_route(const struct rt_entry *, bool);
+
 #endif
 
 /*
@@ -101,6 +101,7 @@ void olsr_reset_all_links(void) {
     link->neighbor->is_mpr = false;
     link->neighbor->status = NOT_SYM;
   } OLSR_FOR_ALL_LINK_ENTRIES_END(link)
+  olsr_mpr_request_full();
 
 
   OLSR_FOR_ALL_LINK_ENTRIES(link) {
@@ -385,11 +386,14 @@ olsr_delete_link_entry(struct link_entry *link)
   link->link_hello_timer = NULL;
   olsr_stop_timer(link->link_loss_timer);
   link->link_loss_timer = NULL;
+  olsr_stop_timer(link->link_lq_timer);
+  link->link_lq_timer = NULL;
   list_remove(&link->link_list);
 
   free(link->if_name);
   free(link);
 
+  olsr_mpr_request_full();
   changes_neighborhood = true;
 }
 
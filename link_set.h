@@ -83,6 +83,7 @@ struct link_entry {
    */
   olsr_reltime loss_helloint;
   struct timer_entry *link_loss_timer;
+  struct timer_entry *link_lq_timer;   /* per-link LQ window, see olsr_lq_start_link_timer() */
 
   /* user defined multiplies for link quality, multiplied with 65536 */
   uint32_t loss_link_multiplier;
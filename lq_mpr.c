@@ -44,125 +44,245 @@
 #include "two_hop_neighbor_table.h"
 #include "link_set.h"
 #include "lq_mpr.h"
+#include "mpr.h"
 #include "scheduler.h"
 #include "lq_plugin.h"
 
+static bool lq_mpr_lost = false;
+
+/**
+ *Drop the MPR selection recorded in a 1 hop entry of a 2 hop
+ *neighbor, called before the entry is freed
+ *
+ *@param walker the 1 hop entry
+ */
 void
-olsr_calculate_lq_mpr(void)
+olsr_lq_mpr_release(struct neighbor_list_entry *walker)
 {
-  struct neighbor_2_entry *neigh2;
-  struct neighbor_list_entry *walker;
-  int i, k;
+  struct neighbor_entry *neigh = walker->neighbor;
+
+  if (!walker->mpr_selected) {
+    return;
+  }
+  walker->mpr_selected = false;
+
+  if (--neigh->mpr_refs == 0 && !(neigh->status == SYM && neigh->willingness == WILL_ALWAYS)) {
+    neigh->is_mpr = false;
+    lq_mpr_lost = true;
+  }
+}
+
+/**
+ *Select the MPRs for a single 2 hop neighbor: the 1 hop neighbors
+ *with the best path costs, as long as they are better than a
+ *direct link to it.
+ *
+ *@param neigh2 the 2 hop neighbor
+ *
+ *@return true if a neighbor became MPR which was none before
+ */
+static bool
+olsr_lq_mpr_select(struct neighbor_2_entry *neigh2)
+{
+  struct neighbor_list_entry *walker, *best_walker;
   struct neighbor_entry *neigh;
   olsr_linkcost best, best_1hop;
   bool mpr_changes = false;
+  int k;
 
-  OLSR_FOR_ALL_NBR_ENTRIES(neigh) {
+  best_1hop = LINK_COST_BROKEN;
 
-    /* Memorize previous MPR status. */
+  /* check whether this 2-hop neighbour is also a neighbour */
 
-    neigh->was_mpr = neigh->is_mpr;
+  neigh = olsr_lookup_neighbor_table(&neigh2->neighbor_2_addr);
 
-    /* Clear current MPR status. */
+  /* if it's a neighbour and also symmetric, then examine
+     the link quality */
 
-    neigh->is_mpr = false;
+  if (neigh != NULL && neigh->status == SYM) {
+    /* if the direct link is better than the best route via
+     * an MPR, then prefer the direct link and do not select
+     * an MPR for this 2-hop neighbour */
 
-    /* In this pass we are only interested in WILL_ALWAYS neighbours */
+    /* determine the link quality of the direct link */
 
-    if (neigh->status == NOT_SYM || neigh->willingness != WILL_ALWAYS) {
-      continue;
-    }
+    struct link_entry *lnk = get_best_link_to_neighbor(&neigh->neighbor_main_addr);
 
-    neigh->is_mpr = true;
+    if (!lnk)
+      return false;
 
-    if (neigh->is_mpr != neigh->was_mpr) {
-      mpr_changes = true;
-    }
+    best_1hop = lnk->linkcost;
+
+    /* see wether we find a better route via an MPR */
+
+    for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+      if (walker->path_linkcost < best_1hop)
+        break;
 
+    /* we've reached the end of the list, so we haven't found
+     * a better route via an MPR - so, skip MPR selection for
+     * this 1-hop neighbor */
+
+    if (walker == &neigh2->neighbor_2_nblist)
+      return false;
   }
-  OLSR_FOR_ALL_NBR_ENTRIES_END(neigh);
 
-  for (i = 0; i < HASHSIZE; i++) {
-    /* loop through all 2-hop neighbours */
+  /* find the connecting 1-hop neighbours with the
+   * best total link qualities */
 
-    for (neigh2 = two_hop_neighbortable[i].next; neigh2 != &two_hop_neighbortable[i]; neigh2 = neigh2->next) {
-      best_1hop = LINK_COST_BROKEN;
+  /* mark all 1-hop neighbours as not selected */
 
-      /* check whether this 2-hop neighbour is also a neighbour */
+  for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+    walker->neighbor->skip = false;
 
-      neigh = olsr_lookup_neighbor_table(&neigh2->neighbor_2_addr);
+  for (k = 0; k < olsr_cnf->mpr_coverage; k++) {
+    /* look for the best 1-hop neighbour that we haven't
+     * yet selected */
 
-      /* if it's a neighbour and also symmetric, then examine
-         the link quality */
+    best_walker = NULL;
+    best = LINK_COST_BROKEN;
 
-      if (neigh != NULL && neigh->status == SYM) {
-        /* if the direct link is better than the best route via
-         * an MPR, then prefer the direct link and do not select
-         * an MPR for this 2-hop neighbour */
+    for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+      if (walker->neighbor->status == SYM && !walker->neighbor->skip && walker->path_linkcost < best) {
+        best_walker = walker;
+        best = walker->path_linkcost;
+      }
 
-        /* determine the link quality of the direct link */
+    /* Found a 1-hop neighbor that we haven't previously selected.
+     * Use it as MPR only when the 2-hop path through it is better than
+     * any existing 1-hop path. */
+    if ((best_walker != NULL) && (best < best_1hop)) {
+      neigh = best_walker->neighbor;
+      neigh->is_mpr = true;
+      neigh->skip = true;
+
+      /* remember the selection for the incremental update */
+      best_walker->mpr_selected = true;
+      neigh->mpr_refs++;
+
+      if (neigh->is_mpr != neigh->was_mpr)
+        mpr_changes = true;
+    }
+
+    /* no neighbour found => the requested MPR coverage cannot
+     * be satisfied => stop */
+
+    else
+      break;
+  }
+  return mpr_changes;
+}
+
+/**
+ *Re-evaluate the MPR selection of the 2 hop neighbors
+ *queued on mpr_dirty_list only
+ */
+static void
+olsr_update_lq_mpr(void)
+{
+  struct neighbor_2_entry *neigh2;
+  struct neighbor_list_entry *walker;
+  bool mpr_changes = lq_mpr_lost;
 
-        struct link_entry *lnk = get_best_link_to_neighbor(&neigh->neighbor_main_addr);
+  lq_mpr_lost = false;
 
-        if (!lnk)
-          continue;
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES(neigh2) {
+    /* forget the previous selection of this 2-hop neighbour */
 
-        best_1hop = lnk->linkcost;
+    for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+      olsr_lq_mpr_release(walker);
 
-        /* see wether we find a better route via an MPR */
+    olsr_lq_mpr_select(neigh2);
+  }
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES_END(neigh2);
 
-        for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
-          if (walker->path_linkcost < best_1hop)
-            break;
+  /* the releases above are re-checked below */
+  lq_mpr_lost = false;
 
-        /* we've reached the end of the list, so we haven't found
-         * a better route via an MPR - so, skip MPR selection for
-         * this 1-hop neighbor */
+  /* only the 1-hop neighbours of the changed entries can have changed */
 
-        if (walker == &neigh2->neighbor_2_nblist)
-          continue;
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES(neigh2) {
+    for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next) {
+      if (walker->neighbor->is_mpr != walker->neighbor->was_mpr) {
+        walker->neighbor->was_mpr = walker->neighbor->is_mpr;
+        mpr_changes = true;
       }
+    }
+  }
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES_END(neigh2);
 
-      /* find the connecting 1-hop neighbours with the
-       * best total link qualities */
+  while (!list_is_empty(&mpr_dirty_list)) {
+    list_remove(mpr_dirty_list.next);
+  }
 
-      /* mark all 1-hop neighbours as not selected */
+  if (mpr_changes && olsr_cnf->tc_redundancy > 0)
+    signal_link_changes(true);
+}
 
-      for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
-        walker->neighbor->skip = false;
+void
+olsr_calculate_lq_mpr(void)
+{
+  struct neighbor_2_entry *neigh2;
+  struct neighbor_list_entry *walker;
+  int i;
+  struct neighbor_entry *neigh;
+  bool mpr_changes = false;
+
+  if (!olsr_mpr_need_full()) {
+    olsr_update_lq_mpr();
+#ifdef MPR_VALIDATE
+    olsr_validate_mpr_set(olsr_calculate_lq_mpr, true);
+#endif
+    return;
+  }
 
-      for (k = 0; k < olsr_cnf->mpr_coverage; k++) {
-        /* look for the best 1-hop neighbour that we haven't
-         * yet selected */
+  OLSR_FOR_ALL_NBR_ENTRIES(neigh) {
 
-        neigh = NULL;
-        best = LINK_COST_BROKEN;
+    /* Memorize previous MPR status. */
 
-        for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
-          if (walker->neighbor->status == SYM && !walker->neighbor->skip && walker->path_linkcost < best) {
-            neigh = walker->neighbor;
-            best = walker->path_linkcost;
-          }
+    neigh->was_mpr = neigh->is_mpr;
 
-        /* Found a 1-hop neighbor that we haven't previously selected.
-         * Use it as MPR only when the 2-hop path through it is better than
-         * any existing 1-hop path. */
-        if ((neigh != NULL) && (best < best_1hop)) {
-          neigh->is_mpr = true;
-          neigh->skip = true;
+    /* Clear current MPR status. */
 
-          if (neigh->is_mpr != neigh->was_mpr)
-            mpr_changes = true;
-        }
+    neigh->is_mpr = false;
+    neigh->mpr_refs = 0;
 
-        /* no neighbour found => the requested MPR coverage cannot
-         * be satisfied => stop */
+    /* In this pass we are only interested in WILL_ALWAYS neighbours */
 
-        else
-          break;
-      }
+    if (neigh->status == NOT_SYM || neigh->willingness != WILL_ALWAYS) {
+      continue;
+    }
+
+    neigh->is_mpr = true;
+
+    if (neigh->is_mpr != neigh->was_mpr) {
+      mpr_changes = true;
     }
+
   }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(neigh);
+
+  for (i = 0; i < HASHSIZE; i++) {
+    /* loop through all 2-hop neighbours */
+
+    for (neigh2 = two_hop_neighbortable[i].next; neigh2 != &two_hop_neighbortable[i]; neigh2 = neigh2->next) {
+      for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+        walker->mpr_selected = false;
+
+      if (olsr_lq_mpr_select(neigh2))
+        mpr_changes = true;
+    }
+  }
+
+  /* the incremental update compares against the state of this run */
+
+  OLSR_FOR_ALL_NBR_ENTRIES(neigh) {
+    neigh->was_mpr = neigh->is_mpr;
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(neigh);
+
+  lq_mpr_lost = false;
+  olsr_mpr_full_done();
 
   if (mpr_changes && olsr_cnf->tc_redundancy > 0)
     signal_link_changes(true);
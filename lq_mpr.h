@@ -42,8 +42,12 @@
 #ifndef _OLSR_LQ_MPR
 #define _OLSR_LQ_MPR
 
+#include "two_hop_neighbor_table.h"
+
 void olsr_calculate_lq_mpr(void);
 
+void olsr_lq_mpr_release(struct neighbor_list_entry *);
+
 #endif
 
 /*
@@ -141,7 +141,7 @@ destroy_lq_hello(struct lq_hello_message *lq_hello)
 
   for (walker = lq_hello->neigh; walker != NULL; walker = aux) {
     aux = walker->next;
-    free(walker);
+    olsr_free_lq_hello_neighbor(walker);
   }
 
   lq_hello->neigh = NULL;
@@ -275,7 +275,7 @@ destroy_lq_tc(struct lq_tc_message *lq_tc)
 
   for (walker = lq_tc->neigh; walker != NULL; walker = aux) {
     aux = walker->next;
-    free(walker);
+    olsr_free_tc_mpr_addr(walker);
   }
 }
 
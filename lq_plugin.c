@@ -46,6 +46,8 @@
 #include "packet.h"
 #include "olsr.h"
 #include "two_hop_neighbor_table.h"
+#include "mpr.h"
+#include "olsr_cookie.h"
 #include "common/avl.h"
 
 #include "lq_plugin_default_float.h"
@@ -55,9 +57,52 @@
 
 #include <assert.h>
 
+#ifdef LQ_STATIC
+/*
+ * LQ_STATIC binds one of the default handlers at compile time. Its source
+ * is compiled into this file, so the wrappers below call the handler
+ * functions directly and the compiler is free to inline them.
+ */
+#define LQ_STATIC_BODY
+#if defined LQ_STATIC_ff
+#include "lq_plugin_default_ff.c"
+#define LQ_STATIC_HANDLER lq_etx_ff_handler
+#define LQ_STATIC_NAME LQ_ALGORITHM_ETX_FF_NAME
+#elif defined LQ_STATIC_ffeth
+#include "lq_plugin_default_ffeth.c"
+#define LQ_STATIC_HANDLER lq_etx_ffeth_handler
+#define LQ_STATIC_NAME LQ_ALGORITHM_ETX_FFETH_NAME
+#elif defined LQ_STATIC_fpm
+#include "lq_plugin_default_fpm.c"
+#define LQ_STATIC_HANDLER lq_etx_fpm_handler
+#define LQ_STATIC_NAME LQ_ALGORITHM_ETX_FPM_NAME
+#elif defined LQ_STATIC_float
+#include "lq_plugin_default_float.c"
+#define LQ_STATIC_HANDLER lq_etx_float_handler
+#define LQ_STATIC_NAME LQ_ALGORITHM_ETX_FLOAT_NAME
+#else
+#error "LQ_STATIC must be one of ff, ffeth, fpm or float"
+#endif
+
+/* all default handlers name their functions default_lq_<op>_<algorithm> */
+#define LQ_STATIC_FN(op, alg) LQ_STATIC_PASTE(op, alg)
+#define LQ_STATIC_PASTE(op, alg) default_lq_##op##_##alg
+#define LQ_CALL(member, op) LQ_STATIC_FN(op, LQ_STATIC)
+#else
+#define LQ_CALL(member, op) active_lq_handler->member
+#endif
+
 struct avl_tree lq_handler_tree;
 struct lq_handler *active_lq_handler = NULL;
 
+/* Pools for the neighbor lists of HELLOs and TCs */
+static struct olsr_cookie_info *hello_neighbor_mem_cookie = NULL;
+static struct olsr_cookie_info *tc_mpr_addr_mem_cookie = NULL;
+static struct olsr_cookie_info *lq_hello_neighbor_mem_cookie = NULL;
+
+/* advance the LQ window of each link on its own timer */
+static bool lq_link_timers = false;
+
 /**
  * case-insensitive string comparator for avl-trees
  * @param str1
@@ -84,10 +129,24 @@ activate_lq_handler(const char *name)
     OLSR_PRINTF(1, "Error, unknown lq_handler '%s'\n", name);
     olsr_exit("", 1);
   }
+#ifdef LQ_STATIC
+  if (node->handler != &LQ_STATIC_HANDLER) {
+    OLSR_PRINTF(1, "Error, lq_handler '%s' cannot be used, olsrd was built for '%s'\n", name, LQ_STATIC_NAME);
+    olsr_exit("", 1);
+  }
+#endif
 
   OLSR_PRINTF(1, "Using '%s' algorithm for lq calculation.\n", name);
   active_lq_handler = node->handler;
   active_lq_handler->initialize();
+
+  /* the size of the lq data depends on the handler */
+  olsr_cookie_set_memory_size(hello_neighbor_mem_cookie,
+                              sizeof(struct hello_neighbor) + active_lq_handler->hello_lq_size);
+  olsr_cookie_set_memory_size(tc_mpr_addr_mem_cookie,
+                              sizeof(struct tc_mpr_addr) + active_lq_handler->tc_lq_size);
+  olsr_cookie_set_memory_size(lq_hello_neighbor_mem_cookie,
+                              sizeof(struct lq_hello_neighbor) + active_lq_handler->hello_lq_size);
 }
 
 /**
@@ -97,13 +156,25 @@ void
 init_lq_handler_tree(void)
 {
   avl_init(&lq_handler_tree, &avl_strcasecmp);
+#ifdef LQ_STATIC
+  register_lq_handler(&LQ_STATIC_HANDLER, LQ_STATIC_NAME);
+#else
   register_lq_handler(&lq_etx_float_handler, LQ_ALGORITHM_ETX_FLOAT_NAME);
   register_lq_handler(&lq_etx_fpm_handler, LQ_ALGORITHM_ETX_FPM_NAME);
   register_lq_handler(&lq_etx_ff_handler, LQ_ALGORITHM_ETX_FF_NAME);
   register_lq_handler(&lq_etx_ffeth_handler, LQ_ALGORITHM_ETX_FFETH_NAME);
+#endif
+
+  hello_neighbor_mem_cookie = olsr_alloc_cookie("hello_neighbor", OLSR_COOKIE_TYPE_MEMORY);
+  tc_mpr_addr_mem_cookie = olsr_alloc_cookie("tc_mpr_addr", OLSR_COOKIE_TYPE_MEMORY);
+  lq_hello_neighbor_mem_cookie = olsr_alloc_cookie("lq_hello_neighbor", OLSR_COOKIE_TYPE_MEMORY);
 
   if (olsr_cnf->lq_algorithm == NULL) {
+#ifdef LQ_STATIC
+    activate_lq_handler(LQ_STATIC_NAME);
+#else
     activate_lq_handler(DEF_LQ_ALGORITHM);
+#endif
   }
   else {
     activate_lq_handler(olsr_cnf->lq_algorithm);
@@ -149,7 +220,7 @@ olsr_linkcost
 olsr_calc_tc_cost(const struct tc_edge_entry * tc_edge)
 {
   assert((const char *)tc_edge + sizeof(*tc_edge) >= (const char *)tc_edge->linkquality);
-  return active_lq_handler->calc_tc_cost(tc_edge->linkquality);
+  return LQ_CALL(calc_tc_cost, calc_cost)(tc_edge->linkquality);
 }
 
 /**
@@ -166,7 +237,7 @@ int
 olsr_serialize_hello_lq_pair(unsigned char *buff, struct lq_hello_neighbor *neigh)
 {
   assert((const char *)neigh + sizeof(*neigh) >= (const char *)neigh->linkquality);
-  return active_lq_handler->serialize_hello_lq(buff, neigh->linkquality);
+  return LQ_CALL(serialize_hello_lq, serialize_hello_lq_pair)(buff, neigh->linkquality);
 }
 
 /**
@@ -182,8 +253,8 @@ void
 olsr_deserialize_hello_lq_pair(const uint8_t ** curr, struct hello_neighbor *neigh)
 {
   assert((const char *)neigh + sizeof(*neigh) >= (const char *)neigh->linkquality);
-  active_lq_handler->deserialize_hello_lq(curr, neigh->linkquality);
-  neigh->cost = active_lq_handler->calc_hello_cost(neigh->linkquality);
+  LQ_CALL(deserialize_hello_lq, deserialize_hello_lq_pair)(curr, neigh->linkquality);
+  neigh->cost = LQ_CALL(calc_hello_cost, calc_cost)(neigh->linkquality);
 }
 
 /**
@@ -200,7 +271,7 @@ int
 olsr_serialize_tc_lq_pair(unsigned char *buff, struct tc_mpr_addr *neigh)
 {
   assert((const char *)neigh + sizeof(*neigh) >= (const char *)neigh->linkquality);
-  return active_lq_handler->serialize_tc_lq(buff, neigh->linkquality);
+  return LQ_CALL(serialize_tc_lq, serialize_tc_lq_pair)(buff, neigh->linkquality);
 }
 
 /**
@@ -215,7 +286,7 @@ void
 olsr_deserialize_tc_lq_pair(const uint8_t ** curr, struct tc_edge_entry *edge)
 {
   assert((const char *)edge + sizeof(*edge) >= (const char *)edge->linkquality);
-  active_lq_handler->deserialize_tc_lq(curr, edge->linkquality);
+  LQ_CALL(deserialize_tc_lq, deserialize_tc_lq_pair)(curr, edge->linkquality);
 }
 
 /**
@@ -232,7 +303,7 @@ void
 olsr_update_packet_loss_worker(struct link_entry *entry, bool lost)
 {
   assert((const char *)entry + sizeof(*entry) >= (const char *)entry->linkquality);
-  active_lq_handler->packet_loss_handler(entry, entry->linkquality, lost);
+  LQ_CALL(packet_loss_handler, packet_loss_worker)(entry, entry->linkquality, lost);
 }
 
 /**
@@ -251,9 +322,9 @@ olsr_memorize_foreign_hello_lq(struct link_entry *local, struct hello_neighbor *
   assert((const char *)local + sizeof(*local) >= (const char *)local->linkquality);
   if (foreign) {
     assert((const char *)foreign + sizeof(*foreign) >= (const char *)foreign->linkquality);
-    active_lq_handler->memorize_foreign_hello(local->linkquality, foreign->linkquality);
+    LQ_CALL(memorize_foreign_hello, memorize_foreign_hello)(local->linkquality, foreign->linkquality);
   } else {
-    active_lq_handler->memorize_foreign_hello(local->linkquality, NULL);
+    LQ_CALL(memorize_foreign_hello, memorize_foreign_hello)(local->linkquality, NULL);
   }
 }
 
@@ -273,7 +344,7 @@ const char *
 get_link_entry_text(struct link_entry *entry, char separator, struct lqtextbuffer *buffer)
 {
   assert((const char *)entry + sizeof(*entry) >= (const char *)entry->linkquality);
-  return active_lq_handler->print_hello_lq(entry->linkquality, separator, buffer);
+  return LQ_CALL(print_hello_lq, print)(entry->linkquality, separator, buffer);
 }
 
 /**
@@ -292,7 +363,7 @@ const char *
 get_tc_edge_entry_text(struct tc_edge_entry *entry, char separator, struct lqtextbuffer *buffer)
 {
   assert((const char *)entry + sizeof(*entry) >= (const char *)entry->linkquality);
-  return active_lq_handler->print_tc_lq(entry->linkquality, separator, buffer);
+  return LQ_CALL(print_tc_lq, print)(entry->linkquality, separator, buffer);
 }
 
 /**
@@ -320,7 +391,7 @@ get_linkcost_text(olsr_linkcost cost, bool route, struct lqtextbuffer *buffer)
       return infinite;
     }
   }
-  return active_lq_handler->print_cost(cost, buffer);
+  return LQ_CALL(print_cost, print_cost)(cost, buffer);
 }
 
 /**
@@ -404,17 +475,30 @@ olsr_clear_tc_lq(struct tc_mpr_addr *target)
  * @return pointer to hello_neighbor
  */
 struct hello_neighbor *
-olsr_malloc_hello_neighbor(const char *id)
+olsr_malloc_hello_neighbor(const char *id __attribute__ ((unused)))
 {
   struct hello_neighbor *h;
 
-  h = olsr_malloc(sizeof(struct hello_neighbor) + active_lq_handler->hello_lq_size, id);
+  h = olsr_cookie_malloc(hello_neighbor_mem_cookie);
 
   assert((const char *)h + sizeof(*h) >= (const char *)h->linkquality);
   active_lq_handler->clear_hello(h->linkquality);
   return h;
 }
 
+/**
+ * olsr_free_hello_neighbor
+ *
+ * this function gives a hello_neighbor back to its pool.
+ *
+ * @param pointer to hello_neighbor
+ */
+void
+olsr_free_hello_neighbor(struct hello_neighbor *h)
+{
+  olsr_cookie_free(hello_neighbor_mem_cookie, h);
+}
+
 /**
  * olsr_malloc_tc_mpr_addr
  *
@@ -426,17 +510,30 @@ olsr_malloc_hello_neighbor(const char *id)
  * @return pointer to tc_mpr_addr
  */
 struct tc_mpr_addr *
-olsr_malloc_tc_mpr_addr(const char *id)
+olsr_malloc_tc_mpr_addr(const char *id __attribute__ ((unused)))
 {
   struct tc_mpr_addr *t;
 
-  t = olsr_malloc(sizeof(struct tc_mpr_addr) + active_lq_handler->tc_lq_size, id);
+  t = olsr_cookie_malloc(tc_mpr_addr_mem_cookie);
 
   assert((const char *)t + sizeof(*t) >= (const char *)t->linkquality);
   active_lq_handler->clear_tc(t->linkquality);
   return t;
 }
 
+/**
+ * olsr_free_tc_mpr_addr
+ *
+ * this function gives a tc_mpr_addr back to its pool.
+ *
+ * @param pointer to tc_mpr_addr
+ */
+void
+olsr_free_tc_mpr_addr(struct tc_mpr_addr *t)
+{
+  olsr_cookie_free(tc_mpr_addr_mem_cookie, t);
+}
+
 /**
  * olsr_malloc_lq_hello_neighbor
  *
@@ -448,17 +545,30 @@ olsr_malloc_tc_mpr_addr(const char *id)
  * @return pointer to lq_hello_neighbor
  */
 struct lq_hello_neighbor *
-olsr_malloc_lq_hello_neighbor(const char *id)
+olsr_malloc_lq_hello_neighbor(const char *id __attribute__ ((unused)))
 {
   struct lq_hello_neighbor *h;
 
-  h = olsr_malloc(sizeof(struct lq_hello_neighbor) + active_lq_handler->hello_lq_size, id);
+  h = olsr_cookie_malloc(lq_hello_neighbor_mem_cookie);
 
   assert((const char *)h + sizeof(*h) >= (const char *)h->linkquality);
   active_lq_handler->clear_hello(h->linkquality);
   return h;
 }
 
+/**
+ * olsr_free_lq_hello_neighbor
+ *
+ * this function gives a lq_hello_neighbor back to its pool.
+ *
+ * @param pointer to lq_hello_neighbor
+ */
+void
+olsr_free_lq_hello_neighbor(struct lq_hello_neighbor *h)
+{
+  olsr_cookie_free(lq_hello_neighbor_mem_cookie, h);
+}
+
 /**
  * olsr_malloc_link_entry
  *
@@ -497,6 +607,7 @@ size_t olsr_sizeof_tc_lqdata(void) {
  * @param newcost new cost of this link
  */
 void olsr_relevant_linkcost_change(void) {
+  olsr_mpr_request_full();
   changes_neighborhood = true;
   changes_topology = true;
 
@@ -504,6 +615,42 @@ void olsr_relevant_linkcost_change(void) {
   signal_link_changes(true);
 }
 
+/**
+ * Enable or disable the per-link LQ timers. Must be set before
+ * the lq handler is activated.
+ *
+ * @param enable true to advance the LQ window of every link once per
+ *   hello interval of its neighbor instead of once per second for all
+ */
+void
+olsr_set_lq_link_timers(bool enable)
+{
+  lq_link_timers = enable;
+}
+
+bool
+olsr_lq_link_timers(void)
+{
+  return lq_link_timers;
+}
+
+/**
+ * Start the per-link LQ timer of a link, or adjust it when the
+ * neighbor changed its hello interval.
+ *
+ * @param link the link to run the timer for
+ * @param cb callback advancing the LQ window, gets the link as context
+ */
+void
+olsr_lq_start_link_timer(struct link_entry *link, timer_cb_func cb)
+{
+  unsigned int interval = link->last_htime ? link->last_htime : MSEC_PER_SEC;
+
+  if (link->link_lq_timer == NULL || link->link_lq_timer->timer_period != interval) {
+    olsr_set_timer(&link->link_lq_timer, interval, OLSR_LINK_JITTER, OLSR_TIMER_PERIODIC, cb, link, 0);
+  }
+}
+
 /*
  * Local Variables:
  * c-basic-offset: 2
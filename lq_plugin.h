@@ -48,6 +48,7 @@
 #include "lq_packet.h"
 #include "packet.h"
 #include "common/avl.h"
+#include "scheduler.h"
 
 #define LINK_COST_BROKEN (1<<22)
 #define ROUTE_COST_BROKEN (0xffffffff)
@@ -137,6 +138,9 @@ void olsr_clear_tc_lq(struct tc_mpr_addr *target);
 struct hello_neighbor *olsr_malloc_hello_neighbor(const char *id);
 struct tc_mpr_addr *olsr_malloc_tc_mpr_addr(const char *id);
 struct lq_hello_neighbor *olsr_malloc_lq_hello_neighbor(const char *id);
+void olsr_free_hello_neighbor(struct hello_neighbor *);
+void olsr_free_tc_mpr_addr(struct tc_mpr_addr *);
+void olsr_free_lq_hello_neighbor(struct lq_hello_neighbor *);
 struct link_entry *olsr_malloc_link_entry(const char *id);
 
 size_t olsr_sizeof_hello_lqdata(void);
@@ -144,6 +148,10 @@ size_t olsr_sizeof_tc_lqdata(void);
 
 void olsr_relevant_linkcost_change(void);
 
+void olsr_set_lq_link_timers(bool);
+bool olsr_lq_link_timers(void);
+void olsr_lq_start_link_timer(struct link_entry *, timer_cb_func);
+
 /* Externals. */
 extern struct lq_handler *active_lq_handler;
 
@@ -52,18 +52,26 @@
 
 #define LQ_FF_WINDOW 32
 #define LQ_FF_QUICKSTART_INIT 4
+#define LQ_FF_TOTAL_INIT 3
 
 struct default_lq_ff {
   uint8_t valueLq;
   uint8_t valueNlq;
 };
 
+/*
+ * Per-link LQ state, it lives in link_entry->linkquality and not in a
+ * separate array indexed by link: links are allocated one at a time
+ * and the lq_handler interface hands the state around by pointer. The
+ * running totals keep the timer's work per link constant instead.
+ */
 struct default_lq_ff_hello {
   struct default_lq_ff smoothed_lq;
   struct default_lq_ff lq;
   uint8_t windowSize, activePtr;
   uint16_t last_seq_nr;
   uint16_t missed_hellos;
+  uint32_t received_sum, total_sum;    /* running totals of received[] and total[] */
   uint16_t received[LQ_FF_WINDOW], total[LQ_FF_WINDOW];
 };
 
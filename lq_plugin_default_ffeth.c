@@ -56,7 +56,12 @@
 #define LQ_PLUGIN_LC_MULTIPLIER 1024
 #define LQ_PLUGIN_RELEVANT_COSTCHANGE_FF 16
 
+/* compiled into lq_plugin.c instead when bound with LQ_STATIC */
+#if !defined LQ_STATIC || defined LQ_STATIC_BODY
+
 static void default_lq_initialize_ffeth(void);
+static void default_lq_ffeth_link_timer(void *context);
+static void default_lq_ffeth_lqchange_timer(void *context);
 
 static olsr_linkcost default_lq_calc_cost_ffeth(const void *lq);
 
@@ -105,55 +110,46 @@ struct lq_handler lq_etx_ffeth_handler = {
   4
 };
 
-static void
-default_lq_ffeth_handle_lqchange(void) {
-  struct default_lq_ffeth_hello *lq;
-  struct ipaddr_str buf;
-  struct link_entry *link;
-
-  bool triggered = false;
-
-  OLSR_FOR_ALL_LINK_ENTRIES(link) {
-    bool relevant = false;
-    lq = (struct default_lq_ffeth_hello *)link->linkquality;
-
-#if 0
-  fprintf(stderr, "%s: old = %u/%u   new = %u/%u\n", olsr_ip_to_string(&buf, &link->neighbor_iface_addr),
-      lq->smoothed_lq.valueLq, lq->smoothed_lq.valueNlq,
-      lq->lq.valueLq, lq->lq.valueNlq);
-#endif
+/**
+ * Check if the current lq of a link differs enough from the
+ * smoothed one to be announced.
+ */
+static bool
+default_lq_ffeth_relevant_change(struct default_lq_ffeth_hello *lq)
+{
+  bool relevant = false;
 
-    if (lq->smoothed_lq.valueLq < lq->lq.valueLq) {
-      if (lq->lq.valueLq >= 254 || lq->lq.valueLq - lq->smoothed_lq.valueLq > lq->smoothed_lq.valueLq/10) {
-        relevant = true;
-      }
+  if (lq->smoothed_lq.valueLq < lq->lq.valueLq) {
+    if (lq->lq.valueLq >= 254 || lq->lq.valueLq - lq->smoothed_lq.valueLq > lq->smoothed_lq.valueLq/10) {
+      relevant = true;
     }
-    else if (lq->smoothed_lq.valueLq > lq->lq.valueLq) {
-      if (lq->smoothed_lq.valueLq - lq->lq.valueLq > lq->smoothed_lq.valueLq/10) {
-        relevant = true;
-      }
-    }
-    if (lq->smoothed_lq.valueNlq < lq->lq.valueNlq) {
-      if (lq->lq.valueNlq >= 254 || lq->lq.valueNlq - lq->smoothed_lq.valueNlq > lq->smoothed_lq.valueNlq/10) {
-        relevant = true;
-      }
+  }
+  else if (lq->smoothed_lq.valueLq > lq->lq.valueLq) {
+    if (lq->smoothed_lq.valueLq - lq->lq.valueLq > lq->smoothed_lq.valueLq/10) {
+      relevant = true;
     }
-    else if (lq->smoothed_lq.valueNlq > lq->lq.valueNlq) {
-      if (lq->smoothed_lq.valueNlq - lq->lq.valueNlq > lq->smoothed_lq.valueNlq/10) {
-        relevant = true;
-      }
+  }
+  if (lq->smoothed_lq.valueNlq < lq->lq.valueNlq) {
+    if (lq->lq.valueNlq >= 254 || lq->lq.valueNlq - lq->smoothed_lq.valueNlq > lq->smoothed_lq.valueNlq/10) {
+      relevant = true;
     }
-
-    if (relevant) {
-      memcpy(&lq->smoothed_lq, &lq->lq, sizeof(struct default_lq_ffeth));
-      link->linkcost = default_lq_calc_cost_ffeth(&lq->smoothed_lq);
-      triggered = true;
+  }
+  else if (lq->smoothed_lq.valueNlq > lq->lq.valueNlq) {
+    if (lq->smoothed_lq.valueNlq - lq->lq.valueNlq > lq->smoothed_lq.valueNlq/10) {
+      relevant = true;
     }
-  } OLSR_FOR_ALL_LINK_ENTRIES_END(link)
-
-  if (!triggered) {
-    return;
   }
+  return relevant;
+}
+
+/**
+ * Follow up on relevant changes found by the lq timer,
+ * bring all links up to date and announce the change.
+ */
+static void
+default_lq_ffeth_handle_lqchange(void) {
+  struct default_lq_ffeth_hello *lq;
+  struct link_entry *link;
 
   OLSR_FOR_ALL_LINK_ENTRIES(link) {
     lq = (struct default_lq_ffeth_hello *)link->linkquality;
@@ -211,79 +207,143 @@ default_lq_parser_ffeth(struct olsr *olsr, struct interface *in_if, union olsr_i
     seq_diff = 1;
   }
 
+  /* saturate, the running totals have to match the window */
+  if (seq_diff > (uint32_t)(UINT16_MAX - lq->total[lq->activePtr])) {
+    seq_diff = UINT16_MAX - lq->total[lq->activePtr];
+  }
+
   lq->received[lq->activePtr]++;
   lq->total[lq->activePtr] += seq_diff;
+  lq->received_sum++;
+  lq->total_sum += seq_diff;
 
   lq->last_seq_nr = olsr->olsr_seqno;
   lq->missed_hellos = 0;
+
+  if (olsr_lq_link_timers()) {
+    olsr_lq_start_link_timer(lnk, &default_lq_ffeth_link_timer);
+  }
 }
 
-static void
-default_lq_ffeth_timer(void __attribute__ ((unused)) * context)
+/**
+ * Advance the LQ window of a link by one slot and calculate its
+ * new link quality.
+ *
+ * @param link the link to update
+ * @param slot_time length of a window slot in milliseconds
+ * @return true if the link cost changed in a relevant way
+ */
+static bool
+default_lq_ffeth_update_link(struct link_entry *link, unsigned int slot_time)
 {
-  struct link_entry *link;
+  struct default_lq_ffeth_hello *tlq = (struct default_lq_ffeth_hello *)link->linkquality;
+  fpm ratio;
+  int received, total;
 
-  OLSR_FOR_ALL_LINK_ENTRIES(link) {
-    struct default_lq_ffeth_hello *tlq = (struct default_lq_ffeth_hello *)link->linkquality;
-    fpm ratio;
-    int i, received, total;
+  /* enlarge window if still in quickstart phase */
+  if (tlq->windowSize < LQ_FFETH_WINDOW) {
+    tlq->windowSize++;
+  }
 
-    received = 0;
-    total = 0;
+  /* slots outside of the quickstart window still hold their initial total */
+  received = tlq->received_sum;
+  total = tlq->total_sum - LQ_FFETH_TOTAL_INIT * (LQ_FFETH_WINDOW - tlq->windowSize);
 
-    /* enlarge window if still in quickstart phase */
-    if (tlq->windowSize < LQ_FFETH_WINDOW) {
-      tlq->windowSize++;
-    }
-    for (i = 0; i < tlq->windowSize; i++) {
-      received += tlq->received[i];
-      total += tlq->total[i];
-    }
+  /* calculate link quality */
+  if (total == 0) {
+    tlq->lq.valueLq = 0;
+  } else {
+    // start with link-loss-factor
+    ratio = fpmidiv(itofpm(link->loss_link_multiplier), LINK_LOSS_MULTIPLIER);
 
-    /* calculate link quality */
-    if (total == 0) {
-      tlq->lq.valueLq = 0;
-    } else {
-      // start with link-loss-factor
-      ratio = fpmidiv(itofpm(link->loss_link_multiplier), LINK_LOSS_MULTIPLIER);
+    /* keep missed hello periods in mind (round up hello interval to window slots) */
+    if (tlq->missed_hellos > 1) {
+      received = received - received * tlq->missed_hellos * link->inter->hello_etime / slot_time / LQ_FFETH_WINDOW;
+    }
 
-      /* keep missed hello periods in mind (round up hello interval to seconds) */
-      if (tlq->missed_hellos > 1) {
-        received = received - received * tlq->missed_hellos * link->inter->hello_etime/1000 / LQ_FFETH_WINDOW;
-      }
+    // calculate received/total factor
+    ratio = fpmmuli(ratio, received);
+    ratio = fpmidiv(ratio, total);
+    ratio = fpmmuli(ratio, 255);
 
-      // calculate received/total factor
-      ratio = fpmmuli(ratio, received);
-      ratio = fpmidiv(ratio, total);
-      ratio = fpmmuli(ratio, 255);
+    tlq->lq.valueLq = (uint8_t) (fpmtoi(ratio));
+  }
 
-      tlq->lq.valueLq = (uint8_t) (fpmtoi(ratio));
+  /* ethernet booster */
+  if (link->inter->mode == IF_MODE_ETHER) {
+    if (tlq->lq.valueLq > (uint8_t)(0.95 * 255)) {
+      tlq->perfect_eth = true;
     }
-
-    /* ethernet booster */
-    if (link->inter->mode == IF_MODE_ETHER) {
-      if (tlq->lq.valueLq > (uint8_t)(0.95 * 255)) {
-        tlq->perfect_eth = true;
-      }
-      else if (tlq->lq.valueLq > (uint8_t)(0.90 * 255)) {
-        tlq->perfect_eth = false;
-      }
-
-      if (tlq->perfect_eth) {
-        tlq->lq.valueLq = 255;
-      }
+    else if (tlq->lq.valueLq > (uint8_t)(0.90 * 255)) {
+      tlq->perfect_eth = false;
     }
-    else if (link->inter->mode != IF_MODE_ETHER && tlq->lq.valueLq > 0) {
-      tlq->lq.valueLq--;
+
+    if (tlq->perfect_eth) {
+      tlq->lq.valueLq = 255;
     }
+  }
+  else if (link->inter->mode != IF_MODE_ETHER && tlq->lq.valueLq > 0) {
+    tlq->lq.valueLq--;
+  }
 
-    // shift buffer
-    tlq->activePtr = (tlq->activePtr + 1) % LQ_FFETH_WINDOW;
-    tlq->total[tlq->activePtr] = 0;
-    tlq->received[tlq->activePtr] = 0;
+  // shift buffer
+  tlq->activePtr = (tlq->activePtr + 1) % LQ_FFETH_WINDOW;
+  tlq->received_sum -= tlq->received[tlq->activePtr];
+  tlq->total_sum -= tlq->total[tlq->activePtr];
+  tlq->total[tlq->activePtr] = 0;
+  tlq->received[tlq->activePtr] = 0;
+
+  if (default_lq_ffeth_relevant_change(tlq)) {
+    tlq->smoothed_lq = tlq->lq;
+    link->linkcost = default_lq_calc_cost_ffeth(&tlq->smoothed_lq);
+    return true;
+  }
+  return false;
+}
+
+static void
+default_lq_ffeth_timer(void __attribute__ ((unused)) * context)
+{
+  struct link_entry *link;
+  bool triggered = false;
+
+  OLSR_FOR_ALL_LINK_ENTRIES(link) {
+    if (default_lq_ffeth_update_link(link, MSEC_PER_SEC)) {
+      triggered = true;
+    }
   } OLSR_FOR_ALL_LINK_ENTRIES_END(link);
 
-  default_lq_ffeth_handle_lqchange();
+  if (triggered) {
+    default_lq_ffeth_handle_lqchange();
+  }
+}
+
+/* a per-link timer found a relevant change since the last lqchange walk */
+static bool lqchange_pending = false;
+
+/**
+ * Per-link variant of the lq timer, each window slot
+ * spans one hello interval of the neighbor. Relevant changes
+ * are only flagged, default_lq_ffeth_lqchange_timer() handles
+ * them for all links at once.
+ */
+static void
+default_lq_ffeth_link_timer(void *context)
+{
+  struct link_entry *link = context;
+
+  if (default_lq_ffeth_update_link(link, link->link_lq_timer->timer_period)) {
+    lqchange_pending = true;
+  }
+}
+
+static void
+default_lq_ffeth_lqchange_timer(void __attribute__ ((unused)) * context)
+{
+  if (lqchange_pending) {
+    lqchange_pending = false;
+    default_lq_ffeth_handle_lqchange();
+  }
 }
 
 static void
@@ -293,7 +353,11 @@ default_lq_initialize_ffeth(void)
     fprintf(stderr, "Warning, nat_treshold < 1.0 is more likely to produce loops with etx_ffeth\n");
   }
   olsr_packetparser_add_function(&default_lq_parser_ffeth);
-  olsr_start_timer(1000, 0, OLSR_TIMER_PERIODIC, &default_lq_ffeth_timer, NULL, 0);
+  if (olsr_lq_link_timers()) {
+    olsr_start_timer(1000, 0, OLSR_TIMER_PERIODIC, &default_lq_ffeth_lqchange_timer, NULL, 0);
+  } else {
+    olsr_start_timer(1000, 0, OLSR_TIMER_PERIODIC, &default_lq_ffeth_timer, NULL, 0);
+  }
 }
 
 static olsr_linkcost
@@ -434,9 +498,13 @@ default_lq_clear_ffeth_hello(void *target)
   default_lq_clear_ffeth(&local->lq);
   default_lq_clear_ffeth(&local->smoothed_lq);
   local->windowSize = LQ_FFETH_QUICKSTART_INIT;
+  local->activePtr = 0;
   for (i = 0; i < LQ_FFETH_WINDOW; i++) {
-    local->total[i] = 3;
+    local->received[i] = 0;
+    local->total[i] = LQ_FFETH_TOTAL_INIT;
   }
+  local->received_sum = 0;
+  local->total_sum = LQ_FFETH_TOTAL_INIT * LQ_FFETH_WINDOW;
 }
 
 static const char *
@@ -467,6 +535,8 @@ default_lq_print_cost_ffeth(olsr_linkcost cost, struct lqtextbuffer *buffer)
   return buffer->buf;
 }
 
+#endif /* !LQ_STATIC || LQ_STATIC_BODY */
+
 /*
  * Local Variables:
  * c-basic-offset: 2
@@ -49,18 +49,21 @@
 
 #define LQ_FFETH_WINDOW 32
 #define LQ_FFETH_QUICKSTART_INIT 4
+#define LQ_FFETH_TOTAL_INIT 3
 
 struct default_lq_ffeth {
   uint8_t valueLq;
   uint8_t valueNlq;
 };
 
+/* Per-link LQ state, see lq_plugin_default_ff.h for the layout */
 struct default_lq_ffeth_hello {
   struct default_lq_ffeth smoothed_lq;
   struct default_lq_ffeth lq;
   uint8_t windowSize, activePtr;
   uint16_t last_seq_nr;
   uint16_t missed_hellos;
+  uint32_t received_sum, total_sum;    /* running totals of received[] and total[] */
   bool perfect_eth;
   uint16_t received[LQ_FFETH_WINDOW], total[LQ_FFETH_WINDOW];
 };
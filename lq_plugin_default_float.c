@@ -47,6 +47,9 @@
 #include "olsr.h"
 #include "lq_plugin_default_float.h"
 
+/* compiled into lq_plugin.c instead when bound with LQ_STATIC */
+#if !defined LQ_STATIC || defined LQ_STATIC_BODY
+
 static void default_lq_initialize_float(void);
 static olsr_linkcost default_lq_calc_cost_float(const void *lq);
 static void default_lq_packet_loss_worker_float(struct link_entry *link, void *lq, bool lost);
@@ -231,6 +234,8 @@ default_lq_print_cost_float(olsr_linkcost cost, struct lqtextbuffer *buffer)
   return buffer->buf;
 }
 
+#endif /* !LQ_STATIC || LQ_STATIC_BODY */
+
 /*
  * Local Variables:
  * c-basic-offset: 2
@@ -48,6 +48,9 @@
 #include "olsr.h"
 #include "lq_plugin_default_fpm.h"
 
+/* compiled into lq_plugin.c instead when bound with LQ_STATIC */
+#if !defined LQ_STATIC || defined LQ_STATIC_BODY
+
 static void default_lq_initialize_fpm(void);
 static olsr_linkcost default_lq_calc_cost_fpm(const void *lq);
 static void default_lq_packet_loss_worker_fpm(struct link_entry *link, void *lq, bool lost);
@@ -242,6 +245,8 @@ default_lq_print_cost_fpm(olsr_linkcost cost, struct lqtextbuffer *buffer)
   return buffer->buf;
 }
 
+#endif /* !LQ_STATIC || LQ_STATIC_BODY */
+
 /*
  * Local Variables:
  * c-basic-offset: 2
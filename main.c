@@ -58,7 +58,16 @@
 #include "net_olsr.h"
 #include "mid_set.h"
 #include "mpr_selector_set.h"
+#include "mpr.h"
+#include "tc_set.h"
+#include "olsr_cookie.h"
+#include "olsr_trace.h"
+#include "olsr_snapshot.h"
+#include "olsr_metrics.h"
+#include "olsr_cpustats.h"
+#include "lq_plugin.h"
 #include "gateway.h"
+#include "gateway_bandwidth_handler.h"
 #include "olsr_niit.h"
 
 #ifdef LINUX_NETLINK_ROUTING
@@ -497,6 +506,10 @@ int main(int argc, char *argv[]) {
   if (olsr_cnf->ipc_connections > 0) {
     ipc_init();
   }
+
+  /* Initialize the metrics endpoint */
+  olsr_metrics_init();
+
   /* Initialisation of different tables to be used. */
   olsr_init_tables();
 
@@ -650,6 +663,7 @@ static void olsr_shutdown_messages(void) {
     }
     net_output(ifn);
   }
+  net_output_flush();
 }
 
 /**
@@ -730,6 +744,9 @@ static void olsr_shutdown(int signo __attribute__ ((unused)))
     shutdown_ipc();
   }
 
+  /* metrics endpoint */
+  olsr_metrics_shutdown();
+
   /* OLSR sockets */
   for (ifn = ifnet; ifn; ifn = ifn->int_next) {
     close(ifn->olsr_socket);
@@ -774,9 +791,14 @@ static void olsr_shutdown(int signo __attribute__ ((unused)))
   close(olsr_cnf->rts);
 #endif
 
+  /* receive buffer of the scatter-gather output */
+  deinit_net();
+
   /* Free cookies and memory pools attached. */
   OLSR_PRINTF(0, "Free all memory...\n");
   olsr_delete_all_cookies();
+  olsr_trace_close();
+  olsr_snapshot_close();
 
   olsr_syslog(OLSR_LOG_INFO, "%s stopped", olsrd_version);
 
@@ -802,6 +824,11 @@ static void print_usage(bool error) {
         "  [-hint <hello interval (secs)>] [-tcint <tc interval (secs)>]\n"
         "  [-midint <mid interval (secs)>] [-hnaint <hna interval (secs)>]\n"
         "  [-T <Polling Rate (secs)>] [-nofork] [-hemu <ip_address>]\n"
+        "  [-sgout] [-txbatch] [-txsched <bytes per second>] [-mprincr]\n"
+        "  [-membudget <KiB>] [-tcbudget <vertices> <edges>] [-tchoplimit <hops>]\n"
+        "  [-trace <file>] [-lqlinktimer] [-gwhyst <percent>]\n"
+        "  [-gwbw <weight> <damping percent>] [-snapshot <file>] [-metrics <port>]\n"
+        "  [-cpustats]\n"
         "  [-lql <LQ level>] [-lqa <LQ aging factor>]\n",
         error ? "An error occured somwhere between your keyboard and your chair!\n" : "");
 }
@@ -1049,6 +1076,164 @@ static int olsr_process_arguments(int argc, char *argv[],
       continue;
     }
 
+    /*
+     * Should we forward messages by reference (scatter-gather output)?
+     */
+    if (strcmp(*argv, "-sgout") == 0) {
+      net_set_sg_output(true);
+      continue;
+    }
+
+    /*
+     * Should we send the packets of all interfaces in one batch?
+     */
+    if (strcmp(*argv, "-txbatch") == 0) {
+      net_set_tx_batching(true);
+      continue;
+    }
+
+    /*
+     * Output priority queues, paced to the given bytes per second
+     */
+    if (strcmp(*argv, "-txsched") == 0) {
+      int tmp_rate = -1;
+      NEXT_ARG;
+      CHECK_ARGC;
+
+      sscanf(*argv, "%d", &tmp_rate);
+
+      if (tmp_rate < 0) {
+        printf("Pacing rate %s not allowed, use 0 (unlimited) or bytes per second\n", *argv);
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      net_set_tx_scheduler(true, tmp_rate);
+      continue;
+    }
+
+    /*
+     * Should we only re-evaluate the MPRs of changed 2 hop neighbors?
+     */
+    if (strcmp(*argv, "-mprincr") == 0) {
+      olsr_set_mpr_incremental(true);
+      continue;
+    }
+
+    /*
+     * Advance the LQ of every link on its own hello interval
+     */
+    if (strcmp(*argv, "-lqlinktimer") == 0) {
+      olsr_set_lq_link_timers(true);
+      continue;
+    }
+
+    /*
+     * Binary trace of hot path events instead of debug output
+     */
+    if (strcmp(*argv, "-trace") == 0) {
+      NEXT_ARG;
+      CHECK_ARGC;
+
+      if (olsr_trace_open(*argv, OLSR_TRACE_RECORDS) < 0) {
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      continue;
+    }
+
+    /*
+     * Shared memory snapshot of the link state for external tools
+     */
+    if (strcmp(*argv, "-snapshot") == 0) {
+      NEXT_ARG;
+      CHECK_ARGC;
+
+      if (olsr_snapshot_open(*argv, OLSR_SNAPSHOT_SIZE) < 0) {
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      continue;
+    }
+
+    /*
+     * Time all callbacks, per plugin and timer
+     */
+    if (strcmp(*argv, "-cpustats") == 0) {
+      olsr_cpustats_set(true);
+      continue;
+    }
+
+    /*
+     * Local metrics endpoint
+     */
+    if (strcmp(*argv, "-metrics") == 0) {
+      int tmp_port = -1;
+      NEXT_ARG;
+      CHECK_ARGC;
+
+      sscanf(*argv, "%d", &tmp_port);
+
+      if (tmp_port < 1 || tmp_port > 65535) {
+        printf("Metrics port %s not allowed\n", *argv);
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      olsr_metrics_set_port(tmp_port);
+      continue;
+    }
+
+    /*
+     * Memory budget of all cookie allocations which can cope with a refusal
+     */
+    if (strcmp(*argv, "-membudget") == 0) {
+      int tmp_kb = -1;
+      NEXT_ARG;
+      CHECK_ARGC;
+
+      sscanf(*argv, "%d", &tmp_kb);
+
+      if (tmp_kb < 0) {
+        printf("Memory budget %s not allowed, use 0 (unlimited) or KiB\n", *argv);
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      olsr_cookie_set_global_budget((size_t)tmp_kb * 1024);
+      continue;
+    }
+
+    /*
+     * Maximum number of vertices and edges in the topology database
+     */
+    if (strcmp(*argv, "-tcbudget") == 0) {
+      int tmp_vertices = -1, tmp_edges = -1;
+      NEXT_ARG;
+      CHECK_ARGC;
+      sscanf(*argv, "%d", &tmp_vertices);
+      NEXT_ARG;
+      CHECK_ARGC;
+      sscanf(*argv, "%d", &tmp_edges);
+
+      if (tmp_vertices < 0 || tmp_edges < 0) {
+        printf("Topology budget not allowed, use 0 (unlimited) or the number of vertices and edges\n");
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      olsr_tc_set_budget(tmp_vertices, tmp_edges);
+      continue;
+    }
+
+    /*
+     * Distance beyond which no new topology is learned under memory pressure
+     */
+    if (strcmp(*argv, "-tchoplimit") == 0) {
+      int tmp_hops = -1;
+      NEXT_ARG;
+      CHECK_ARGC;
+
+      sscanf(*argv, "%d", &tmp_hops);
+
+      if (tmp_hops < 0 || tmp_hops > 255) {
+        printf("Hop limit %s not allowed, use 0 to 255\n", *argv);
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      olsr_tc_set_hop_limit(tmp_hops);
+      continue;
+    }
+
     /*
      * Should we set up and send on a IPC socket for the front-end?
      */
@@ -1102,6 +1287,46 @@ static int olsr_process_arguments(int argc, char *argv[],
       continue;
     }
 
+#ifdef LINUX_NETLINK_ROUTING
+    /*
+     * Switch to a gateway which is cheaper by this percentage
+     */
+    if (strcmp(*argv, "-gwhyst") == 0) {
+      int tmp_percent = -1;
+      NEXT_ARG;
+      CHECK_ARGC;
+
+      sscanf(*argv, "%d", &tmp_percent);
+
+      if (tmp_percent < 0) {
+        printf("Gateway hysteresis %s not allowed, use 0 (never switch) or a percentage\n", *argv);
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      olsr_set_gateway_hysteresis(tmp_percent);
+      continue;
+    }
+
+    /*
+     * Choose gateways by path cost weighted with their uplink
+     */
+    if (strcmp(*argv, "-gwbw") == 0) {
+      int tmp_weight = -1, tmp_damping = -1;
+      NEXT_ARG;
+      CHECK_ARGC;
+      sscanf(*argv, "%d", &tmp_weight);
+      NEXT_ARG;
+      CHECK_ARGC;
+      sscanf(*argv, "%d", &tmp_damping);
+
+      if (tmp_weight < 0 || tmp_damping < 0) {
+        printf("Gateway bandwidth weighting not allowed, use the path cost per 1 Mbit/s uplink (0 = off) and a damping percentage\n");
+        olsr_exit(__func__, EXIT_FAILURE);
+      }
+      olsr_gw_bandwidth_configure(tmp_weight, tmp_damping);
+      continue;
+    }
+#endif
+
     /*
      * Delete possible default GWs
      */
@@ -41,6 +41,39 @@
 
 #include "mantissa.h"
 
+/*
+ * Decoding table, see me_to_reltime() for the formula.
+ */
+#define ME_TO_RELTIME(me) \
+  (((me) & 0x0F) >= 8 ? ((16 + ((me) >> 4)) << (((me) & 0x0F) - 8)) * 1000 \
+   : ((16 + ((me) >> 4)) * 1000) >> (8 - ((me) & 0x0F)))
+#define ME_TO_RELTIME4(me) \
+  ME_TO_RELTIME(me), ME_TO_RELTIME((me) + 1), ME_TO_RELTIME((me) + 2), ME_TO_RELTIME((me) + 3)
+#define ME_TO_RELTIME16(me) \
+  ME_TO_RELTIME4(me), ME_TO_RELTIME4((me) + 4), ME_TO_RELTIME4((me) + 8), ME_TO_RELTIME4((me) + 12)
+#define ME_TO_RELTIME64(me) \
+  ME_TO_RELTIME16(me), ME_TO_RELTIME16((me) + 16), ME_TO_RELTIME16((me) + 32), ME_TO_RELTIME16((me) + 48)
+
+const olsr_reltime me_to_reltime_table[256] = {
+  ME_TO_RELTIME64(0), ME_TO_RELTIME64(64), ME_TO_RELTIME64(128), ME_TO_RELTIME64(192)
+};
+
+/*
+ * Number of significant bits, 0 for 0.
+ */
+static inline uint8_t
+olsr_bit_length(unsigned int value)
+{
+#ifdef __GNUC__
+  return value ? 32 - __builtin_clz(value) : 0;
+#else
+  uint8_t bits = 0;
+  for (; value; value >>= 1)
+    bits++;
+  return bits;
+#endif
+}
+
 /**
  *Function that converts a double to a mantissa/exponent
  *product as described in RFC3626:
@@ -72,10 +105,9 @@ reltime_to_me(const olsr_reltime interval)
    *                      = interval(ms) / 125 * 2
    */
   const unsigned int unscaled_interval = interval / 125 * 2;
-  b = 0;
-  while (unscaled_interval >= (1U << b)) {
-    b++;
-  }
+
+  /* smallest b with unscaled_interval < 2^b */
+  b = olsr_bit_length(unscaled_interval);
 
   if (b == 0) {
     a = 1;
@@ -128,53 +160,6 @@ reltime_to_me(const olsr_reltime interval)
   return (a << 4) | (b & 0x0F);
 }
 
-/**
- * Function for converting a mantissa/exponent 8bit value back
- * to double as described in RFC3626:
- *
- * value = C*(1+a/16)*2^b [in seconds]
- *
- *  where a is the integer represented by the four highest bits of the
- *  field and b the integer represented by the four lowest bits of the
- *  field.
- *
- * me is the 8 bit mantissa/exponent value
- *
- * To avoid expensive floating maths, we transform the equation:
- *     value = C * (1 + a / 16) * 2^b
- * first, we make an int addition from the floating point addition:
- *     value = C * ((16 + a) / 16) * 2^b
- * then we get rid of a pair of parentheses
- *     value = C * (16 + a) / 16 * 2^b
- * and now we make an int multiplication from the floating point one
- *     value = C * (16 + a) * 2^b / 16
- * so that we can make a shift from the multiplication
- *     value = C * ((16 + a) << b) / 16
- * and sionce C and 16 are constants
- *     value = ((16 + a) << b) * C / 16
- *
- * VTIME_SCALE_FACTOR = 1/16
- *
- * =>  value(ms) = ((16 + a) << b) / 256 * 1000
- *
- * 1. case: b >= 8
- *           = ((16 + a) << (b-8)) * 1000
- *
- * 2. case: b <= 8
- *           = ((16 + a) * 1000) >> (8-b)
- */
-olsr_reltime
-me_to_reltime(const uint8_t me)
-{
-  const uint8_t a = me >> 4;
-  const uint8_t b = me & 0x0F;
-
-  if (b >= 8) {
-    return ((16 + a) << (b - 8)) * 1000;
-  }
-  return ((16 + a) * 1000) >> (8 - b);
-}
-
 /*
  * Local Variables:
  * c-basic-offset: 2
@@ -47,9 +47,11 @@
 /* olsr_reltime is a relative timestamp measured in microseconds */
 typedef uint32_t olsr_reltime;
 
+extern const olsr_reltime me_to_reltime_table[256];
+
 /**
- * Macro for converting a mantissa/exponent 8bit value back
- * to an integer (measured in microseconds) as described in RFC3626:
+ * Function for converting a mantissa/exponent 8bit value back
+ * to an integer (measured in milliseconds) as described in RFC3626:
  *
  * value = C*(1+a/16)*2^b [in seconds]
  *
@@ -59,8 +61,17 @@ typedef uint32_t olsr_reltime;
  *
  * me is the 8 bit mantissa/exponent value
  *
+ * With VTIME_SCALE_FACTOR = 1/16 this is
+ *
+ *     value(ms) = ((16 + a) << b) / 256 * 1000
+ *
+ * and all 256 values are precomputed in me_to_reltime_table.
  */
-olsr_reltime me_to_reltime(const uint8_t);
+static inline olsr_reltime
+me_to_reltime(const uint8_t me)
+{
+  return me_to_reltime_table[me];
+}
 
 uint8_t reltime_to_me(const olsr_reltime);
 
@@ -53,12 +53,72 @@
 #include "packet.h"             /* struct mid_alias */
 #include "net_olsr.h"
 #include "duplicate_handler.h"
+#include "mpr.h"
+#include "olsr_trace.h"
 
 struct mid_entry mid_set[HASHSIZE];
 struct mid_address reverse_mid_set[HASHSIZE];
 
+/* saturated counters stay at UINT8_MAX forever */
+static uint8_t mid_filter[MID_FILTER_SIZE];
+struct mid_filter_stats mid_filter_stats;
+
+struct olsr_cookie_info *mid_entry_mem_cookie = NULL;
+struct olsr_cookie_info *mid_address_mem_cookie = NULL;
+struct olsr_cookie_info *mid_alias_mem_cookie = NULL;
+
 struct mid_entry *mid_lookup_entry_bymain(const union olsr_ip_addr *adr);
 
+/*
+ * The two filter probes use the hash bits above the HASHMASK
+ * bucket index, so they are independent of the chain an alias
+ * lives on.
+ */
+#define MID_FILTER_IDX1(h) (((h) >> (32 - MID_FILTER_BITS)) & MID_FILTER_MASK)
+#define MID_FILTER_IDX2(h) (((h) >> 8) & MID_FILTER_MASK)
+
+static void
+mid_filter_inc(uint8_t *counter)
+{
+  if (*counter < UINT8_MAX) {
+    (*counter)++;
+  }
+}
+
+static void
+mid_filter_dec(uint8_t *counter)
+{
+  if (*counter > 0 && *counter < UINT8_MAX) {
+    (*counter)--;
+  }
+}
+
+/**
+ * Queue an alias into reverse_mid_set and account it in the filter.
+ */
+static void
+mid_link_alias(struct mid_address *alias)
+{
+  uint32_t hash = olsr_ip_hash32(&alias->alias);
+
+  QUEUE_ELEM(reverse_mid_set[hash & HASHMASK], alias);
+  mid_filter_inc(&mid_filter[MID_FILTER_IDX1(hash)]);
+  mid_filter_inc(&mid_filter[MID_FILTER_IDX2(hash)]);
+}
+
+/**
+ * Remove an alias from reverse_mid_set and the filter.
+ */
+static void
+mid_unlink_alias(struct mid_address *alias)
+{
+  uint32_t hash = olsr_ip_hash32(&alias->alias);
+
+  DEQUEUE_ELEM(alias);
+  mid_filter_dec(&mid_filter[MID_FILTER_IDX1(hash)]);
+  mid_filter_dec(&mid_filter[MID_FILTER_IDX2(hash)]);
+}
+
 /**
  * Initialize the MID set
  *
@@ -78,6 +138,15 @@ olsr_init_mid_set(void)
     reverse_mid_set[idx].prev = &reverse_mid_set[idx];
   }
 
+  mid_entry_mem_cookie = olsr_alloc_cookie("mid_entry", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(mid_entry_mem_cookie, sizeof(struct mid_entry));
+
+  mid_address_mem_cookie = olsr_alloc_cookie("mid_address", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(mid_address_mem_cookie, sizeof(struct mid_address));
+
+  mid_alias_mem_cookie = olsr_alloc_cookie("mid_alias", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(mid_alias_mem_cookie, sizeof(struct mid_alias));
+
   return 1;
 }
 
@@ -152,11 +221,10 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
 {
   struct mid_entry *tmp;
   struct mid_address *tmp_adr;
-  uint32_t hash, alias_hash;
+  uint32_t hash;
   union olsr_ip_addr *registered_m_addr;
 
   hash = olsr_ip_hashing(m_addr);
-  alias_hash = olsr_ip_hashing(&alias->alias);
 
   /* Check for registered entry */
   for (tmp = mid_set[hash].next; tmp != &mid_set[hash]; tmp = tmp->next) {
@@ -181,17 +249,17 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
     tmp_adr = tmp->aliases;
     tmp->aliases = alias;
     alias->main_entry = tmp;
-    QUEUE_ELEM(reverse_mid_set[alias_hash], alias);
+    mid_link_alias(alias);
     alias->next_alias = tmp_adr;
     olsr_set_mid_timer(tmp, vtime);
   } else {
 
     /*Create new node */
-    tmp = olsr_malloc(sizeof(struct mid_entry), "MID new alias");
+    tmp = olsr_cookie_malloc(mid_entry_mem_cookie);
 
     tmp->aliases = alias;
     alias->main_entry = tmp;
-    QUEUE_ELEM(reverse_mid_set[alias_hash], alias);
+    mid_link_alias(alias);
     tmp->main_addr = *m_addr;
     olsr_set_mid_timer(tmp, vtime);
 
@@ -221,6 +289,7 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
 
       olsr_delete_two_hop_neighbor_table(tmp_2_neighbor);
 
+      olsr_mpr_request_full();
       changes_neighborhood = true;
     }
 
@@ -238,6 +307,7 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
       /* Delete */
       free(tmp_neigh);
 
+      olsr_mpr_request_full();
       changes_neighborhood = true;
     }
     tmp_adr = tmp_adr->next_alias;
@@ -269,7 +339,7 @@ insert_mid_alias(union olsr_ip_addr *main_add, const union olsr_ip_addr *alias,
   OLSR_PRINTF(1, "Inserting alias %s for ", olsr_ip_to_string(&buf1, alias));
   OLSR_PRINTF(1, "%s\n", olsr_ip_to_string(&buf1, main_add));
 
-  adr = olsr_malloc(sizeof(struct mid_address), "Insert MID alias");
+  adr = olsr_cookie_malloc(mid_address_mem_cookie);
 
   adr->alias = *alias;
   adr->next_alias = NULL;
@@ -305,12 +375,13 @@ insert_mid_alias(union olsr_ip_addr *main_add, const union olsr_ip_addr *alias,
   }
 
   if (!insert_mid_tuple(main_add, adr, vtime)) {
-    free(adr);
+    olsr_cookie_free(mid_address_mem_cookie, adr);
   }
 
   /*
    *Recalculate topology
    */
+  olsr_mpr_request_full();
   changes_neighborhood = true;
   changes_topology = true;
 }
@@ -328,13 +399,22 @@ mid_lookup_main_addr(const union olsr_ip_addr *adr)
   uint32_t hash;
   struct mid_address *tmp_list;
 
-  hash = olsr_ip_hashing(adr);
+  hash = olsr_ip_hash32(adr);
+
+  mid_filter_stats.lookups++;
+  if (mid_filter[MID_FILTER_IDX1(hash)] == 0 || mid_filter[MID_FILTER_IDX2(hash)] == 0) {
+    /* definitely no alias */
+    mid_filter_stats.filtered++;
+    return NULL;
+  }
+  hash &= HASHMASK;
 
   /*Traverse MID list */
   for (tmp_list = reverse_mid_set[hash].next; tmp_list != &reverse_mid_set[hash]; tmp_list = tmp_list->next) {
     if (ipequal(&tmp_list->alias, adr))
       return &tmp_list->main_entry->main_addr;
   }
+  mid_filter_stats.false_positives++;
   return NULL;
 
 }
@@ -387,7 +467,7 @@ olsr_update_mid_table(const union olsr_ip_addr *adr, olsr_reltime vtime)
   struct ipaddr_str buf;
   struct mid_entry *tmp_list = mid_set;
 
-  OLSR_PRINTF(3, "MID: update %s\n", olsr_ip_to_string(&buf, adr));
+  OLSR_TRACE_PRINTF(3, TRACE_MID_UPDATE, adr, NULL, 0, 0, "MID: update %s\n", olsr_ip_to_string(&buf, adr));
   hash = olsr_ip_hashing(adr);
 
   /* Check all registered nodes... */
@@ -466,18 +546,19 @@ olsr_prune_aliases(struct mid_message *message)
       }
 
       /* Remove from hash table */
-      DEQUEUE_ELEM(current_alias);
+      mid_unlink_alias(current_alias);
 
       /*
        * Delete the rt_path for the alias.
        */
       olsr_delete_routing_table(&current_alias->alias, olsr_cnf->maxplen, &entry->main_addr);
 
-      free(current_alias);
+      olsr_cookie_free(mid_address_mem_cookie, current_alias);
 
       /*
        *Recalculate topology
        */
+      olsr_mpr_request_full();
       changes_neighborhood = true;
       changes_topology = true;
     } else {
@@ -501,14 +582,14 @@ olsr_delete_mid_entry(struct mid_entry *mid)
   while (aliases) {
     struct mid_address *tmp_aliases = aliases;
     aliases = aliases->next_alias;
-    DEQUEUE_ELEM(tmp_aliases);
+    mid_unlink_alias(tmp_aliases);
 
     /*
      * Delete the rt_path for the alias.
      */
     olsr_delete_routing_table(&tmp_aliases->alias, olsr_cnf->maxplen, &mid->main_addr);
 
-    free(tmp_aliases);
+    olsr_cookie_free(mid_address_mem_cookie, tmp_aliases);
   }
 
   /*
@@ -521,7 +602,7 @@ olsr_delete_mid_entry(struct mid_entry *mid)
 
   /* Dequeue */
   DEQUEUE_ELEM(mid);
-  free(mid);
+  olsr_cookie_free(mid_entry_mem_cookie, mid);
 }
 
 /**
@@ -534,6 +615,8 @@ olsr_print_mid_set(void)
   int idx;
 
   OLSR_PRINTF(1, "\n--- %s ------------------------------------------------- MID\n\n", olsr_wallclock_string());
+  OLSR_PRINTF(1, "Alias lookups: %u, filtered: %u, false positives: %u\n\n", mid_filter_stats.lookups,
+              mid_filter_stats.filtered, mid_filter_stats.false_positives);
 
   for (idx = 0; idx < HASHSIZE; idx++) {
     struct mid_entry *tmp_list = mid_set[idx].next;
@@ -586,7 +669,8 @@ olsr_input_mid(union olsr_message *m, struct interface *in_if __attribute__ ((un
    */
 
   if (check_neighbor_link(from_addr) != SYM_LINK) {
-    OLSR_PRINTF(2, "Received MID from NON SYM neighbor %s\n", olsr_ip_to_string(&buf, from_addr));
+    OLSR_TRACE_PRINTF(2, TRACE_MID_NONSYM, from_addr, NULL, 0, 0, "Received MID from NON SYM neighbor %s\n",
+                      olsr_ip_to_string(&buf, from_addr));
     olsr_free_mid_packet(&message);
     return false;
   }
@@ -611,8 +695,10 @@ olsr_input_mid(union olsr_message *m, struct interface *in_if __attribute__ ((un
     }
 #endif
     if (!mid_lookup_main_addr(&tmp_adr->alias_addr)) {
-      OLSR_PRINTF(1, "MID new: (%s, ", olsr_ip_to_string(&buf, &message.mid_origaddr));
-      OLSR_PRINTF(1, "%s)\n", olsr_ip_to_string(&buf, &tmp_adr->alias_addr));
+      if (!OLSR_TRACE(1, TRACE_MID_NEW, &message.mid_origaddr, &tmp_adr->alias_addr, 0, 0)) {
+        OLSR_PRINTF(1, "MID new: (%s, ", olsr_ip_to_string(&buf, &message.mid_origaddr));
+        OLSR_PRINTF(1, "%s)\n", olsr_ip_to_string(&buf, &tmp_adr->alias_addr));
+      }
       insert_mid_alias(&message.mid_origaddr, &tmp_adr->alias_addr, message.vtime);
     } else {
       olsr_insert_routing_table(&tmp_adr->alias_addr, olsr_cnf->maxplen, &message.mid_origaddr, OLSR_RT_ORIGIN_MID);
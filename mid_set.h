@@ -46,6 +46,7 @@
 #include "hashing.h"
 #include "mantissa.h"
 #include "packet.h"
+#include "olsr_cookie.h"
 
 struct mid_address {
   union olsr_ip_addr alias;
@@ -71,9 +72,30 @@ struct mid_entry {
 
 #define OLSR_MID_JITTER 5       /* percent */
 
+/*
+ * Counting bloom filter in front of reverse_mid_set. Most addresses
+ * passed to mid_lookup_main_addr() are no alias at all, the filter
+ * answers those without walking a hash chain.
+ */
+#define MID_FILTER_BITS 11
+#define MID_FILTER_SIZE (1 << MID_FILTER_BITS)
+#define MID_FILTER_MASK (MID_FILTER_SIZE - 1)
+
+struct mid_filter_stats {
+  uint32_t lookups;                    /* calls to mid_lookup_main_addr() */
+  uint32_t filtered;                   /* answered by the filter, no chain walk */
+  uint32_t false_positives;            /* chain walked without a match */
+};
+
+extern struct mid_filter_stats mid_filter_stats;
+
 extern struct mid_entry mid_set[HASHSIZE];
 extern struct mid_address reverse_mid_set[HASHSIZE];
 
+extern struct olsr_cookie_info *mid_entry_mem_cookie;
+extern struct olsr_cookie_info *mid_address_mem_cookie;
+extern struct olsr_cookie_info *mid_alias_mem_cookie;
+
 int olsr_init_mid_set(void);
 void olsr_delete_all_mid_entries(void);
 void olsr_cleanup_mid(union olsr_ip_addr *);
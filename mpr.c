@@ -52,361 +52,723 @@
  * Prototypes for internal functions
  */
 
-static uint16_t add_will_always_nodes(void);
-
 static void olsr_optimize_mpr_set(void);
 
 static void olsr_clear_mprs(void);
 
-static void olsr_clear_two_hop_processed(void);
-
-static struct neighbor_entry *olsr_find_maximum_covered(int);
-
-static uint16_t olsr_calculate_two_hop_neighbors(void);
-
 static int olsr_check_mpr_changes(void);
 
-static int olsr_chosen_mpr(struct neighbor_entry *, uint16_t *);
-
-static struct neighbor_2_list_entry *olsr_find_2_hop_neighbors_with_1_link(int);
-
 /* End:
  * Prototypes for internal functions
  */
 
 /**
- *Find all 2 hop neighbors with 1 link
- *connecting them to us trough neighbors
- *with a given willingness.
- *
- *@param willingness the willigness of the neighbors
- *
- *@return a linked list of allocated neighbor_2_list_entry structures
+ *Remove all MPR registrations
  */
-static struct neighbor_2_list_entry *//:Ҵһӵھӽڵ
-//ھӽڵ  two _ hop _temp,two _ hop _list  ǰ
-//Ϊķֵ dup _ neighbor¼ھӽڵ㼯Ѿڵھӽ
-//㣬two _ hop _ neighbor¼һھӽڵľֲ
-
-olsr_find_2_hop_neighbors_with_1_link(int willingness)
+static void//ãѡΪMPRڵļ¼
+olsr_clear_mprs(void)
 {
+  struct neighbor_entry *a_neighbor;
 
-  uint8_t idx;
-  struct neighbor_2_list_entry *two_hop_list_tmp = NULL;
-  struct neighbor_2_list_entry *two_hop_list = NULL;
-  struct neighbor_entry *dup_neighbor;
-  struct neighbor_2_entry *two_hop_neighbor = NULL;
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
 
-  for (idx = 0; idx < HASHSIZE; idx++) {
+    /* Clear MPR selection. */
+    if (a_neighbor->is_mpr) {
+      a_neighbor->was_mpr = true;
+      a_neighbor->is_mpr = false;
+    }//ڵa _ neighboris  _ mprֵΪĻôͽΪ٣
+//䲻 MPRڵ㣬ͬʱ was _mprΪ棬ھӽڵѡΪ
+//MPR
 
-    for (two_hop_neighbor = two_hop_neighbortable[idx].next; two_hop_neighbor != &two_hop_neighbortable[idx];
-         two_hop_neighbor = two_hop_neighbor->next) {
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+}
 
-      //two_hop_neighbor->neighbor_2_state=0;
-      //two_hop_neighbor->mpr_covered_count = 0;
+/**
+ *Check for changes in the MPR set
+ *
+ *@return 1 if changes occured 0 if not
+ */
+static int
+olsr_check_mpr_changes(void)//ͨеMPRڵ㣬ֵ1ʱڵǷMPR
+//״̬仯0ûз仯
 
-      dup_neighbor = olsr_lookup_neighbor_table(&two_hop_neighbor->neighbor_2_addr);
+{
+  struct neighbor_entry *a_neighbor;
+  int retval;
+
+  retval = 0;
 
-      if ((dup_neighbor != NULL) && (dup_neighbor->status != NOT_SYM)) {
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
 
-        //OLSR_PRINTF(1, "(1)Skipping 2h neighbor %s - already 1hop\n", olsr_ip_to_string(&buf, &two_hop_neighbor->neighbor_2_addr));
+    if (a_neighbor->was_mpr) {
+      a_neighbor->was_mpr = false;
+
+      if (!a_neighbor->is_mpr) {
+        retval = 1;//ھӽڵa _ neighborMPRֲ
+//MPRô˵MPR״̬仯retvalΪ1򷵻retvalĬ
+//ֵ0
 
-        continue;//ھӱtwo _ hop _ neighbortable
       }
+    }
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
 
-      if (two_hop_neighbor->neighbor_2_pointer == 1) {
-        if ((two_hop_neighbor->neighbor_2_nblist.next->neighbor->willingness == willingness)
-            && (two_hop_neighbor->neighbor_2_nblist.next->neighbor->status == SYM)) {
-          two_hop_list_tmp = olsr_malloc(sizeof(struct neighbor_2_list_entry), "MPR two hop list");//ѰھӱѾڵھӵַneighbor _ 2 _ addr
+  return retval;
+}
 
-          //OLSR_PRINTF(1, "ONE LINK ADDING %s\n", olsr_ip_to_string(&buf, &two_hop_neighbor->neighbor_2_addr));//ڣҸھӽڵ뱾ڵ㲻ǷǶԳƵĽڵԣ
+/*
+ * Incremental MPR maintenance.
+ *
+ * Changes of the 2 hop neighborhood (new or lost 2 hop links, new
+ * path costs) only queue the affected 2 hop neighbors on
+ * mpr_dirty_list. The next MPR calculation then re-evaluates just
+ * these and their 1 hop neighbors. Changes of the 1 hop neighbors
+ * (status, willingness, link costs, MID aliases) still request a
+ * full recalculation.
+ */
+struct list_node mpr_dirty_list = { &mpr_dirty_list, &mpr_dirty_list };
 
-          /* Only queue one way here */
-          two_hop_list_tmp->neighbor_2 = two_hop_neighbor;
+static bool mpr_incremental = false;
+static bool mpr_full_pending = true;
 
-          two_hop_list_tmp->next = two_hop_list;
+/**
+ *Enable or disable the incremental MPR update
+ *
+ *@param enable true to only re-evaluate changed 2 hop neighbors
+ */
+void
+olsr_set_mpr_incremental(bool enable)
+{
+  mpr_incremental = enable;
+  mpr_full_pending = true;
+}
 
-          two_hop_list = two_hop_list_tmp;
-        }
-      }
+/**
+ *Request a full MPR recalculation on the next run
+ */
+void
+olsr_mpr_request_full(void)
+{
+  mpr_full_pending = true;
+}
 
-    }
+/**
+ *Queue a 2 hop neighbor for the next incremental MPR update
+ *
+ *@param nbr2 the 2 hop neighbor whose links or costs changed
+ */
+void
+olsr_mpr_changed_2hop(struct neighbor_2_entry *nbr2)
+{
+  if (!mpr_incremental || mpr_full_pending || list_node_on_list(&nbr2->mpr_dirty_node)) {
+    return;
+  }
+  list_add_before(&mpr_dirty_list, &nbr2->mpr_dirty_node);
+}
 
+/**
+ *Remove a 2 hop neighbor which is about to be freed
+ *from the incremental MPR update
+ *
+ *@param nbr2 the 2 hop neighbor
+ */
+void
+olsr_mpr_forget_2hop(struct neighbor_2_entry *nbr2)
+{
+  if (list_node_on_list(&nbr2->mpr_dirty_node)) {
+    list_remove(&nbr2->mpr_dirty_node);
   }
+}
 
-  return (two_hop_list_tmp);//ڲҸھӽڵֻһھӽڵ㣬ô
-//ھӽڵӵھӽڵtwo _ hop _listС
+/**
+ *Check if the next MPR calculation has to recalculate
+ *the whole MPR set
+ *
+ *@return true for a full recalculation, false if the
+ *dirty 2 hop neighbors are enough
+ */
+bool
+olsr_mpr_need_full(void)
+{
+  return !mpr_incremental || mpr_full_pending;
+}
 
+/**
+ *Called after a full MPR recalculation, empties the
+ *queue of dirty 2 hop neighbors
+ */
+void
+olsr_mpr_full_done(void)
+{
+  while (!list_is_empty(&mpr_dirty_list)) {
+    list_remove(mpr_dirty_list.next);
+  }
+  mpr_full_pending = false;
 }
 
 /**
- *This function processes the chosen MPRs and updates the counters
- *used in calculations
+ *Check if a 2 hop neighbor is not a symmetric 1 hop neighbor
+ *at the same time and so has to be covered by the MPRs
  */
-static int//ܣѾѡMPRڵ㣬ԼMPRļʱĸ£
-//ķֵһھMPR
+static bool
+olsr_is_strict_2hop(const struct neighbor_2_entry *nbr2)
+{
+  struct neighbor_entry *dup_neighbor = olsr_lookup_neighbor_table(&nbr2->neighbor_2_addr);
+
+  return dup_neighbor == NULL || dup_neighbor->status != SYM;
+}
 
-olsr_chosen_mpr(struct neighbor_entry *one_hop_neighbor, uint16_t * two_hop_covered_count)
+/**
+ *Set or clear the MPR status of a neighbor and update the
+ *coverage count of its 2 hop neighbors
+ */
+static void
+olsr_mpr_set_status(struct neighbor_entry *nbr, bool is_mpr)
 {
-  struct neighbor_list_entry *the_one_hop_list;
-  struct neighbor_2_list_entry *second_hop_entries;
-  struct neighbor_entry *dup_neighbor;
-  uint16_t count;
-  struct ipaddr_str buf;
-  count = *two_hop_covered_count;
+  struct neighbor_2_list_entry *two_hop_list;
 
-  OLSR_PRINTF(1, "Setting %s as MPR\n", olsr_ip_to_string(&buf, &one_hop_neighbor->neighbor_main_addr));
+  nbr->is_mpr = is_mpr;
 
-  //printf("PRE COUNT: %d\n\n", count);
+  for (two_hop_list = nbr->neighbor_2_list.next; two_hop_list != &nbr->neighbor_2_list; two_hop_list = two_hop_list->next) {
+    if (!olsr_is_strict_2hop(two_hop_list->neighbor_2)) {
+      continue;
+    }
+    if (is_mpr) {
+      two_hop_list->neighbor_2->mpr_covered_count++;
+    } else if (two_hop_list->neighbor_2->mpr_covered_count > 0) {
+      two_hop_list->neighbor_2->mpr_covered_count--;
+    }
+  }
+}
 
-  one_hop_neighbor->is_mpr = true;      //NBS_MPR;
+/**
+ *Recount the MPR coverage of all 2 hop neighbors
+ *after a full recalculation
+ */
+static void
+olsr_mpr_recount(void)
+{
+  struct neighbor_entry *a_neighbor;
+  struct neighbor_2_list_entry *two_hop_list;
 
-  for (second_hop_entries = one_hop_neighbor->neighbor_2_list.next; second_hop_entries != &one_hop_neighbor->neighbor_2_list;//second  _ hop _entriesб
-       second_hop_entries = second_hop_entries->next) {
-    dup_neighbor = olsr_lookup_neighbor_table(&second_hop_entries->neighbor_2->neighbor_2_addr);
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
+         two_hop_list = two_hop_list->next) {
+      two_hop_list->neighbor_2->mpr_covered_count = 0;
+    }
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
 
-    if ((dup_neighbor != NULL) && (dup_neighbor->status == SYM)) {
-      //OLSR_PRINTF(7, "(2)Skipping 2h neighbor %s - already 1hop\n", olsr_ip_to_string(&buf, &second_hop_entries->neighbor_2->neighbor_2_addr));
-      continue;
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    if (a_neighbor->is_mpr && a_neighbor->status == SYM) {
+      olsr_mpr_set_status(a_neighbor, true);
     }
-    //      if(!second_hop_entries->neighbor_2->neighbor_2_state)
-    //if(second_hop_entries->neighbor_2->mpr_covered_count < olsr_cnf->mpr_coverage)
-    //{
-    /*
-       Now the neighbor is covered by this mpr
-     */
-    second_hop_entries->neighbor_2->mpr_covered_count++;
-    the_one_hop_list = second_hop_entries->neighbor_2->neighbor_2_nblist.next;//ѾڵھӽڵĽڵԣ
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+}
 
-    //OLSR_PRINTF(1, "[%s](%x) has coverage %d\n", olsr_ip_to_string(&buf, &second_hop_entries->neighbor_2->neighbor_2_addr), second_hop_entries->neighbor_2, second_hop_entries->neighbor_2->mpr_covered_count);
-//ھӽڵ㱻ǵMPRmpr   _covered  _count
-//1ͬʱھӽڵھӽڵ㸳the _one _ hop _list
+/**
+ *Find the best additional MPR for a 2 hop neighbor: the one
+ *with the highest willingness, then the one covering the most
+ *2 hop neighbors which are not yet covered enough.
+ *
+ *@return the neighbor or NULL if there is no candidate left
+ */
+static struct neighbor_entry *
+olsr_find_mpr_candidate(struct neighbor_2_entry *nbr2)
+{
+  struct neighbor_list_entry *walker;
+  struct neighbor_entry *candidate = NULL;
+  int maximum = 0;
 
-    if (second_hop_entries->neighbor_2->mpr_covered_count >= olsr_cnf->mpr_coverage)
-      count++;
+  for (walker = nbr2->neighbor_2_nblist.next; walker != &nbr2->neighbor_2_nblist; walker = walker->next) {
+    struct neighbor_entry *nbr = walker->neighbor;
+    struct neighbor_2_list_entry *two_hop_list;
+    int uncovered = 0;
 
-    while (the_one_hop_list != &second_hop_entries->neighbor_2->neighbor_2_nblist) {
-		//ڵ MPRȫֱ  mpr _coverage
-//ôҪcount1
-//󷵻countֵ
+    if (nbr->is_mpr || nbr->status != SYM || nbr->willingness == WILL_NEVER) {
+      continue;
+    }
+    if (candidate != NULL && nbr->willingness < candidate->willingness) {
+      continue;
+    }
 
-      if ((the_one_hop_list->neighbor->status == SYM)) {
-        if (second_hop_entries->neighbor_2->mpr_covered_count >= olsr_cnf->mpr_coverage) {
-          the_one_hop_list->neighbor->neighbor_2_nocov--;
-        }
+    for (two_hop_list = nbr->neighbor_2_list.next; two_hop_list != &nbr->neighbor_2_list; two_hop_list = two_hop_list->next) {
+      if (two_hop_list->neighbor_2->mpr_covered_count < olsr_cnf->mpr_coverage && olsr_is_strict_2hop(two_hop_list->neighbor_2)) {
+        uncovered++;
       }
-      the_one_hop_list = the_one_hop_list->next;
     }
 
-    //}
+    if (candidate == NULL || nbr->willingness > candidate->willingness || uncovered > maximum) {
+      candidate = nbr;
+      maximum = uncovered;
+    }
   }
+  return candidate;
+}
 
-  //printf("POST COUNT %d\n\n", count);
-
-  *two_hop_covered_count = count;
-  return count;
+/**
+ *Check if all 2 hop neighbors of an MPR are covered
+ *by enough other MPRs (RFC3626 section 8.3.1 point 5)
+ */
+static bool
+olsr_mpr_redundant(struct neighbor_entry *nbr)
+{
+  struct neighbor_2_list_entry *two_hop_list;
 
+  for (two_hop_list = nbr->neighbor_2_list.next; two_hop_list != &nbr->neighbor_2_list; two_hop_list = two_hop_list->next) {
+    if (two_hop_list->neighbor_2->mpr_covered_count <= olsr_cnf->mpr_coverage && olsr_is_strict_2hop(two_hop_list->neighbor_2)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 /**
- *Find the neighbor that covers the most 2 hop neighbors
- *with a given willingness
- *
- *@param willingness the willingness of the neighbor
- *
- *@return a pointer to the neighbor_entry struct
+ *Update the MPR set for the 2 hop neighbors queued on
+ *mpr_dirty_list only. Missing coverage is repaired by adding
+ *MPRs, MPRs next to the changed 2 hop neighbors that are no
+ *longer needed are removed again.
  */
-static struct neighbor_entry *//ҵܹǵڵMPR
-olsr_find_maximum_covered(int willingness)
+static void
+olsr_update_mpr_set(void)
 {
-  uint16_t maximum;
-  struct neighbor_entry *a_neighbor;
-  struct neighbor_entry *mpr_candidate = NULL;
+  struct neighbor_2_entry *nbr2;
+  struct neighbor_list_entry *walker;
+  bool changes = false;
 
-  maximum = 0;
+  OLSR_PRINTF(3, "\n**UPDATING MPR**\n\n");
 
-  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES(nbr2) {
+    nbr2->mpr_covered_count = 0;
 
-#if 0
-    printf("[%s] nocov: %d mpr: %d will: %d max: %d\n\n", olsr_ip_to_string(&buf, &a_neighbor->neighbor_main_addr),
-           a_neighbor->neighbor_2_nocov, a_neighbor->is_mpr, a_neighbor->willingness, maximum);
-#endif
+    if (!olsr_is_strict_2hop(nbr2)) {
+      continue;
+    }
 
-    if ((!a_neighbor->is_mpr) && (a_neighbor->willingness == willingness) && (maximum < a_neighbor->neighbor_2_nocov)) {
-	//a _ neighborMPRͬʱڵֵmaximum
-//С a _ neighborھӽڵĸýڵô   maximumֵ£ҽ
-//a _ neighborΪѡMPRڵ㡣
+    for (walker = nbr2->neighbor_2_nblist.next; walker != &nbr2->neighbor_2_nblist; walker = walker->next) {
+      if (walker->neighbor->is_mpr && walker->neighbor->status == SYM) {
+        nbr2->mpr_covered_count++;
+      }
+    }
 
-      maximum = a_neighbor->neighbor_2_nocov;
-      mpr_candidate = a_neighbor;
+    while (nbr2->mpr_covered_count < olsr_cnf->mpr_coverage) {
+      struct neighbor_entry *candidate = olsr_find_mpr_candidate(nbr2);
+      struct ipaddr_str buf;
+
+      if (candidate == NULL) {
+        break;
+      }
+      OLSR_PRINTF(1, "Setting %s as MPR\n", olsr_ip_to_string(&buf, &candidate->neighbor_main_addr));
+      olsr_mpr_set_status(candidate, true);
+      changes = true;
     }
   }
-  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES_END(nbr2);
 
-  return mpr_candidate;
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES(nbr2) {
+    for (walker = nbr2->neighbor_2_nblist.next; walker != &nbr2->neighbor_2_nblist; walker = walker->next) {
+      struct neighbor_entry *nbr = walker->neighbor;
+
+      if (nbr->is_mpr && nbr->willingness != WILL_ALWAYS && olsr_mpr_redundant(nbr)) {
+        struct ipaddr_str buf;
+        OLSR_PRINTF(3, "MPR OPTIMIZE: removing mpr %s\n\n", olsr_ip_to_string(&buf, &nbr->neighbor_main_addr));
+        olsr_mpr_set_status(nbr, false);
+        changes = true;
+      }
+    }
+  }
+  OLSR_FOR_ALL_MPR_DIRTY_ENTRIES_END(nbr2);
+
+  while (!list_is_empty(&mpr_dirty_list)) {
+    list_remove(mpr_dirty_list.next);
+  }
+
+  if (changes) {
+    OLSR_PRINTF(3, "CHANGES IN MPR SET\n");
+    if (olsr_cnf->tc_redundancy > 0)
+      signal_link_changes(true);
+  }
 }
 
+#ifdef MPR_VALIDATE
 /**
- *Remove all MPR registrations
+ *Compare the incrementally maintained MPR set with a full
+ *recalculation. Differences are logged, the result of the
+ *full recalculation is kept.
+ *
+ *@param recalc the full MPR calculation
+ *@param exact true if both sets have to be equal, false if
+ *the incremental set only has to cover all 2 hop neighbors
  */
-static void//ãѡΪMPRڵļ¼
-olsr_clear_mprs(void)
+void
+olsr_validate_mpr_set(void (*recalc) (void), bool exact)
 {
   struct neighbor_entry *a_neighbor;
-  struct neighbor_2_list_entry *two_hop_list;
+  struct ipaddr_str buf;
+  bool *incremental;
+  int count = 0, idx = 0, errors = 0;
 
   OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    count++;
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
 
-    /* Clear MPR selection. */
-    if (a_neighbor->is_mpr) {
-      a_neighbor->was_mpr = true;
-      a_neighbor->is_mpr = false;
-    }//ڵa _ neighboris  _ mprֵΪĻôͽΪ٣
-//䲻 MPRڵ㣬ͬʱ was _mprΪ棬ھӽڵѡΪ
-//MPR
+  incremental = olsr_malloc(sizeof(bool) * (count + 1), "MPR validation");
+
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    struct neighbor_2_list_entry *two_hop_list;
 
+    incremental[idx++] = a_neighbor->is_mpr;
+
+    if (exact || a_neighbor->status != SYM || a_neighbor->willingness == WILL_NEVER) {
+      continue;
+    }
 
-    /* Clear two hop neighbors coverage count/ */
+    /* every 2 hop neighbor reachable through a willing neighbor needs an MPR */
     for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
          two_hop_list = two_hop_list->next) {
-      two_hop_list->neighbor_2->mpr_covered_count = 0;
-    }//ھӽڵa _ neighborǵھӽڵΪ0
-
+      if (two_hop_list->neighbor_2->mpr_covered_count == 0 && olsr_is_strict_2hop(two_hop_list->neighbor_2)) {
+        OLSR_PRINTF(1, "MPR VALIDATE: %s not covered\n", olsr_ip_to_string(&buf, &two_hop_list->neighbor_2->neighbor_2_addr));
+        errors++;
+      }
+    }
   }
   OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+
+  olsr_mpr_request_full();
+  recalc();
+
+  if (exact) {
+    idx = 0;
+    OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+      if (incremental[idx++] != a_neighbor->is_mpr) {
+        OLSR_PRINTF(1, "MPR VALIDATE: %s is %san MPR\n", olsr_ip_to_string(&buf, &a_neighbor->neighbor_main_addr),
+                    a_neighbor->is_mpr ? "" : "not ");
+        errors++;
+      }
+    }
+    OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+  }
+
+  if (errors) {
+    OLSR_PRINTF(1, "MPR VALIDATE: %d errors\n", errors);
+  }
+  free(incremental);
+}
+#endif
+
+/*
+ * Greedy MPR selection (RFC3626 section 8.3.1).
+ *
+ * The 2 hop neighbors which need coverage get a compact id and every
+ * candidate keeps the 2 hop neighbors it covers as a bitset over these
+ * ids, so the gain of a candidate is a popcount of its bitset and the
+ * set of 2 hop neighbors not covered enough yet. Gains can only shrink
+ * while MPRs are added, so the candidates of a willingness are kept in
+ * a bucket queue by gain and are re-evaluated lazily when they come
+ * out on top.
+ */
+#define MPR_WORD_BITS 32
+
+struct mpr_candidate {
+  struct neighbor_entry *neighbor;
+  uint32_t *covers;                    /* bitset of covered 2 hop ids */
+  int next;                            /* next candidate in the same bucket */
+};
+
+struct mpr_selection {
+  struct neighbor_2_entry **nbr2;      /* 2 hop neighbor by id */
+  uint32_t *uncovered;                 /* ids covered less than mpr_coverage times */
+  int words;
+  struct mpr_candidate *cand;
+  uint32_t *covers;                    /* bitsets of all candidates */
+  int cand_count;
+  int *bucket;                         /* first candidate by gain */
+  int max_gain;
+};
+
+static inline int
+olsr_mpr_popcount(uint32_t bits)
+{
+#ifdef __GNUC__
+  return __builtin_popcount(bits);
+#else
+  int count = 0;
+  for (; bits; bits &= bits - 1)
+    count++;
+  return count;
+#endif
+}
+
+static inline int
+olsr_mpr_lowest_bit(uint32_t bits)
+{
+#ifdef __GNUC__
+  return __builtin_ctz(bits);
+#else
+  int bit = 0;
+  for (; !(bits & 1); bits >>= 1)
+    bit++;
+  return bit;
+#endif
 }
 
 /**
- *Check for changes in the MPR set
+ *Number the 2 hop neighbors which need coverage and build the
+ *coverage bitsets of all symmetric neighbors willing to forward
  *
- *@return 1 if changes occured 0 if not
+ *@return the number of 2 hop neighbors which need coverage
  */
 static int
-olsr_check_mpr_changes(void)//ͨеMPRڵ㣬ֵ1ʱڵǷMPR
-//״̬仯0ûз仯
-
+olsr_mpr_init_selection(struct mpr_selection *sel)
 {
   struct neighbor_entry *a_neighbor;
-  int retval;
+  struct neighbor_2_list_entry *two_hop_list;
+  struct neighbor_2_entry *nbr2;
+  int idx, count = 0;
 
-  retval = 0;
+  for (idx = 0; idx < HASHSIZE; idx++) {
+    for (nbr2 = two_hop_neighbortable[idx].next; nbr2 != &two_hop_neighbortable[idx]; nbr2 = nbr2->next) {
+      nbr2->mpr_id = olsr_is_strict_2hop(nbr2) ? count++ : -1;
+      nbr2->mpr_covered_count = 0;
+    }
+  }
+
+  sel->words = (count + MPR_WORD_BITS - 1) / MPR_WORD_BITS;
+  sel->nbr2 = olsr_malloc(sizeof(*sel->nbr2) * (count + 1), "MPR 2 hop ids");
+  sel->uncovered = olsr_malloc(sizeof(uint32_t) * (sel->words + 1), "MPR coverage");
+  sel->bucket = olsr_malloc(sizeof(int) * (count + 1), "MPR buckets");
+
+  for (idx = 0; idx < HASHSIZE; idx++) {
+    for (nbr2 = two_hop_neighbortable[idx].next; nbr2 != &two_hop_neighbortable[idx]; nbr2 = nbr2->next) {
+      if (nbr2->mpr_id >= 0) {
+        sel->nbr2[nbr2->mpr_id] = nbr2;
+        sel->uncovered[nbr2->mpr_id / MPR_WORD_BITS] |= 1u << (nbr2->mpr_id % MPR_WORD_BITS);
+      }
+    }
+  }
 
+  sel->cand_count = 0;
   OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    a_neighbor->mpr_candidate = -1;
+    if (a_neighbor->status == SYM && a_neighbor->willingness != WILL_NEVER) {
+      a_neighbor->mpr_candidate = sel->cand_count++;
+    }
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
 
-    if (a_neighbor->was_mpr) {
-      a_neighbor->was_mpr = false;
+  sel->cand = olsr_malloc(sizeof(struct mpr_candidate) * (sel->cand_count + 1), "MPR candidates");
+  sel->covers = olsr_malloc(sizeof(uint32_t) * (sel->words * sel->cand_count + 1), "MPR candidate coverage");
 
-      if (!a_neighbor->is_mpr) {
-        retval = 1;//ھӽڵa _ neighborMPRֲ
-//MPRô˵MPR״̬仯retvalΪ1򷵻retvalĬ
-//ֵ0
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    struct mpr_candidate *cand;
 
+    if (a_neighbor->mpr_candidate < 0) {
+      continue;
+    }
+    cand = &sel->cand[a_neighbor->mpr_candidate];
+    cand->neighbor = a_neighbor;
+    cand->covers = sel->covers + a_neighbor->mpr_candidate * sel->words;
+
+    for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
+         two_hop_list = two_hop_list->next) {
+      int id = two_hop_list->neighbor_2->mpr_id;
+      if (id >= 0) {
+        cand->covers[id / MPR_WORD_BITS] |= 1u << (id % MPR_WORD_BITS);
       }
     }
   }
   OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
 
-  return retval;
+  return count;
+}
+
+static void
+olsr_mpr_free_selection(struct mpr_selection *sel)
+{
+  free(sel->covers);
+  free(sel->cand);
+  free(sel->bucket);
+  free(sel->uncovered);
+  free(sel->nbr2);
 }
 
 /**
- *Clears out proccess registration
- *on two hop neighbors
+ *Number of 2 hop neighbors a candidate would cover
+ *which are not covered enough yet
+ */
+static int
+olsr_mpr_gain(const struct mpr_selection *sel, const struct mpr_candidate *cand)
+{
+  int w, gain = 0;
+
+  for (w = 0; w < sel->words; w++) {
+    gain += olsr_mpr_popcount(cand->covers[w] & sel->uncovered[w]);
+  }
+  return gain;
+}
+
+/**
+ *Select a candidate as MPR and update the coverage
+ *of its 2 hop neighbors
  */
 static void
-olsr_clear_two_hop_processed(void)
+olsr_mpr_choose(struct mpr_selection *sel, struct mpr_candidate *cand)
 {
-  int idx;
+  struct ipaddr_str buf;
+  int w;
 
-  for (idx = 0; idx < HASHSIZE; idx++) {
-    struct neighbor_2_entry *neighbor_2;
-    for (neighbor_2 = two_hop_neighbortable[idx].next; neighbor_2 != &two_hop_neighbortable[idx]; neighbor_2 = neighbor_2->next) {
-      /* Clear */
-      neighbor_2->processed = 0;
+  OLSR_PRINTF(1, "Setting %s as MPR\n", olsr_ip_to_string(&buf, &cand->neighbor->neighbor_main_addr));
+
+  cand->neighbor->is_mpr = true;
+
+  for (w = 0; w < sel->words; w++) {
+    uint32_t bits = cand->covers[w];
+    uint32_t reached = 0;
+
+    while (bits) {
+      int bit = olsr_mpr_lowest_bit(bits);
+      bits &= bits - 1;
+
+      if (++sel->nbr2[w * MPR_WORD_BITS + bit]->mpr_covered_count == olsr_cnf->mpr_coverage) {
+        reached |= 1u << bit;
+      }
     }
+    sel->uncovered[w] &= ~reached;
   }
+}
 
+static void
+olsr_mpr_push(struct mpr_selection *sel, int c, int gain)
+{
+  sel->cand[c].next = sel->bucket[gain];
+  sel->bucket[gain] = c;
+  if (gain > sel->max_gain) {
+    sel->max_gain = gain;
+  }
 }
 
 /**
- *This function calculates the number of two hop neighbors
+ *Take the candidate with the highest gain out of the bucket queue
+ *
+ *@return the index of the candidate, -1 if no candidate covers
+ *anything new
  */
-static uint16_t
-olsr_calculate_two_hop_neighbors(void)
+static int
+olsr_mpr_pop_best(struct mpr_selection *sel)
 {
-  struct neighbor_entry *a_neighbor, *dup_neighbor;
-  struct neighbor_2_list_entry *twohop_neighbors;
-  uint16_t count = 0;
-  uint16_t n_count = 0;
-  uint16_t sum = 0;
-
-  /* Clear 2 hop neighs */
-  olsr_clear_two_hop_processed();
-
-  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+  while (sel->max_gain > 0) {
+    int c = sel->bucket[sel->max_gain];
+    int gain;
 
-    if (a_neighbor->status == NOT_SYM) {
-      a_neighbor->neighbor_2_nocov = count;
+    if (c < 0) {
+      sel->max_gain--;
       continue;
     }
+    sel->bucket[sel->max_gain] = sel->cand[c].next;
 
-    for (twohop_neighbors = a_neighbor->neighbor_2_list.next; twohop_neighbors != &a_neighbor->neighbor_2_list;
-         twohop_neighbors = twohop_neighbors->next) {
+    /* the queued gain is an upper bound, check the real one */
+    gain = olsr_mpr_gain(sel, &sel->cand[c]);
+    if (gain == sel->max_gain) {
+      return c;
+    }
+    if (gain > 0) {
+      olsr_mpr_push(sel, c, gain);
+    }
+  }
+  return -1;
+}
 
-      dup_neighbor = olsr_lookup_neighbor_table(&twohop_neighbors->neighbor_2->neighbor_2_addr);
+/**
+ *Select the MPRs among the neighbors of one willingness
+ *
+ *@param sel the selection state
+ *@param willingness the willingness of the candidates
+ *@param count the number of 2 hop ids
+ */
+static void
+olsr_mpr_select_willingness(struct mpr_selection *sel, int willingness, int count)
+{
+  int w, c;
 
-      if ((dup_neighbor == NULL) || (dup_neighbor->status != SYM)) {
-        n_count++;
-        if (!twohop_neighbors->neighbor_2->processed) {
-          count++;
-          twohop_neighbors->neighbor_2->processed = 1;
-        }
+  /* 2 hop neighbors with only one link have to use it */
+  for (w = 0; w < sel->words; w++) {
+    uint32_t bits = sel->uncovered[w];
+
+    while (bits) {
+      struct neighbor_2_entry *nbr2 = sel->nbr2[w * MPR_WORD_BITS + olsr_mpr_lowest_bit(bits)];
+      struct neighbor_entry *a_neighbor = nbr2->neighbor_2_nblist.next->neighbor;
+
+      bits &= bits - 1;
+
+      if (nbr2->neighbor_2_pointer == 1 && a_neighbor->willingness == willingness && a_neighbor->mpr_candidate >= 0
+          && !a_neighbor->is_mpr) {
+        olsr_mpr_choose(sel, &sel->cand[a_neighbor->mpr_candidate]);
       }
     }
-    a_neighbor->neighbor_2_nocov = n_count;
+  }
 
-    /* Add the two hop count */
-    sum += count;
+  /* then greedy by the number of newly covered 2 hop neighbors */
+  for (c = 0; c <= count; c++) {
+    sel->bucket[c] = -1;
+  }
+  sel->max_gain = 0;
 
+  for (c = 0; c < sel->cand_count; c++) {
+    int gain;
+
+    if (sel->cand[c].neighbor->willingness != willingness || sel->cand[c].neighbor->is_mpr) {
+      continue;
+    }
+    gain = olsr_mpr_gain(sel, &sel->cand[c]);
+    if (gain > 0) {
+      olsr_mpr_push(sel, c, gain);
+    }
   }
-  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
 
-  OLSR_PRINTF(3, "Two hop neighbors: %d\n", sum);
-  return sum;
+  while ((c = olsr_mpr_pop_best(sel)) >= 0) {
+    olsr_mpr_choose(sel, &sel->cand[c]);
+  }
 }
 
 /**
- * Adds all nodes with willingness set to WILL_ALWAYS
+ *Select the MPRs from scratch: all WILL_ALWAYS neighbors, then
+ *per willingness the neighbors covering the most 2 hop neighbors
  */
-static uint16_t//ãwillingnessΪWILL  _ ALWAYSھӽڵ㵽MPRС
-add_will_always_nodes(void)
+static void
+olsr_mpr_select(void)
 {
-  struct neighbor_entry *a_neighbor;
-  uint16_t count = 0;
+  struct mpr_selection sel;
+  int i, count;
 
-#if 0
-  printf("\nAdding WILL ALWAYS nodes....\n");
-#endif
+  memset(&sel, 0, sizeof(sel));
+  count = olsr_mpr_init_selection(&sel);
 
-  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+  OLSR_PRINTF(3, "Two hop neighbors: %d\n", count);
+
+  for (i = 0; i < sel.cand_count; i++) {
     struct ipaddr_str buf;
-    if ((a_neighbor->status == NOT_SYM) || (a_neighbor->willingness != WILL_ALWAYS)) {
+
+    if (sel.cand[i].neighbor->willingness != WILL_ALWAYS) {
       continue;
     }
-    olsr_chosen_mpr(a_neighbor, &count);
+    olsr_mpr_choose(&sel, &sel.cand[i]);
+    OLSR_PRINTF(3, "Adding WILL_ALWAYS: %s\n", olsr_ip_to_string(&buf, &sel.cand[i].neighbor->neighbor_main_addr));
+  }
 
-    OLSR_PRINTF(3, "Adding WILL_ALWAYS: %s\n", olsr_ip_to_string(&buf, &a_neighbor->neighbor_main_addr));
+  for (i = WILL_ALWAYS - 1; i > WILL_NEVER; i--) {
+    int w;
 
+    for (w = 0; w < sel.words && sel.uncovered[w] == 0; w++);
+    if (w == sel.words) {
+      break;
+    }
+    olsr_mpr_select_willingness(&sel, i, count);
   }
-  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
-
-#if 0
-  OLSR_PRINTF(1, "Count: %d\n", count);
-#endif
-  return count;//ȽǶԳƵھӽڵǲ WILL _ ALWAYSھӽڵ
-//ԣȻʣĽڵ  a _ neighborӵ mprУӽڵ
-//count
 
+  olsr_mpr_free_selection(&sel);
 }
 
 /**
@@ -416,56 +778,18 @@ add_will_always_nodes(void)
 void
 olsr_calculate_mpr(void)
 {
-  uint16_t two_hop_covered_count;
-  uint16_t two_hop_count;
-  int i;
+  if (!olsr_mpr_need_full()) {
+    olsr_update_mpr_set();
+#ifdef MPR_VALIDATE
+    olsr_validate_mpr_set(olsr_calculate_mpr, false);
+#endif
+    return;
+  }
 
   OLSR_PRINTF(3, "\n**RECALCULATING MPR**\n\n");
 
   olsr_clear_mprs();
-  two_hop_count = olsr_calculate_two_hop_neighbors();
-  two_hop_covered_count = add_will_always_nodes();
-
-  /*
-   *Calculate MPRs based on WILLINGNESS
-   */
-
-  for (i = WILL_ALWAYS - 1; i > WILL_NEVER; i--) {
-    struct neighbor_entry *mprs;
-    struct neighbor_2_list_entry *two_hop_list = olsr_find_2_hop_neighbors_with_1_link(i);
-
-    while (two_hop_list != NULL) {
-      struct neighbor_2_list_entry *tmp;
-      //printf("CHOSEN FROM 1 LINK\n");
-      if (!two_hop_list->neighbor_2->neighbor_2_nblist.next->neighbor->is_mpr)
-        olsr_chosen_mpr(two_hop_list->neighbor_2->neighbor_2_nblist.next->neighbor, &two_hop_covered_count);
-      tmp = two_hop_list;
-      two_hop_list = two_hop_list->next;;
-      free(tmp);
-    }
-
-    if (two_hop_covered_count >= two_hop_count) {
-      i = WILL_NEVER;
-      break;
-    }
-    //printf("two hop covered count: %d\n", two_hop_covered_count);
-
-    while ((mprs = olsr_find_maximum_covered(i)) != NULL) {
-      //printf("CHOSEN FROM MAXCOV\n");
-      olsr_chosen_mpr(mprs, &two_hop_covered_count);
-
-      if (two_hop_covered_count >= two_hop_count) {
-        i = WILL_NEVER;
-        break;
-      }
-
-    }
-  }
-
-  /*
-     increment the mpr sequence number
-   */
-  //neighbortable.neighbor_mpr_seq++;
+  olsr_mpr_select();
 
   /* Optimize selection */
   olsr_optimize_mpr_set();
@@ -476,6 +800,10 @@ olsr_calculate_mpr(void)
       signal_link_changes(true);
   }
 
+  if (mpr_incremental) {
+    olsr_mpr_recount();
+  }
+  olsr_mpr_full_done();
 }
 
 /**
@@ -490,7 +818,7 @@ olsr_calculate_mpr(void)
 static void
 olsr_optimize_mpr_set(void)
 {
-  struct neighbor_entry *a_neighbor, *dup_neighbor;
+  struct neighbor_entry *a_neighbor;
   struct neighbor_2_list_entry *two_hop_list;
   int i, removeit;
 
@@ -512,15 +840,15 @@ olsr_optimize_mpr_set(void)
         for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
              two_hop_list = two_hop_list->next) {
 
-          dup_neighbor = olsr_lookup_neighbor_table(&two_hop_list->neighbor_2->neighbor_2_addr);
-
-          if ((dup_neighbor != NULL) && (dup_neighbor->status != NOT_SYM)) {
+          /* only 2 hop neighbors numbered by olsr_mpr_select() need coverage */
+          if (two_hop_list->neighbor_2->mpr_id < 0) {
             continue;
           }
           //printf("\t[%s] coverage %d\n", olsr_ip_to_string(&buf, &two_hop_list->neighbor_2->neighbor_2_addr), two_hop_list->neighbor_2->mpr_covered_count);
           /* Do not remove if we find a entry which need this MPR */
           if (two_hop_list->neighbor_2->mpr_covered_count <= olsr_cnf->mpr_coverage) {
             removeit = 0;
+            break;
           }
         }
 
@@ -528,6 +856,14 @@ olsr_optimize_mpr_set(void)
           struct ipaddr_str buf;
           OLSR_PRINTF(3, "MPR OPTIMIZE: removiong mpr %s\n\n", olsr_ip_to_string(&buf, &a_neighbor->neighbor_main_addr));
           a_neighbor->is_mpr = false;
+
+          /* the 2 hop neighbors lose this MPR, else the next one may be removed too */
+          for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
+               two_hop_list = two_hop_list->next) {
+            if (two_hop_list->neighbor_2->mpr_id >= 0) {
+              two_hop_list->neighbor_2->mpr_covered_count--;
+            }
+          }
         }
       }
     } OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
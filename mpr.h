@@ -42,6 +42,40 @@
 #ifndef _OLSR_MPR
 #define _OLSR_MPR
 
+#include "common/list.h"
+#include "two_hop_neighbor_table.h"
+
+/*
+ * 2 hop neighbors whose MPR coverage has to be re-evaluated
+ * by the next incremental MPR update.
+ */
+extern struct list_node mpr_dirty_list;
+
+#define OLSR_FOR_ALL_MPR_DIRTY_ENTRIES(nbr2) \
+{ \
+  struct list_node *_dirty_node; \
+  for (_dirty_node = mpr_dirty_list.next; \
+       _dirty_node != &mpr_dirty_list; \
+       _dirty_node = _dirty_node->next) { \
+    nbr2 = dirty2nbr2(_dirty_node);
+#define OLSR_FOR_ALL_MPR_DIRTY_ENTRIES_END(nbr2) }}
+
+void olsr_set_mpr_incremental(bool);
+
+void olsr_mpr_request_full(void);
+
+void olsr_mpr_changed_2hop(struct neighbor_2_entry *);
+
+void olsr_mpr_forget_2hop(struct neighbor_2_entry *);
+
+bool olsr_mpr_need_full(void);
+
+void olsr_mpr_full_done(void);
+
+#ifdef MPR_VALIDATE
+void olsr_validate_mpr_set(void (*)(void), bool);
+#endif
+
 void olsr_calculate_mpr(void);
 
 void olsr_print_mpr_set(void);
@@ -53,6 +53,8 @@
 
 struct neighbor_entry neighbortable[HASHSIZE];
 
+struct olsr_cookie_info *nbr2_list_mem_cookie = NULL;
+
 void//ܣʼھӱ
 olsr_init_neighbor_table(void)
 {
@@ -62,6 +64,9 @@ olsr_init_neighbor_table(void)
     neighbortable[i].next = &neighbortable[i];
     neighbortable[i].prev = &neighbortable[i];
   }
+
+  nbr2_list_mem_cookie = olsr_alloc_cookie("neighbor_2_list_entry", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(nbr2_list_mem_cookie, sizeof(struct neighbor_2_list_entry));
 }//ÿһھӱneighbortable  i  ʼΪָĽһڵ
 //
 
@@ -81,8 +86,11 @@ olsr_del_nbr2_list(struct neighbor_2_list_entry *nbr2_list)
   nbr2 = nbr2_list->neighbor_2;
 
   if (nbr2->neighbor_2_pointer < 1) {
+    olsr_mpr_forget_2hop(nbr2);
     DEQUEUE_ELEM(nbr2);
-    free(nbr2);//ͷھӽڵṹnbr2Ŀռ䣻
+    olsr_cookie_free(nbr2_mem_cookie, nbr2);//ͷھӽڵṹnbr2Ŀռ䣻
+  } else {
+    olsr_mpr_changed_2hop(nbr2);
   }
 
   /*
@@ -94,7 +102,7 @@ olsr_del_nbr2_list(struct neighbor_2_list_entry *nbr2_list)
   /* Dequeue */
   DEQUEUE_ELEM(nbr2_list);//ھӽڵ¼еļʱΪգ
 
-  free(nbr2_list);
+  olsr_cookie_free(nbr2_list_mem_cookie, nbr2_list);
 
   /* Set flags to recalculate the MPR set and the routing table */
   changes_neighborhood = true;
@@ -216,6 +224,7 @@ olsr_delete_neighbor_table(const union olsr_ip_addr *neighbor_addr)
 
   free(entry);
 
+  olsr_mpr_request_full();
   changes_neighborhood = true;
   return 1;
 
@@ -333,6 +342,7 @@ update_neighbor_status(struct neighbor_entry *entry, int lnk)
         olsr_delete_two_hop_neighbor_table(two_hop_neighbor);
       }
 
+      olsr_mpr_request_full();
       changes_neighborhood = true;
       changes_topology = true;
       if (olsr_cnf->tc_redundancy > 1)
@@ -346,6 +356,7 @@ update_neighbor_status(struct neighbor_entry *entry, int lnk)
 //ٺ·ɱ¡
 
     if (entry->status == SYM) {
+      olsr_mpr_request_full();
       changes_neighborhood = true;
       changes_topology = true;
       if (olsr_cnf->tc_redundancy > 1)
@@ -44,6 +44,7 @@
 
 #include "olsr_types.h"
 #include "hashing.h"
+#include "olsr_cookie.h"
 
 struct neighbor_2_list_entry {
   struct neighbor_entry *nbr2_nbr;     /* backpointer to owning nbr entry */
@@ -62,7 +63,8 @@ struct neighbor_entry {
   bool is_mpr;
   bool was_mpr;                        /* Used to detect changes in MPR */
   bool skip;
-  int neighbor_2_nocov;
+  int mpr_candidate;                   /* used in mpr calculation */
+  int mpr_refs;                        /* 2 hop neighbors selecting this MPR (LQ) */
   int linkcount;
   struct neighbor_2_list_entry neighbor_2_list;
   struct neighbor_entry *next;
@@ -82,6 +84,7 @@ struct neighbor_entry {
  * The neighbor table
  */
 extern struct neighbor_entry neighbortable[HASHSIZE];
+extern struct olsr_cookie_info *nbr2_list_mem_cookie;
 
 void olsr_init_neighbor_table(void);
 
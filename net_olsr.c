@@ -39,6 +39,10 @@
  *
  */
 
+#if defined linux && !defined _GNU_SOURCE
+#define _GNU_SOURCE                     /* sendmmsg(2) */
+#endif
+
 #include "net_olsr.h"
 #include "ipcalc.h"
 #include "log.h"
@@ -47,13 +51,112 @@
 #include "print_packet.h"
 #include "link_set.h"
 #include "lq_packet.h"
+#include "olsr_cookie.h"
+#include "scheduler.h"
+#include "olsr_metrics.h"
+#include "olsr_cpustats.h"
 
 #include <stdlib.h>
 #include <assert.h>
 #include <limits.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
 
 static bool disp_pack_out = false;
 
+/* Forward messages by reference instead of copying them */
+static bool sg_output = false;
+
+/*
+ * Refcounted buffer holding a received packet. The parser holds
+ * one reference, every output buffer segment pointing into it another one.
+ */
+struct olsr_pktbuf {
+  unsigned int refcount;
+  uint32_t data[MAXMESSAGESIZE / sizeof(uint32_t) + 1];
+};
+
+/* Memory cookie for the received packet buffers */
+static struct olsr_cookie_info *pktbuf_mem_cookie = NULL;
+
+/* The packet buffer the parser is currently receiving into */
+static struct olsr_pktbuf *rx_pktbuf = NULL;
+
+/* Queue finished packets and send them once per scheduler iteration */
+static bool tx_batching = false;
+
+/* Maximum number of packets handed to the kernel with one call */
+#define NET_TX_BATCH_MAX 32
+
+/*
+ * A finished packet waiting for the batched transmission. It takes
+ * over the buffer (and segment list) of the output buffer, which continues
+ * with the spare buffer of the packet instead.
+ */
+struct olsr_txpkt {
+  struct list_node txpkt_node;         /* txqueue or txfree membership */
+  uint8_t *buff;                       /* Packet including the OLSR header */
+  int len;                             /* Length of the packet */
+  struct olsr_netbuf_seg *segs;        /* Referenced messages */
+  int segcount;
+  struct sockaddr_storage dst;         /* Destination address */
+  socklen_t dstlen;
+};
+
+LISTNODE2STRUCT(list2txpkt, struct olsr_txpkt, txpkt_node);
+
+/* Memory cookie for the queued packets */
+static struct olsr_cookie_info *txpkt_mem_cookie = NULL;
+
+/* Transmission statistics */
+static struct net_tx_stats tx_stats;
+
+/* Output scheduler with priority classes, pacing rate in bytes per second (0 for no pacing) */
+static bool txsched_enabled = false;
+static uint32_t txsched_rate = 0;
+
+/* Maximum number of messages queued per class and interface */
+#define TXSCHED_QUEUE_MAX 64
+
+/* Depth of the token bucket, expressed in milliseconds of the rate */
+#define TXSCHED_BURST_MSEC 250
+
+/*
+ * A message waiting in a priority class of the output scheduler. Locally
+ * generated messages are copied into a packet buffer of their own, so
+ * every queued message references the buffer holding it.
+ */
+struct olsr_txmsg {
+  struct list_node txmsg_node;
+  struct olsr_pktbuf *pktbuf;          /* Packet buffer holding the message */
+  uint8_t *data;
+  uint16_t size;
+};
+
+LISTNODE2STRUCT(list2txmsg, struct olsr_txmsg, txmsg_node);
+
+/* Per interface state of the output scheduler */
+struct olsr_txsched {
+  struct list_node queue[TXCLASS_COUNT];
+  struct net_txclass_stats stats[TXCLASS_COUNT];
+  int32_t tokens;                      /* Token bucket fill in bytes, may go negative */
+  int32_t burst;                       /* Token bucket depth */
+  uint32_t last_refill;                /* Time of the last refill */
+  struct timer_entry *pacing_timer;    /* Resumes output when the bucket has refilled */
+};
+
+/* Memory cookie for the queued messages */
+static struct olsr_cookie_info *txmsg_mem_cookie = NULL;
+
+/* Timer cookie for the pacing timers */
+static struct olsr_cookie_info *txsched_timer_cookie = NULL;
+
+static void net_flush_queue(struct interface *);
+static int net_output_packet(struct interface *);
+static void net_txsched_drain(struct interface *);
+static void net_txsched_free(struct interface *);
+
 #ifdef WIN32
 #define perror(x) WinSockPError(x)
 void WinSockPError(const char *);
@@ -93,6 +196,132 @@ net_set_disp_pack_out(bool val)
   disp_pack_out = val;
 }
 
+void
+net_set_sg_output(bool val)
+{
+#ifdef WIN32
+  /* no sendmsg(2) on win32 */
+  val = false;
+#endif
+  sg_output = val;
+}
+
+/**
+ * Enable the output scheduler. Messages are queued by priority
+ * class (HELLO, own TC/MID/HNA, forwarded, plugin) and packets are
+ * filled with the highest class first.
+ *
+ * @param val true to enable the scheduler
+ * @param rate pacing rate in bytes per second, 0 for no pacing
+ */
+void
+net_set_tx_scheduler(bool val, uint32_t rate)
+{
+  txsched_enabled = val;
+  txsched_rate = rate;
+}
+
+void
+net_set_tx_batching(bool val)
+{
+#ifdef WIN32
+  /* no sendmsg(2) on win32 */
+  val = false;
+#endif
+  tx_batching = val;
+}
+
+static void
+net_pktbuf_release(struct olsr_pktbuf *pktbuf)
+{
+  if (--pktbuf->refcount == 0) {
+    olsr_cookie_free(pktbuf_mem_cookie, pktbuf);
+  }
+}
+
+/**
+ * Drop the references of all forwarded messages pending
+ * in an output buffer.
+ *
+ * @param ifp the interface corresponding to the buffer
+ */
+static void
+net_release_segments(struct interface *ifp)
+{
+  int i;
+
+  for (i = 0; i < ifp->netbuf.segcount; i++) {
+    net_pktbuf_release(ifp->netbuf.segs[i].pktbuf);
+  }
+  ifp->netbuf.segcount = 0;
+}
+
+/**
+ * Put a packet that has been sent (or failed) back on
+ * the spare list of its interface.
+ *
+ * @param ifp the interface the packet was queued on
+ * @param txpkt the packet
+ */
+static void
+net_txpkt_done(struct interface *ifp, struct olsr_txpkt *txpkt)
+{
+  int i;
+
+  for (i = 0; i < txpkt->segcount; i++) {
+    net_pktbuf_release(txpkt->segs[i].pktbuf);
+  }
+  txpkt->segcount = 0;
+
+  list_remove(&txpkt->txpkt_node);
+  list_add_before(&ifp->netbuf.txfree, &txpkt->txpkt_node);
+}
+
+/**
+ * Free all spare packets of an interface.
+ *
+ * @param ifp the interface
+ */
+static void
+net_free_txpkts(struct interface *ifp)
+{
+  while (!list_is_empty(&ifp->netbuf.txfree)) {
+    struct olsr_txpkt *txpkt = list2txpkt(ifp->netbuf.txfree.next);
+
+    list_remove(&txpkt->txpkt_node);
+    free(txpkt->buff);
+    free(txpkt->segs);
+    olsr_cookie_free(txpkt_mem_cookie, txpkt);
+  }
+}
+
+/**
+ * Return the buffer the next packet should be received into.
+ * In scatter-gather mode this is a refcounted packet buffer, a fresh
+ * one is used if forwarded messages still reference the last one.
+ *
+ * @return pointer to a buffer of at least MAXMESSAGESIZE bytes,
+ *  NULL if scatter-gather output is not used
+ */
+char *
+net_get_rxbuffer(void)
+{
+  if (!sg_output) {
+    return NULL;
+  }
+
+  if (rx_pktbuf != NULL && rx_pktbuf->refcount > 1) {
+    net_pktbuf_release(rx_pktbuf);
+    rx_pktbuf = NULL;
+  }
+
+  if (rx_pktbuf == NULL) {
+    rx_pktbuf = olsr_cookie_malloc(pktbuf_mem_cookie);
+    rx_pktbuf->refcount = 1;
+  }
+  return (char *)rx_pktbuf->data;
+}
+
 /*
  * Converts each invalid IP-address from string to network byte order
  * and adds it to the invalid list.
@@ -112,6 +341,30 @@ init_net(void)
     }
     olsr_add_invalid_address(&addr);
   }
+
+  pktbuf_mem_cookie = olsr_alloc_cookie("Packet buffer", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(pktbuf_mem_cookie, sizeof(struct olsr_pktbuf));
+
+  txpkt_mem_cookie = olsr_alloc_cookie("Queued packet", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(txpkt_mem_cookie, sizeof(struct olsr_txpkt));
+
+  txmsg_mem_cookie = olsr_alloc_cookie("Scheduled message", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(txmsg_mem_cookie, sizeof(struct olsr_txmsg));
+
+  txsched_timer_cookie = olsr_alloc_cookie("Output pacing", OLSR_COOKIE_TYPE_TIMER);
+}
+
+/**
+ * Release the receive buffer, must be called before
+ * the memory cookies are freed.
+ */
+void
+deinit_net(void)
+{
+  if (rx_pktbuf != NULL) {
+    net_pktbuf_release(rx_pktbuf);
+    rx_pktbuf = NULL;
+  }
 }
 
 /**
@@ -127,18 +380,48 @@ init_net(void)
 int
 net_add_buffer(struct interface *ifp)
 {
+  if (ifp->netbuf.txqueue.next == NULL) {
+    list_head_init(&ifp->netbuf.txqueue);
+    list_head_init(&ifp->netbuf.txfree);
+  }
+
   /* Can the interfaces MTU actually change? If not, we can elimiate
    * the "bufsize" field in "struct olsr_netbuf".
    */
   if (ifp->netbuf.bufsize != ifp->int_mtu && ifp->netbuf.buff != NULL) {
     free(ifp->netbuf.buff);
     ifp->netbuf.buff = NULL;
+
+    /* the spare buffers have the old size too */
+    net_flush_queue(ifp);
+    net_free_txpkts(ifp);
   }
 
   if (ifp->netbuf.buff == NULL) {
     ifp->netbuf.buff = olsr_malloc(ifp->int_mtu, "add_netbuff");
   }
 
+  if (txsched_enabled && ifp->netbuf.txsched == NULL) {
+    struct olsr_txsched *ts;
+    int cls;
+
+    ts = olsr_malloc(sizeof(*ts), "add_netbuff scheduler");
+    for (cls = 0; cls < TXCLASS_COUNT; cls++) {
+      list_head_init(&ts->queue[cls]);
+    }
+    ifp->netbuf.txsched = ts;
+  }
+  if (ifp->netbuf.txsched != NULL) {
+    ifp->netbuf.txsched->burst = MAX((int32_t) ((uint64_t)txsched_rate * TXSCHED_BURST_MSEC / MSEC_PER_SEC), ifp->int_mtu);
+    ifp->netbuf.txsched->tokens = ifp->netbuf.txsched->burst;
+    ifp->netbuf.txsched->last_refill = now_times;
+  }
+
+  if (sg_output && ifp->netbuf.segs == NULL) {
+    ifp->netbuf.segs = olsr_malloc(NETBUF_MAX_SEGMENTS * sizeof(struct olsr_netbuf_seg), "add_netbuff segments");
+  }
+  net_release_segments(ifp);
+
   /* Fill struct */
   ifp->netbuf.bufsize = ifp->int_mtu;
   ifp->netbuf.maxsize = ifp->int_mtu - OLSR_HEADERSIZE;
@@ -163,10 +446,19 @@ net_remove_buffer(struct interface *ifp)
   /* Flush pending data */
   if (ifp->netbuf.pending)
     net_output(ifp);
+  if (ifp->netbuf.txsched != NULL) {
+    net_txsched_drain(ifp);
+    net_txsched_free(ifp);
+  }
+  net_flush_queue(ifp);
+  net_free_txpkts(ifp);
 
   free(ifp->netbuf.buff);
   ifp->netbuf.buff = NULL;
 
+  free(ifp->netbuf.segs);
+  ifp->netbuf.segs = NULL;
+
   return 0;
 }
 
@@ -207,9 +499,305 @@ net_reserve_bufspace(struct interface *ifp, int size)
 uint16_t
 net_output_pending(const struct interface * ifp)
 {
+  if (ifp->netbuf.txsched != NULL) {
+    int cls, queued = ifp->netbuf.pending;
+
+    for (cls = 0; cls < TXCLASS_COUNT; cls++) {
+      queued += ifp->netbuf.txsched->stats[cls].bytes;
+    }
+    return MIN(queued, 0xffff);
+  }
   return ifp->netbuf.pending;
 }
 
+/**
+ * Append a referenced message to a buffer. Takes over one
+ * reference of the packet buffer. The caller has checked that
+ * there is enough room in the buffer.
+ *
+ * @param ifp the interface corresponding to the buffer
+ * @param pktbuf the receive buffer holding the message
+ * @param data a pointer to the message
+ * @param size the number of bytes of the message
+ */
+static void
+net_outbuffer_add_segment(struct interface *ifp, struct olsr_pktbuf *pktbuf, uint8_t *data, uint16_t size)
+{
+  struct olsr_netbuf_seg *seg;
+
+  if (ifp->netbuf.segcount >= NETBUF_MAX_SEGMENTS) {
+    /* no segment left, copy it after all */
+    memcpy(&ifp->netbuf.buff[ifp->netbuf.pending + OLSR_HEADERSIZE], data, size);
+    ifp->netbuf.pending += size;
+    net_pktbuf_release(pktbuf);
+    return;
+  }
+
+  seg = &ifp->netbuf.segs[ifp->netbuf.segcount++];
+  seg->pktbuf = pktbuf;
+  seg->data = data;
+  seg->offset = ifp->netbuf.pending;
+  seg->size = size;
+
+  ifp->netbuf.pending += size;
+}
+
+/**
+ * Map a message to the priority class of the output scheduler.
+ *
+ * @param data a pointer to a locally generated message
+ *
+ * @return the priority class
+ */
+static enum olsr_txclass
+net_txsched_classify(const void *data)
+{
+  switch (*(const uint8_t *)data) {
+  case HELLO_MESSAGE:
+  case LQ_HELLO_MESSAGE:
+    return TXCLASS_HELLO;
+  case TC_MESSAGE:
+  case LQ_TC_MESSAGE:
+  case MID_MESSAGE:
+  case HNA_MESSAGE:
+    return TXCLASS_OWN;
+  default:
+    return TXCLASS_PLUGIN;
+  }
+}
+
+static void
+net_txsched_dequeue(struct olsr_txsched *ts, enum olsr_txclass cls, struct olsr_txmsg *msg)
+{
+  list_remove(&msg->txmsg_node);
+  ts->stats[cls].depth--;
+  ts->stats[cls].bytes -= msg->size;
+}
+
+static void
+net_txsched_drop(struct olsr_txsched *ts, enum olsr_txclass cls, struct olsr_txmsg *msg)
+{
+  net_txsched_dequeue(ts, cls, msg);
+  ts->stats[cls].drops++;
+
+  net_pktbuf_release(msg->pktbuf);
+  olsr_cookie_free(txmsg_mem_cookie, msg);
+}
+
+/**
+ * Queue a message in a priority class of the output scheduler.
+ * If the class is full, its oldest message is dropped.
+ *
+ * @param ifp the interface to send the message on
+ * @param cls the priority class
+ * @param pktbuf receive buffer to reference the message in,
+ *  NULL to copy the message
+ * @param data a pointer to the message
+ * @param size the number of bytes of the message
+ *
+ * @return 0 if the message does not fit into a packet,
+ *  the number of bytes queued on success
+ */
+static int
+net_txsched_enqueue(struct interface *ifp, enum olsr_txclass cls, struct olsr_pktbuf *pktbuf, const void *data, uint16_t size)
+{
+  struct olsr_txsched *ts = ifp->netbuf.txsched;
+  struct olsr_txmsg *msg;
+
+  if (size > ifp->netbuf.maxsize || size > sizeof(pktbuf->data))
+    return 0;
+
+  if (ts->stats[cls].depth >= TXSCHED_QUEUE_MAX) {
+    /* a newer message is worth more than the oldest one */
+    net_txsched_drop(ts, cls, list2txmsg(ts->queue[cls].next));
+  }
+
+  msg = olsr_cookie_malloc(txmsg_mem_cookie);
+  if (pktbuf != NULL) {
+    msg->data = (uint8_t *)pktbuf->data + ((const uint8_t *)data - (const uint8_t *)pktbuf->data);
+    pktbuf->refcount++;
+  } else {
+    pktbuf = olsr_cookie_malloc(pktbuf_mem_cookie);
+    pktbuf->refcount = 1;
+    msg->data = (uint8_t *)pktbuf->data;
+    memcpy(msg->data, data, size);
+  }
+  msg->pktbuf = pktbuf;
+  msg->size = size;
+
+  list_add_before(&ts->queue[cls], &msg->txmsg_node);
+  ts->stats[cls].depth++;
+  ts->stats[cls].bytes += size;
+
+  return size;
+}
+
+/**
+ * Fill the output buffer with queued messages, highest
+ * priority class first. Within a class the order is kept,
+ * lower classes may use the space a message did not fit in.
+ *
+ * @param ifp the interface corresponding to the buffer
+ */
+static void
+net_txsched_fill(struct interface *ifp)
+{
+  struct olsr_txsched *ts = ifp->netbuf.txsched;
+  int cls;
+
+  for (cls = 0; cls < TXCLASS_COUNT; cls++) {
+    while (!list_is_empty(&ts->queue[cls])) {
+      struct olsr_txmsg *msg = list2txmsg(ts->queue[cls].next);
+
+      if (ifp->netbuf.pending + msg->size > ifp->netbuf.maxsize) {
+        break;
+      }
+
+      net_txsched_dequeue(ts, cls, msg);
+      ts->stats[cls].sent++;
+
+      if (ifp->netbuf.segs != NULL) {
+        net_outbuffer_add_segment(ifp, msg->pktbuf, msg->data, msg->size);
+      } else {
+        memcpy(&ifp->netbuf.buff[ifp->netbuf.pending + OLSR_HEADERSIZE], msg->data, msg->size);
+        ifp->netbuf.pending += msg->size;
+        net_pktbuf_release(msg->pktbuf);
+      }
+      olsr_cookie_free(txmsg_mem_cookie, msg);
+    }
+  }
+}
+
+/**
+ * Add the tokens for the time passed since the last refill.
+ *
+ * @param ts the scheduler state of an interface
+ */
+static void
+net_txsched_refill(struct olsr_txsched *ts)
+{
+  uint64_t add = (uint64_t)(now_times - ts->last_refill) * txsched_rate / MSEC_PER_SEC;
+
+  if (add == 0) {
+    return;
+  }
+  ts->tokens = (int32_t) MIN((uint64_t)ts->tokens + add, (uint64_t)ts->burst);
+  ts->last_refill = now_times;
+}
+
+static void
+net_txsched_timer(void *context)
+{
+  struct interface *ifp = context;
+
+  ifp->netbuf.txsched->pacing_timer = NULL;
+  net_output(ifp);
+}
+
+/**
+ * Send queued messages as far as the pacing rate allows.
+ * Messages which have to wait are sent when the token
+ * bucket has refilled.
+ *
+ * @param ifp the interface to send on
+ *
+ * @return negative on error
+ */
+static int
+net_output_scheduled(struct interface *ifp)
+{
+  struct olsr_txsched *ts = ifp->netbuf.txsched;
+  int retval = 0;
+
+  if (txsched_rate != 0) {
+    net_txsched_refill(ts);
+  }
+
+  for (;;) {
+    int result;
+
+    if (txsched_rate != 0 && ts->tokens <= 0) {
+      /* congested, come back when the bucket has refilled */
+      if (ts->pacing_timer == NULL) {
+        ts->pacing_timer = olsr_start_timer((uint32_t)(-ts->tokens) * MSEC_PER_SEC / txsched_rate + 1, 0,
+                                            OLSR_TIMER_ONESHOT, &net_txsched_timer, ifp, txsched_timer_cookie);
+      }
+      break;
+    }
+
+    net_txsched_fill(ifp);
+    if (!ifp->netbuf.pending) {
+      break;
+    }
+
+    ts->tokens -= ifp->netbuf.pending + OLSR_HEADERSIZE;
+
+    result = net_output_packet(ifp);
+    if (result < 0) {
+      retval = -1;
+    } else if (retval >= 0) {
+      retval += result;
+    }
+  }
+  return retval;
+}
+
+/**
+ * Send all queued messages of an interface, ignoring the
+ * pacing rate. Used before the output buffer goes away.
+ *
+ * @param ifp the interface
+ */
+static void
+net_txsched_drain(struct interface *ifp)
+{
+  for (;;) {
+    net_txsched_fill(ifp);
+    if (!ifp->netbuf.pending || net_output_packet(ifp) < 0) {
+      break;
+    }
+  }
+}
+
+/**
+ * Drop all queued messages of an interface and free the
+ * scheduler state.
+ *
+ * @param ifp the interface
+ */
+static void
+net_txsched_free(struct interface *ifp)
+{
+  struct olsr_txsched *ts = ifp->netbuf.txsched;
+  int cls;
+
+  olsr_stop_timer(ts->pacing_timer);
+  for (cls = 0; cls < TXCLASS_COUNT; cls++) {
+    while (!list_is_empty(&ts->queue[cls])) {
+      net_txsched_drop(ts, cls, list2txmsg(ts->queue[cls].next));
+    }
+  }
+  free(ts);
+  ifp->netbuf.txsched = NULL;
+}
+
+/**
+ * Get the output scheduler counters of a priority class.
+ *
+ * @param ifp the interface
+ * @param cls the priority class
+ *
+ * @return the counters, NULL if the scheduler is not used
+ */
+const struct net_txclass_stats *
+net_get_txclass_stats(const struct interface *ifp, enum olsr_txclass cls)
+{
+  if (ifp->netbuf.txsched == NULL) {
+    return NULL;
+  }
+  return &ifp->netbuf.txsched->stats[cls];
+}
+
 /**
  * Add data to a buffer.
  *
@@ -224,6 +812,10 @@ net_output_pending(const struct interface * ifp)
 int
 net_outbuffer_push(struct interface *ifp, const void *data, const uint16_t size)
 {
+  if (ifp->netbuf.txsched != NULL) {
+    return net_txsched_enqueue(ifp, net_txsched_classify(data), NULL, data, size);
+  }
+
   if ((ifp->netbuf.pending + size) > ifp->netbuf.maxsize)
     return 0;
 
@@ -256,6 +848,338 @@ net_outbuffer_push_reserved(struct interface *ifp, const void *data, const uint1
   return size;
 }
 
+/**
+ * Add a message that is forwarded to a buffer. In scatter-gather
+ * mode a message located in the current receive buffer is only
+ * referenced, net_output() sends it straight out of that buffer.
+ *
+ * @param ifp the interface corresponding to the buffer
+ * @param data a pointer to the message to add
+ * @param size the number of bytes of the message
+ *
+ * @return 0 if there was not enough room in buffer or
+ *  the number of bytes added on success
+ */
+int
+net_outbuffer_push_forward(struct interface *ifp, void *data, const uint16_t size)
+{
+  struct olsr_pktbuf *pktbuf = NULL;
+
+  /* only messages in the refcounted receive buffer can be referenced */
+  if (sg_output && rx_pktbuf != NULL) {
+    uint8_t *rx_start = (uint8_t *)rx_pktbuf->data;
+
+    if ((uint8_t *)data >= rx_start && (uint8_t *)data + size <= rx_start + sizeof(rx_pktbuf->data)) {
+      pktbuf = rx_pktbuf;
+    }
+  }
+
+  if (ifp->netbuf.txsched != NULL) {
+    return net_txsched_enqueue(ifp, TXCLASS_FORWARD, pktbuf, data, size);
+  }
+
+  if (pktbuf == NULL || ifp->netbuf.segcount >= NETBUF_MAX_SEGMENTS) {
+    return net_outbuffer_push(ifp, data, size);
+  }
+
+  if ((ifp->netbuf.pending + size) > ifp->netbuf.maxsize)
+    return 0;
+
+  pktbuf->refcount++;
+  net_outbuffer_add_segment(ifp, pktbuf, data, size);
+
+  return size;
+}
+
+/**
+ * Copy all referenced messages into their place in the buffer,
+ * so the whole packet is available in one piece.
+ *
+ * @param ifp the interface corresponding to the buffer
+ */
+static void
+net_linearize_buffer(struct interface *ifp)
+{
+  int i;
+
+  for (i = 0; i < ifp->netbuf.segcount; i++) {
+    const struct olsr_netbuf_seg *seg = &ifp->netbuf.segs[i];
+
+    memcpy(&ifp->netbuf.buff[seg->offset + OLSR_HEADERSIZE], seg->data, seg->size);
+  }
+  net_release_segments(ifp);
+}
+
+#ifndef WIN32
+/**
+ * Describe a packet as an iovec array, taking the header and the
+ * locally generated data from the buffer and the referenced messages
+ * from the packets they were received in.
+ *
+ * @param iov array of at least 2 * NETBUF_MAX_SEGMENTS + 1 entries
+ * @param buff the buffer holding the packet
+ * @param len the length of the packet (including the header)
+ * @param segs the referenced messages
+ * @param segcount number of referenced messages
+ *
+ * @return the number of iovec entries used
+ */
+static int
+net_fill_iovec(struct iovec *iov, uint8_t *buff, int len, const struct olsr_netbuf_seg *segs, int segcount)
+{
+  int i, iovcnt = 0, offset = 0;
+
+  for (i = 0; i < segcount; i++) {
+    int start = segs[i].offset + OLSR_HEADERSIZE;
+
+    /* header and locally generated data up to the segment */
+    if (start > offset) {
+      iov[iovcnt].iov_base = &buff[offset];
+      iov[iovcnt].iov_len = start - offset;
+      iovcnt++;
+    }
+    iov[iovcnt].iov_base = segs[i].data;
+    iov[iovcnt].iov_len = segs[i].size;
+    iovcnt++;
+
+    offset = start + segs[i].size;
+  }
+  if (offset < len) {
+    iov[iovcnt].iov_base = &buff[offset];
+    iov[iovcnt].iov_len = len - offset;
+    iovcnt++;
+  }
+  return iovcnt;
+}
+#endif
+
+/**
+ * Send the content of an output buffer. Referenced messages
+ * are transmitted with sendmsg(2) scatter-gather, everything
+ * else is taken from the buffer itself.
+ *
+ * @param ifp the interface corresponding to the buffer
+ * @param dst destination address
+ * @param dstlen size of the destination address
+ *
+ * @return negative on error
+ */
+static ssize_t
+net_send_buffer(struct interface *ifp, struct sockaddr *dst, socklen_t dstlen)
+{
+  ssize_t n;
+#ifndef WIN32
+  struct iovec iov[2 * NETBUF_MAX_SEGMENTS + 1];
+  struct msghdr msg;
+
+  tx_stats.packets++;
+  tx_stats.syscalls++;
+
+  if (ifp->netbuf.segcount == 0) {
+    n = olsr_sendto(ifp->send_socket, ifp->netbuf.buff, ifp->netbuf.pending, MSG_DONTROUTE, dst, dstlen);
+  } else {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = dst;
+    msg.msg_namelen = dstlen;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = net_fill_iovec(iov, ifp->netbuf.buff, ifp->netbuf.pending, ifp->netbuf.segs, ifp->netbuf.segcount);
+
+    n = sendmsg(ifp->send_socket, &msg, MSG_DONTROUTE);
+  }
+#else
+  tx_stats.packets++;
+  tx_stats.syscalls++;
+
+  net_linearize_buffer(ifp);
+  n = olsr_sendto(ifp->send_socket, ifp->netbuf.buff, ifp->netbuf.pending, MSG_DONTROUTE, dst, dstlen);
+#endif
+
+  /* the interface counters only cover packets which left the socket */
+  if (n >= 0) {
+    ifp->counters.tx_packets++;
+    ifp->counters.tx_bytes += ifp->netbuf.pending;
+  }
+  return n;
+}
+
+/**
+ * Move the content of an output buffer to the transmit queue
+ * of the interface. It is sent by the next net_output_flush().
+ *
+ * @param ifp the interface corresponding to the buffer
+ * @param dst destination address
+ * @param dstlen size of the destination address
+ */
+static void
+net_queue_buffer(struct interface *ifp, struct sockaddr *dst, socklen_t dstlen)
+{
+  struct olsr_txpkt *txpkt;
+  struct olsr_netbuf_seg *segs;
+  uint8_t *buff;
+
+  if (list_is_empty(&ifp->netbuf.txfree)) {
+    txpkt = olsr_cookie_malloc(txpkt_mem_cookie);
+    txpkt->buff = olsr_malloc(ifp->netbuf.bufsize, "tx queue buffer");
+    if (ifp->netbuf.segs != NULL) {
+      txpkt->segs = olsr_malloc(NETBUF_MAX_SEGMENTS * sizeof(struct olsr_netbuf_seg), "tx queue segments");
+    }
+    list_node_init(&txpkt->txpkt_node);
+  } else {
+    txpkt = list2txpkt(ifp->netbuf.txfree.next);
+    list_remove(&txpkt->txpkt_node);
+  }
+
+  /* swap buffers, the output buffer continues with the spare one */
+  buff = txpkt->buff;
+  segs = txpkt->segs;
+
+  txpkt->buff = ifp->netbuf.buff;
+  txpkt->len = ifp->netbuf.pending;
+  txpkt->segs = ifp->netbuf.segs;
+  txpkt->segcount = ifp->netbuf.segcount;
+  memcpy(&txpkt->dst, dst, dstlen);
+  txpkt->dstlen = dstlen;
+
+  ifp->netbuf.buff = buff;
+  ifp->netbuf.segs = segs;
+  ifp->netbuf.segcount = 0;
+
+  list_add_before(&ifp->netbuf.txqueue, &txpkt->txpkt_node);
+}
+
+/**
+ * Send all packets queued on an interface, using as few
+ * system calls as possible.
+ *
+ * @param ifp the interface
+ */
+static void
+net_flush_queue(struct interface *ifp)
+{
+#ifndef WIN32
+  static struct iovec iov[NET_TX_BATCH_MAX][2 * NETBUF_MAX_SEGMENTS + 1];
+  struct olsr_txpkt *batch[NET_TX_BATCH_MAX];
+#ifdef linux
+  struct mmsghdr msgs[NET_TX_BATCH_MAX];
+#else
+  struct msghdr msgs[NET_TX_BATCH_MAX];
+#endif
+
+  if (ifp->netbuf.txqueue.next == NULL) {
+    return;
+  }
+
+  while (!list_is_empty(&ifp->netbuf.txqueue)) {
+    struct list_node *node;
+    int i, count = 0, sent;
+
+    for (node = ifp->netbuf.txqueue.next; node != &ifp->netbuf.txqueue && count < NET_TX_BATCH_MAX; node = node->next) {
+      struct olsr_txpkt *txpkt = list2txpkt(node);
+#ifdef linux
+      struct msghdr *msg = &msgs[count].msg_hdr;
+#else
+      struct msghdr *msg = &msgs[count];
+#endif
+
+      memset(msg, 0, sizeof(*msg));
+      msg->msg_name = &txpkt->dst;
+      msg->msg_namelen = txpkt->dstlen;
+      msg->msg_iov = iov[count];
+      msg->msg_iovlen = net_fill_iovec(iov[count], txpkt->buff, txpkt->len, txpkt->segs, txpkt->segcount);
+
+      batch[count++] = txpkt;
+    }
+
+#ifdef linux
+    sent = sendmmsg(ifp->send_socket, msgs, count, MSG_DONTROUTE);
+    tx_stats.syscalls++;
+#else
+    for (sent = 0; sent < count; sent++) {
+      tx_stats.syscalls++;
+      if (sendmsg(ifp->send_socket, &msgs[sent], MSG_DONTROUTE) < 0) {
+        break;
+      }
+    }
+    if (sent == 0) {
+      sent = -1;
+    }
+#endif
+
+    if (sent <= 0) {
+      /* the first packet of the batch failed, drop it */
+      perror("sendmmsg");
+      olsr_syslog(OLSR_LOG_ERR, "OLSR: sendmmsg on %s %m", ifp->int_name);
+      tx_stats.errors++;
+      net_txpkt_done(ifp, batch[0]);
+      continue;
+    }
+
+    tx_stats.packets += sent;
+    if ((uint32_t)sent > tx_stats.max_batch) {
+      tx_stats.max_batch = sent;
+    }
+    for (i = 0; i < sent; i++) {
+      ifp->counters.tx_packets++;
+      ifp->counters.tx_bytes += batch[i]->len;
+      net_txpkt_done(ifp, batch[i]);
+    }
+  }
+#endif
+}
+
+/**
+ * Send the packets queued on all interfaces. Called once per
+ * scheduler iteration if batched transmission is used.
+ */
+void
+net_output_flush(void)
+{
+  struct interface *ifp;
+
+  for (ifp = ifnet; ifp; ifp = ifp->int_next) {
+    net_flush_queue(ifp);
+  }
+}
+
+/**
+ * Print the transmission statistics.
+ */
+void
+net_print_tx_stats(void)
+{
+  static const char *const txclass_names[TXCLASS_COUNT] = { "HELLO", "OWN", "FORWARD", "PLUGIN" };
+  struct interface *ifp;
+
+  OLSR_PRINTF(1, "\n--- %s ---------------------------------------------- TX STATS\n\n", olsr_wallclock_string());
+  OLSR_PRINTF(1, "Packets: %u Syscalls: %u Packets/Syscall: %.2f Max batch: %u Errors: %u\n",
+              tx_stats.packets, tx_stats.syscalls,
+              tx_stats.syscalls ? (double)tx_stats.packets / tx_stats.syscalls : 0.0,
+              tx_stats.max_batch, tx_stats.errors);
+
+  for (ifp = ifnet; ifp; ifp = ifp->int_next) {
+    int cls;
+
+    if (ifp->netbuf.txsched == NULL) {
+      continue;
+    }
+    OLSR_PRINTF(1, "%-16s Class    Depth  Bytes  Sent       Drops      (tokens %d)\n", ifp->int_name, ifp->netbuf.txsched->tokens);
+    for (cls = 0; cls < TXCLASS_COUNT; cls++) {
+      const struct net_txclass_stats *st = &ifp->netbuf.txsched->stats[cls];
+
+      OLSR_PRINTF(1, "%-16s %-8s %-6u %-6u %-10u %-10u\n", "", txclass_names[cls], st->depth, st->bytes, st->sent, st->drops);
+    }
+  }
+}
+
+/**
+ * @return the transmission statistics
+ */
+const struct net_tx_stats *
+net_get_tx_stats(void)
+{
+  return &tx_stats;
+}
+
 /**
  * Report the number of bytes currently available in the buffer
  * (not including possible reserved bytes)
@@ -325,7 +1249,9 @@ del_ptf(packet_transform_function f)
 }
 
 /**
- *Sends a packet on a given interface.
+ *Sends a packet on a given interface. With the output
+ *scheduler this sends the queued messages as far as
+ *the pacing allows.
  *
  *@param ifp the interface to send on.
  *
@@ -333,6 +1259,22 @@ del_ptf(packet_transform_function f)
  */
 int
 net_output(struct interface *ifp)
+{
+  if (ifp->netbuf.txsched != NULL) {
+    return net_output_scheduled(ifp);
+  }
+  return net_output_packet(ifp);
+}
+
+/**
+ *Sends the content of the output buffer as one packet.
+ *
+ *@param ifp the interface to send on.
+ *
+ *@return negative on error
+ */
+static int
+net_output_packet(struct interface *ifp)
 {
   struct sockaddr_in *sin = NULL;
   struct sockaddr_in6 *sin6 = NULL;
@@ -373,11 +1315,21 @@ net_output(struct interface *ifp)
     sin6 = &dst6;
   }
 
+  /*
+   * Packet transform functions and the packet dump need
+   * the whole packet in the buffer
+   */
+  if (ifp->netbuf.segcount > 0 && (ptf_list != NULL || disp_pack_out)) {
+    net_linearize_buffer(ifp);
+  }
+
   /*
    *Call possible packet transform functions registered by plugins
    */
   for (tmp_ptf_list = ptf_list; tmp_ptf_list != NULL; tmp_ptf_list = tmp_ptf_list->next) {
+    uint64_t start = OLSR_CPU_START();
     tmp_ptf_list->function(ifp->netbuf.buff, &ifp->netbuf.pending);
+    OLSR_CPU_STOP(start, CPU_KIND_PTF, tmp_ptf_list->function, tmp_ptf_list->function, NULL);
   }
 
   /*
@@ -387,10 +1339,16 @@ net_output(struct interface *ifp)
   if (disp_pack_out)
     print_olsr_serialized_packet(stdout, (union olsr_packet *)ifp->netbuf.buff, ifp->netbuf.pending, &ifp->ip_addr);
 
-  if (olsr_cnf->ip_version == AF_INET) {
+  if (tx_batching) {
+    /* sent by net_output_flush() at the end of the scheduler iteration */
+    if (olsr_cnf->ip_version == AF_INET) {
+      net_queue_buffer(ifp, (struct sockaddr *)sin, sizeof(*sin));
+    } else {
+      net_queue_buffer(ifp, (struct sockaddr *)sin6, sizeof(*sin6));
+    }
+  } else if (olsr_cnf->ip_version == AF_INET) {
     /* IP version 4 */
-    if (olsr_sendto(ifp->send_socket, ifp->netbuf.buff, ifp->netbuf.pending, MSG_DONTROUTE, (struct sockaddr *)sin, sizeof(*sin)) <
-        0) {
+    if (net_send_buffer(ifp, (struct sockaddr *)sin, sizeof(*sin)) < 0) {
       perror("sendto(v4)");
 #ifndef WIN32
       olsr_syslog(OLSR_LOG_ERR, "OLSR: sendto IPv4 %m");
@@ -399,8 +1357,7 @@ net_output(struct interface *ifp)
     }
   } else {
     /* IP version 6 */
-    if (olsr_sendto(ifp->send_socket, ifp->netbuf.buff, ifp->netbuf.pending, MSG_DONTROUTE, (struct sockaddr *)sin6, sizeof(*sin6))
-        < 0) {
+    if (net_send_buffer(ifp, (struct sockaddr *)sin6, sizeof(*sin6)) < 0) {
       struct ipaddr_str buf;
       perror("sendto(v6)");
 #ifndef WIN32
@@ -414,6 +1371,7 @@ net_output(struct interface *ifp)
   }
 
   ifp->netbuf.pending = 0;
+  net_release_segments(ifp);
 
   /*
    * if we've just transmitted a TC message, let Dijkstra use the current
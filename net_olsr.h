@@ -51,10 +51,45 @@
 
 typedef int (*packet_transform_function) (uint8_t *, int *);
 
+/* Output scheduler priority classes, highest priority first */
+enum olsr_txclass {
+  TXCLASS_HELLO,                       /* HELLO and LQ_HELLO */
+  TXCLASS_OWN,                         /* Own TC, MID and HNA messages */
+  TXCLASS_FORWARD,                     /* Forwarded messages */
+  TXCLASS_PLUGIN,                      /* Everything else */
+  TXCLASS_COUNT
+};
+
+/* Output scheduler counters of one priority class */
+struct net_txclass_stats {
+  uint32_t depth;                      /* Messages queued */
+  uint32_t bytes;                      /* Bytes queued */
+  uint32_t sent;                       /* Messages sent */
+  uint32_t drops;                      /* Messages dropped because the queue was full */
+};
+
+/* Transmission statistics */
+struct net_tx_stats {
+  uint32_t packets;                    /* Packets handed to the kernel */
+  uint32_t syscalls;                   /* System calls used for this */
+  uint32_t max_batch;                  /* Most packets sent with a single call */
+  uint32_t errors;                     /* Packets dropped by failed calls */
+};
+
 void net_set_disp_pack_out(bool);
 
+void net_set_sg_output(bool);
+
+void net_set_tx_batching(bool);
+
+void net_set_tx_scheduler(bool, uint32_t);
+
+char *net_get_rxbuffer(void);
+
 void init_net(void);
 
+void deinit_net(void);
+
 int net_add_buffer(struct interface *);
 
 int net_remove_buffer(struct interface *);
@@ -69,8 +104,18 @@ int net_outbuffer_push(struct interface *, const void *, const uint16_t);
 
 int net_outbuffer_push_reserved(struct interface *, const void *, const uint16_t);
 
+int net_outbuffer_push_forward(struct interface *, void *, const uint16_t);
+
 int net_output(struct interface *);
 
+void net_output_flush(void);
+
+void net_print_tx_stats(void);
+
+const struct net_tx_stats *net_get_tx_stats(void);
+
+const struct net_txclass_stats *net_get_txclass_stats(const struct interface *, enum olsr_txclass);
+
 int net_sendroute(struct rt_entry *, struct sockaddr *);
 
 int add_ptf(packet_transform_function);
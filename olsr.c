@@ -65,6 +65,10 @@
 #include "lq_plugin.h"
 #include "gateway.h"
 #include "duplicate_handler.h"
+#include "olsr_cookie.h"
+#include "olsr_snapshot.h"
+#include "olsr_metrics.h"
+#include "olsr_cpustats.h"
 
 #include <stdarg.h>
 #include <signal.h>
@@ -213,6 +217,7 @@ olsr_process_changes(void)
   if (olsr_cnf->debug_level > 0) {
     if (olsr_cnf->debug_level > 2) {
       olsr_print_mid_set();
+      net_print_tx_stats();
 #ifdef LINUX_NETLINK_ROUTING
     olsr_print_gateway_entries();
 #endif
@@ -222,6 +227,8 @@ olsr_process_changes(void)
           olsr_print_duplicate_table();
         }
         olsr_print_hna_set();
+        olsr_print_cookie_usage();
+        olsr_print_cpustats();
       }
     }
     olsr_print_link_set();
@@ -231,9 +238,13 @@ olsr_process_changes(void)
   }
 
   for (tmp_pc_list = pcf_list; tmp_pc_list != NULL; tmp_pc_list = tmp_pc_list->next) {
+    uint64_t start = OLSR_CPU_START();
     tmp_pc_list->function(changes_neighborhood, changes_topology, changes_hna);
+    OLSR_CPU_STOP(start, CPU_KIND_PCF, tmp_pc_list->function, tmp_pc_list->function, NULL);
   }
 
+  olsr_snapshot_publish();
+
   changes_neighborhood = false;
   changes_topology = false;
   changes_hna = false;
@@ -261,6 +272,9 @@ olsr_init_tables(void)
     avl_comp_prefix_default = avl_comp_ipv6_prefix;
   }
 
+  /* Seed and select the address hash, before any table is filled */
+  olsr_init_hashing();
+
   /* Initialize lq plugin set */
   init_lq_handler_tree();
 
@@ -350,9 +364,12 @@ olsr_forward_message(union olsr_message *m, struct interface *in_if, union olsr_
   }
 
   if (olsr_message_is_duplicate(m)) {
+    OLSR_METRIC_INC(METRIC_DUPLICATES);
     return 0;
   }
 
+  OLSR_METRIC_INC(METRIC_FORWARDS);
+
   /* Treat TTL hopcnt except for ethernet link */
   if (!is_ttl_1) {
     if (olsr_cnf->ip_version == AF_INET) {
@@ -381,13 +398,13 @@ olsr_forward_message(union olsr_message *m, struct interface *in_if, union olsr_
       /*
        * Check if message is to big to be piggybacked
        */
-      if (net_outbuffer_push(ifn, m, msgsize) != msgsize) {
+      if (net_outbuffer_push_forward(ifn, m, msgsize) != msgsize) {
         /* Send */
         net_output(ifn);
         /* Buffer message */
         set_buffer_timer(ifn);
 
-        if (net_outbuffer_push(ifn, m, msgsize) != msgsize) {
+        if (net_outbuffer_push_forward(ifn, m, msgsize) != msgsize) {
           OLSR_PRINTF(1, "Received message to big to be forwarded in %s(%d bytes)!", ifn->int_name, msgsize);
           olsr_syslog(OLSR_LOG_ERR, "Received message to big to be forwarded on %s(%d bytes)!", ifn->int_name, msgsize);
         }
@@ -396,7 +413,7 @@ olsr_forward_message(union olsr_message *m, struct interface *in_if, union olsr_
       /* No forwarding pending */
       set_buffer_timer(ifn);
 
-      if (net_outbuffer_push(ifn, m, msgsize) != msgsize) {
+      if (net_outbuffer_push_forward(ifn, m, msgsize) != msgsize) {
         OLSR_PRINTF(1, "Received message to big to be forwarded in %s(%d bytes)!", ifn->int_name, msgsize);
         olsr_syslog(OLSR_LOG_ERR, "Received message to big to be forwarded on %s(%d bytes)!", ifn->int_name, msgsize);
       }
@@ -0,0 +1,159 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * bench_hash - compare the seeded address hashes with lookup2
+ *
+ * For IPv4 and IPv6, hashes 4096 sequential addresses (10.0.x.y,
+ * fd00::x:y) and 4096 random ones into the HASHSIZE buckets. Reports
+ * the chain length distribution and the mean probe length, i.e. the
+ * average chain length seen by a lookup of a stored address, against
+ * the ideal of a uniform hash. Then times both hashes.
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "hashing_ref.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_ADDRS   4096
+#define BENCH_ROUNDS  20000
+
+static union olsr_ip_addr seq_addrs[BENCH_ADDRS];
+static union olsr_ip_addr rnd_addrs[BENCH_ADDRS];
+
+/* Keeps the compiler from dropping the loops */
+static volatile uint32_t sink;
+
+static int
+bench_cmp_int(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+static void
+bench_chains(const char *name, const union olsr_ip_addr *addrs, uint32_t (*hash) (const union olsr_ip_addr *))
+{
+  int chain[HASHSIZE];
+  double probes = 0;
+  int i;
+
+  memset(chain, 0, sizeof(chain));
+  for (i = 0; i < BENCH_ADDRS; i++) {
+    chain[hash(&addrs[i])]++;
+  }
+  for (i = 0; i < HASHSIZE; i++) {
+    probes += (double)chain[i] * chain[i];
+  }
+
+  qsort(chain, HASHSIZE, sizeof(chain[0]), bench_cmp_int);
+  printf("    %-8s chain min %3d p10 %3d median %3d p90 %3d max %3d, mean probe %.2f (ideal %.2f)\n", name,
+         chain[0], chain[HASHSIZE / 10], chain[HASHSIZE / 2], chain[HASHSIZE * 9 / 10], chain[HASHSIZE - 1],
+         probes / BENCH_ADDRS, (double)BENCH_ADDRS / HASHSIZE + 1 - 1.0 / HASHSIZE);
+}
+
+static double
+bench_speed(uint32_t (*hash) (const union olsr_ip_addr *))
+{
+  double start = bench_now();
+  uint32_t sum = 0;
+  int round, i;
+
+  for (round = 0; round < BENCH_ROUNDS; round++) {
+    for (i = 0; i < BENCH_ADDRS; i++) {
+      sum += hash(&rnd_addrs[i]);
+    }
+  }
+  sink = sum;
+  return (bench_now() - start) * 1e9 / BENCH_ROUNDS / BENCH_ADDRS;
+}
+
+int
+main(void)
+{
+  int family, i;
+
+  srandom(getpid());
+
+  for (family = 0; family < 2; family++) {
+    olsr_cnf->ip_version = family ? AF_INET6 : AF_INET;
+    olsr_cnf->ipsize = family ? sizeof(struct in6_addr) : sizeof(struct in_addr);
+    olsr_init_hashing();
+
+    memset(seq_addrs, 0, sizeof(seq_addrs));
+    memset(rnd_addrs, 0, sizeof(rnd_addrs));
+    for (i = 0; i < BENCH_ADDRS; i++) {
+      unsigned int byte;
+
+      if (family) {
+        seq_addrs[i].v6.s6_addr[0] = 0xfd;
+        seq_addrs[i].v6.s6_addr[14] = i >> 8;
+        seq_addrs[i].v6.s6_addr[15] = i & 0xff;
+      } else {
+        seq_addrs[i].v4.s_addr = htonl(0x0a000000 | i);
+      }
+      for (byte = 0; byte < olsr_cnf->ipsize; byte++) {
+        ((uint8_t *)&rnd_addrs[i])[byte] = random();
+      }
+    }
+
+    printf("%s, %d addresses, %d buckets\n", family ? "IPv6" : "IPv4", BENCH_ADDRS, HASHSIZE);
+    printf("  sequential:\n");
+    bench_chains("lookup2", seq_addrs, ref_ip_hashing);
+    bench_chains("seeded", seq_addrs, olsr_ip_hashing);
+    printf("  random:\n");
+    bench_chains("lookup2", rnd_addrs, ref_ip_hashing);
+    bench_chains("seeded", rnd_addrs, olsr_ip_hashing);
+    printf("  speed: lookup2 %.2f ns/hash, seeded %.2f ns/hash\n", bench_speed(ref_ip_hashing),
+           bench_speed(olsr_ip_hashing));
+  }
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
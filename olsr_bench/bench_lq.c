@@ -0,0 +1,339 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * bench_lq - cost and accuracy of the built-in LQ handlers
+ *
+ * Drives each handler with hellos of a single link, one per second,
+ * through the same entry points the daemon uses: its packet parser,
+ * its packet loss handler and its 1 s timer, where it has them.
+ *
+ * Prints the per-call cost of the hot handler functions, the time
+ * until the link cost rises by half after a clean link drops to 50%
+ * loss, and how often the link cost changes over 10 minutes of
+ * uniform (20% loss), bursty (Gilbert-Elliott) and flapping
+ * (10 s clean, 10 s at 60% loss) traces, with lq_aging 0.05.
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "link_set.h"
+#include "mid_set.h"
+#include "interfaces.h"
+#include "lq_plugin.h"
+#include "lq_plugin_default_ff.h"
+#include "lq_plugin_default_ffeth.h"
+#include "lq_plugin_default_float.h"
+#include "lq_plugin_default_fpm.h"
+#include "parser.h"
+
+#include <string.h>
+
+#define BENCH_CALLS  2000000
+
+static struct lq_handler *handler;
+static struct link_entry *bench_link;
+static struct interface iface;
+static packetparser_function *bench_parser;
+static uint16_t seqno;
+static int linkcost_changes;
+
+/* Stubs for the link set and the parser */
+struct list_node link_entry_head;
+
+union olsr_ip_addr *
+mid_lookup_main_addr(const union olsr_ip_addr *adr __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+struct link_entry *
+lookup_link_entry(const union olsr_ip_addr *remote __attribute__ ((unused)),
+                  const union olsr_ip_addr *remote_main __attribute__ ((unused)),
+                  const struct interface *local __attribute__ ((unused)))
+{
+  return bench_link;
+}
+
+void
+olsr_packetparser_add_function(packetparser_function * function)
+{
+  bench_parser = function;
+}
+
+bool
+olsr_lq_link_timers(void)
+{
+  return false;
+}
+
+void
+olsr_lq_start_link_timer(struct link_entry *lnk __attribute__ ((unused)), timer_cb_func cb __attribute__ ((unused)))
+{
+}
+
+void
+olsr_relevant_linkcost_change(void)
+{
+  linkcost_changes++;
+}
+
+/* Deterministic loss traces, t is the time in seconds */
+static uint32_t rnd_state;
+static bool burst_bad;
+
+static double
+trace_random(void)
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return ((rnd_state >> 8) & 0xffff) / 65536.0;
+}
+
+static bool
+trace_perfect(int t __attribute__ ((unused)))
+{
+  return true;
+}
+
+static bool
+trace_uniform(int t __attribute__ ((unused)))
+{
+  return trace_random() >= 0.2;
+}
+
+static bool
+trace_bursty(int t __attribute__ ((unused)))
+{
+  if (burst_bad) {
+    if (trace_random() < 0.2) {
+      burst_bad = false;
+    }
+  } else if (trace_random() < 0.05) {
+    burst_bad = true;
+  }
+  return burst_bad ? trace_random() < 0.3 : trace_random() < 0.98;
+}
+
+static bool
+trace_flapping(int t)
+{
+  return (t / 10) % 2 ? trace_random() < 0.4 : true;
+}
+
+static bool
+trace_drop50(int t __attribute__ ((unused)))
+{
+  return trace_random() >= 0.5;
+}
+
+/* One hello interval of the link, received or lost */
+static void
+bench_hello(bool received)
+{
+  seqno++;
+  if (received && bench_parser) {
+    struct olsr olsr;
+
+    memset(&olsr, 0, sizeof(olsr));
+    olsr.olsr_seqno = seqno;
+    bench_parser(&olsr, &iface, &bench_link->neighbor_iface_addr);
+  }
+  handler->packet_loss_handler(bench_link, bench_link->linkquality, !received);
+}
+
+static olsr_linkcost
+bench_cost(void)
+{
+  return handler->calc_hello_cost(bench_link->linkquality);
+}
+
+static void
+bench_second(bool (*trace) (int), int t)
+{
+  bench_hello(trace(t));
+  if (bench_timer_cb) {
+    bench_timer_cb(NULL);
+  }
+}
+
+/* Clear the link, the neighbor hears us perfectly */
+static void
+bench_reset(uint32_t seed)
+{
+  union {
+    struct default_lq_float lq_float;
+    struct default_lq_ff lq_ff;
+    struct default_lq_ffeth lq_ffeth;
+    struct default_lq_fpm lq_fpm;
+  } foreign;
+  int t;
+
+  memset(&foreign, 0, sizeof(foreign));
+  if (handler == &lq_etx_float_handler) {
+    foreign.lq_float.lq = 1.0;
+  } else if (handler == &lq_etx_fpm_handler) {
+    foreign.lq_fpm.valueLq = 255;
+  } else if (handler == &lq_etx_ffeth_handler) {
+    foreign.lq_ffeth.valueLq = 255;
+  } else {
+    foreign.lq_ff.valueLq = 255;
+  }
+  handler->clear_hello(bench_link->linkquality);
+  handler->memorize_foreign_hello(bench_link->linkquality, &foreign);
+
+  rnd_state = seed;
+  burst_bad = false;
+  for (t = 0; t < 60; t++) {
+    bench_second(trace_perfect, t);
+  }
+}
+
+static void
+bench_trace(const char *name, bool (*trace) (int))
+{
+  olsr_linkcost cost, prev;
+  double sum = 0;
+  int changes = 0;
+  int t;
+
+  bench_reset(7);
+  for (t = 60; t < 120; t++) {
+    bench_second(trace, t);
+  }
+  prev = bench_cost();
+  for (t = 120; t < 720; t++) {
+    bench_second(trace, t);
+    cost = bench_cost();
+    if (cost != prev) {
+      changes++;
+    }
+    prev = cost;
+    sum += cost;
+  }
+  printf("  %-9s cost changes/10min %4d, mean cost %8.1f\n", name, changes, sum / 600);
+}
+
+static void
+bench_handler(const char *name, struct lq_handler *h)
+{
+  volatile olsr_linkcost sink = 0;
+  unsigned char buf[8];
+  olsr_linkcost base;
+  double start, loss_time, cost_time, ser_time;
+  int i, t;
+
+  handler = h;
+  bench_parser = NULL;
+  bench_timer_cb = NULL;
+
+  bench_link = olsr_malloc(sizeof(struct link_entry) + h->hello_lq_size, "bench link");
+  bench_link->inter = &iface;
+  bench_link->loss_link_multiplier = LINK_LOSS_MULTIPLIER;
+  list_head_init(&link_entry_head);
+  list_add_before(&link_entry_head, &bench_link->link_list);
+
+  h->initialize();
+  bench_reset(1);
+
+  start = bench_now();
+  for (i = 0; i < BENCH_CALLS; i++) {
+    bench_hello(true);
+  }
+  loss_time = bench_now() - start;
+  start = bench_now();
+  for (i = 0; i < BENCH_CALLS; i++) {
+    sink += h->calc_hello_cost(bench_link->linkquality);
+  }
+  cost_time = bench_now() - start;
+  start = bench_now();
+  for (i = 0; i < BENCH_CALLS; i++) {
+    sink += h->serialize_hello_lq(buf, bench_link->linkquality);
+  }
+  ser_time = bench_now() - start;
+  printf("%s\n  ns/call: hello input %.1f, calc_hello_cost %.1f, serialize %.1f\n", name,
+         loss_time * 1e9 / BENCH_CALLS, cost_time * 1e9 / BENCH_CALLS, ser_time * 1e9 / BENCH_CALLS);
+
+  bench_reset(3);
+  for (t = 60; t < 120; t++) {
+    bench_second(trace_perfect, t);
+  }
+  base = bench_cost();
+  for (t = 0; t < 120; t++) {
+    bench_second(trace_drop50, t);
+    if (bench_cost() >= base + base / 2) {
+      break;
+    }
+  }
+  printf("  drop to 50%% loss: cost up by half after %d s\n", t + 1);
+
+  bench_trace("uniform", trace_uniform);
+  bench_trace("bursty", trace_bursty);
+  bench_trace("flapping", trace_flapping);
+
+  list_remove(&bench_link->link_list);
+  free(bench_link);
+}
+
+int
+main(void)
+{
+  olsr_cnf->ip_version = AF_INET;
+  olsr_cnf->ipsize = sizeof(struct in_addr);
+  olsr_cnf->lq_aging = 0.05;
+  olsr_cnf->lq_nat_thresh = 1.0;
+  iface.hello_etime = 1000;
+  iface.mode = IF_MODE_MESH;
+
+  bench_handler("etx_ff", &lq_etx_ff_handler);
+  bench_handler("etx_ffeth", &lq_etx_ffeth_handler);
+  bench_handler("etx_float", &lq_etx_float_handler);
+  bench_handler("etx_fpm", &lq_etx_fpm_handler);
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,344 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * bench_lqff - time the etx_ff LQ timer on 1000 links
+ *
+ * Feeds random hello traffic with 0-2 lost packets per hello into
+ * 1000 links through the plugin's packet parser and runs its 1 s
+ * timer. A copy of the links is updated with the timer as it was
+ * before the running window totals, which re-summed the whole window
+ * of every link and walked the link set again for the relevance
+ * check. Both have to agree on lq, smoothed lq and link cost after
+ * every tick.
+ *
+ * The same is repeated with per-link timers (-lqlinktimer), all links
+ * ticking once followed by the deferred lqchange timer, which has to
+ * give the same results.
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "link_set.h"
+#include "mid_set.h"
+#include "lq_plugin.h"
+#include "lq_plugin_default_ff.h"
+#include "parser.h"
+#include "fpm.h"
+
+#include <string.h>
+
+#define BENCH_LINKS  1000
+#define BENCH_TICKS  5000
+
+static struct link_entry *links[BENCH_LINKS];
+static struct link_entry *ref_links[BENCH_LINKS];
+static uint16_t seqno[BENCH_LINKS];
+
+static packetparser_function *bench_parser;
+static timer_cb_func link_timer_cb;
+static bool link_timers;
+static int linkcost_changes;
+
+/* Stubs for the link set and the parser */
+struct list_node link_entry_head;
+
+union olsr_ip_addr *
+mid_lookup_main_addr(const union olsr_ip_addr *adr __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+struct link_entry *
+lookup_link_entry(const union olsr_ip_addr *remote, const union olsr_ip_addr *remote_main __attribute__ ((unused)),
+                  const struct interface *local __attribute__ ((unused)))
+{
+  return links[remote->v4.s_addr];
+}
+
+void
+olsr_packetparser_add_function(packetparser_function * function)
+{
+  bench_parser = function;
+}
+
+bool
+olsr_lq_link_timers(void)
+{
+  return link_timers;
+}
+
+void
+olsr_lq_start_link_timer(struct link_entry *link, timer_cb_func cb)
+{
+  if (link->link_lq_timer == NULL) {
+    link->link_lq_timer = olsr_malloc(sizeof(struct timer_entry), "bench lq timer");
+    link->link_lq_timer->timer_period = MSEC_PER_SEC;
+  }
+  link_timer_cb = cb;
+}
+
+void
+olsr_relevant_linkcost_change(void)
+{
+  linkcost_changes++;
+}
+
+/* The 1 s timer as it was before the running window totals */
+static bool
+ref_relevant_change(struct default_lq_ff_hello *lq)
+{
+  bool relevant = false;
+
+  if (lq->smoothed_lq.valueLq < lq->lq.valueLq) {
+    if (lq->lq.valueLq == 255 || lq->lq.valueLq - lq->smoothed_lq.valueLq > lq->smoothed_lq.valueLq / 10) {
+      relevant = true;
+    }
+  } else if (lq->smoothed_lq.valueLq > lq->lq.valueLq) {
+    if (lq->smoothed_lq.valueLq - lq->lq.valueLq > lq->smoothed_lq.valueLq / 10) {
+      relevant = true;
+    }
+  }
+  if (lq->smoothed_lq.valueNlq < lq->lq.valueNlq) {
+    if (lq->lq.valueNlq == 255 || lq->lq.valueNlq - lq->smoothed_lq.valueNlq > lq->smoothed_lq.valueNlq / 10) {
+      relevant = true;
+    }
+  } else if (lq->smoothed_lq.valueNlq > lq->lq.valueNlq) {
+    if (lq->smoothed_lq.valueNlq - lq->lq.valueNlq > lq->smoothed_lq.valueNlq / 10) {
+      relevant = true;
+    }
+  }
+  return relevant;
+}
+
+static int
+ref_timer(void)
+{
+  struct default_lq_ff_hello *tlq;
+  bool triggered = false;
+  int n, i;
+
+  for (n = 0; n < BENCH_LINKS; n++) {
+    int received = 0, total = 0;
+    fpm ratio;
+
+    tlq = (struct default_lq_ff_hello *)ref_links[n]->linkquality;
+    if (tlq->windowSize < LQ_FF_WINDOW) {
+      tlq->windowSize++;
+    }
+    for (i = 0; i < tlq->windowSize; i++) {
+      received += tlq->received[i];
+      total += tlq->total[i];
+    }
+
+    if (total == 0) {
+      tlq->lq.valueLq = 0;
+    } else {
+      ratio = fpmidiv(itofpm(ref_links[n]->loss_link_multiplier), LINK_LOSS_MULTIPLIER);
+      ratio = fpmmuli(ratio, received);
+      ratio = fpmidiv(ratio, total);
+      ratio = fpmmuli(ratio, 255);
+      tlq->lq.valueLq = (uint8_t) (fpmtoi(ratio));
+    }
+
+    tlq->activePtr = (tlq->activePtr + 1) % LQ_FF_WINDOW;
+    tlq->total[tlq->activePtr] = 0;
+    tlq->received[tlq->activePtr] = 0;
+  }
+
+  for (n = 0; n < BENCH_LINKS; n++) {
+    tlq = (struct default_lq_ff_hello *)ref_links[n]->linkquality;
+    if (ref_relevant_change(tlq)) {
+      tlq->smoothed_lq = tlq->lq;
+      ref_links[n]->linkcost = lq_etx_ff_handler.calc_hello_cost(&tlq->smoothed_lq);
+      triggered = true;
+    }
+  }
+  if (!triggered) {
+    return 0;
+  }
+
+  for (n = 0; n < BENCH_LINKS; n++) {
+    tlq = (struct default_lq_ff_hello *)ref_links[n]->linkquality;
+    if (tlq->smoothed_lq.valueLq == 255 && tlq->smoothed_lq.valueNlq == 255) {
+      continue;
+    }
+    if (tlq->smoothed_lq.valueLq == tlq->lq.valueLq && tlq->smoothed_lq.valueNlq == tlq->lq.valueNlq) {
+      continue;
+    }
+    tlq->smoothed_lq = tlq->lq;
+    ref_links[n]->linkcost = lq_etx_ff_handler.calc_hello_cost(&tlq->smoothed_lq);
+  }
+  return 1;
+}
+
+static struct link_entry *
+bench_new_link(void)
+{
+  struct link_entry *link = olsr_malloc(sizeof(struct link_entry) + lq_etx_ff_handler.hello_lq_size, "bench link");
+  struct default_lq_ff_hello *lq = (struct default_lq_ff_hello *)link->linkquality;
+
+  lq_etx_ff_handler.clear_hello(lq);
+  lq->lq.valueNlq = lq->smoothed_lq.valueNlq = 255;
+  link->loss_link_multiplier = LINK_LOSS_MULTIPLIER;
+  return link;
+}
+
+/* A hello from most links, some of its predecessors lost */
+static void
+bench_hellos(bool all)
+{
+  struct interface in_if;
+  union olsr_ip_addr from;
+  struct olsr olsr;
+  int n;
+
+  memset(&in_if, 0, sizeof(in_if));
+  memset(&from, 0, sizeof(from));
+  memset(&olsr, 0, sizeof(olsr));
+
+  for (n = 0; n < BENCH_LINKS; n++) {
+    struct default_lq_ff_hello *ref = (struct default_lq_ff_hello *)ref_links[n]->linkquality;
+    int diff = 1 + random() % 8 / 6;
+
+    if (!all && random() % 4 == 0) {
+      /* no hello this tick */
+      continue;
+    }
+
+    seqno[n] += diff;
+    olsr.olsr_seqno = seqno[n];
+    from.v4.s_addr = n;
+    bench_parser(&olsr, &in_if, &from);
+
+    ref->received[ref->activePtr]++;
+    ref->total[ref->activePtr] += diff;
+  }
+}
+
+static void
+bench_run(void)
+{
+  double tick_time = 0, ref_time = 0;
+  int ref_changes = 0;
+  int tick, n;
+
+  srandom(7);
+  memset(seqno, 0, sizeof(seqno));
+  linkcost_changes = 0;
+
+  list_head_init(&link_entry_head);
+  lq_etx_ff_handler.initialize();
+  BENCH_CHECK(bench_parser != NULL && bench_timer_cb != NULL);
+
+  for (n = 0; n < BENCH_LINKS; n++) {
+    links[n] = bench_new_link();
+    list_add_before(&link_entry_head, &links[n]->link_list);
+    ref_links[n] = bench_new_link();
+  }
+
+  /* starts the per-link timers of all links */
+  bench_hellos(true);
+
+  for (tick = 0; tick < BENCH_TICKS; tick++) {
+    double start;
+
+    if (tick) {
+      bench_hellos(false);
+    }
+
+    start = bench_now();
+    if (link_timers) {
+      for (n = 0; n < BENCH_LINKS; n++) {
+        link_timer_cb(links[n]);
+      }
+    }
+    bench_timer_cb(NULL);
+    tick_time += bench_now() - start;
+
+    start = bench_now();
+    ref_changes += ref_timer();
+    ref_time += bench_now() - start;
+
+    for (n = 0; n < BENCH_LINKS; n++) {
+      struct default_lq_ff_hello *lq = (struct default_lq_ff_hello *)links[n]->linkquality;
+      struct default_lq_ff_hello *ref = (struct default_lq_ff_hello *)ref_links[n]->linkquality;
+
+      BENCH_CHECK(lq->lq.valueLq == ref->lq.valueLq);
+      BENCH_CHECK(lq->smoothed_lq.valueLq == ref->smoothed_lq.valueLq);
+      BENCH_CHECK(links[n]->linkcost == ref_links[n]->linkcost);
+    }
+    BENCH_CHECK(linkcost_changes == ref_changes);
+  }
+
+  printf("%s: %d links, %d ticks, %d linkcost changes, identical lq/cost after every tick\n",
+         link_timers ? "per-link timers" : "1 s timer", BENCH_LINKS, BENCH_TICKS, linkcost_changes);
+  printf("  re-summed window %.1f us/tick, running totals %.1f us/tick\n", ref_time * 1e6 / BENCH_TICKS,
+         tick_time * 1e6 / BENCH_TICKS);
+
+  for (n = 0; n < BENCH_LINKS; n++) {
+    free(links[n]->link_lq_timer);
+    free(links[n]);
+    free(ref_links[n]);
+  }
+}
+
+int
+main(void)
+{
+  olsr_cnf->ip_version = AF_INET;
+  olsr_cnf->ipsize = sizeof(struct in_addr);
+
+  link_timers = false;
+  bench_run();
+  link_timers = true;
+  bench_run();
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
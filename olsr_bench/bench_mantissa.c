@@ -0,0 +1,107 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * bench_mantissa - time the mantissa/exponent conversion against the
+ * original loop based implementation
+ *
+ * Encodes 2*10^8 intervals below 4000 s and decodes 5*10^8 codes with
+ * both implementations.
+ */
+
+#include "bench.h"
+#include "mantissa_ref.h"
+
+#define BENCH_ENCODES 200000000U
+#define BENCH_DECODES 500000000U
+
+/* Keeps the compiler from dropping the loops */
+static volatile uint32_t sink;
+
+int
+main(void)
+{
+  double start, ref_encode, encode, ref_decode, decode;
+  uint32_t sum, i;
+
+  sum = 0;
+  start = bench_now();
+  for (i = 0; i < BENCH_ENCODES; i++) {
+    sum += ref_reltime_to_me(i * 7919U % 4000000U);
+  }
+  ref_encode = bench_now() - start;
+  sink = sum;
+
+  sum = 0;
+  start = bench_now();
+  for (i = 0; i < BENCH_ENCODES; i++) {
+    sum += reltime_to_me(i * 7919U % 4000000U);
+  }
+  encode = bench_now() - start;
+  sink = sum;
+
+  sum = 0;
+  start = bench_now();
+  for (i = 0; i < BENCH_DECODES; i++) {
+    sum += ref_me_to_reltime((uint8_t)(i * 31));
+  }
+  ref_decode = bench_now() - start;
+  sink = sum;
+
+  sum = 0;
+  start = bench_now();
+  for (i = 0; i < BENCH_DECODES; i++) {
+    sum += me_to_reltime((uint8_t)(i * 31));
+  }
+  decode = bench_now() - start;
+  sink = sum;
+
+  printf("encode %u: loop %.2f s, table %.2f s\n", BENCH_ENCODES, ref_encode, encode);
+  printf("decode %u: loop %.2f s, table %.2f s\n", BENCH_DECODES, ref_decode, decode);
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
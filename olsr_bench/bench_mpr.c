@@ -0,0 +1,240 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * bench_mpr - time the full MPR calculation
+ *
+ * Builds a neighborhood of 300 symmetric 1 hop neighbors and 3000
+ * 2 hop neighbors, each reachable through 5 random 1 hop neighbors
+ * of the same willingness. Then runs olsr_calculate_mpr() repeatedly
+ * for MPR coverage 1 and 2. Checks that every 2 hop neighbor is
+ * covered and reports the time per calculation and the MPR count.
+ *
+ * Usage: bench_mpr [rounds]
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "mpr.h"
+#include "neighbor_table.h"
+#include "two_hop_neighbor_table.h"
+#include "link_set.h"
+#include "mid_set.h"
+
+#include <string.h>
+
+#define BENCH_NBR     300
+#define BENCH_NBR2    3000
+#define BENCH_LINKS   5
+
+/* Functions of sources the benchmark does not link */
+void
+signal_link_changes(bool val __attribute__ ((unused)))
+{
+}
+
+union olsr_ip_addr *
+mid_lookup_main_addr(const union olsr_ip_addr *adr __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+struct mid_address *
+mid_lookup_aliases(const union olsr_ip_addr *adr __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+uint32_t
+olsr_ip_hashing(const union olsr_ip_addr *address)
+{
+  return ntohl(address->v4.s_addr) & HASHMASK;
+}
+
+struct link_entry *
+get_best_link_to_neighbor(const union olsr_ip_addr *remote __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+const char *
+get_linkcost_text(olsr_linkcost cost __attribute__ ((unused)), bool route __attribute__ ((unused)),
+                  struct lqtextbuffer *buffer __attribute__ ((unused)))
+{
+  return "";
+}
+
+static struct neighbor_entry *nbrs[BENCH_NBR];
+
+static union olsr_ip_addr
+bench_addr(uint32_t id)
+{
+  union olsr_ip_addr addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.v4.s_addr = htonl(id);
+  return addr;
+}
+
+/* Same list handling as linking_this_2_entries() */
+static void
+bench_link_2hop(struct neighbor_entry *neighbor, uint32_t id)
+{
+  union olsr_ip_addr addr = bench_addr(BENCH_NBR + id);
+  struct neighbor_2_entry *two_hop_neighbor;
+  struct neighbor_list_entry *list_1;
+  struct neighbor_2_list_entry *list_2;
+
+  if (olsr_lookup_my_neighbors(neighbor, &addr) != NULL) {
+    return;
+  }
+
+  two_hop_neighbor = olsr_lookup_two_hop_neighbor_table(&addr);
+  if (two_hop_neighbor == NULL) {
+    two_hop_neighbor = olsr_malloc(sizeof(*two_hop_neighbor), "bench 2 hop neighbor");
+    two_hop_neighbor->neighbor_2_nblist.next = &two_hop_neighbor->neighbor_2_nblist;
+    two_hop_neighbor->neighbor_2_nblist.prev = &two_hop_neighbor->neighbor_2_nblist;
+    two_hop_neighbor->neighbor_2_addr = addr;
+    olsr_insert_two_hop_neighbor_table(two_hop_neighbor);
+  }
+
+  list_1 = olsr_malloc(sizeof(*list_1), "bench 1 hop list");
+  list_1->neighbor = neighbor;
+  list_1->next = two_hop_neighbor->neighbor_2_nblist.next;
+  list_1->prev = &two_hop_neighbor->neighbor_2_nblist;
+  two_hop_neighbor->neighbor_2_nblist.next->prev = list_1;
+  two_hop_neighbor->neighbor_2_nblist.next = list_1;
+
+  list_2 = olsr_malloc(sizeof(*list_2), "bench 2 hop list");
+  list_2->neighbor_2 = two_hop_neighbor;
+  list_2->nbr2_nbr = neighbor;
+  list_2->next = neighbor->neighbor_2_list.next;
+  list_2->prev = &neighbor->neighbor_2_list;
+  neighbor->neighbor_2_list.next->prev = list_2;
+  neighbor->neighbor_2_list.next = list_2;
+
+  two_hop_neighbor->neighbor_2_pointer++;
+}
+
+/* Number of 2 hop neighbors covered by less than the configured number of MPRs */
+static int
+bench_uncovered(void)
+{
+  struct neighbor_2_entry *nbr2;
+  int idx, uncovered = 0;
+
+  for (idx = 0; idx < HASHSIZE; idx++) {
+    for (nbr2 = two_hop_neighbortable[idx].next; nbr2 != &two_hop_neighbortable[idx]; nbr2 = nbr2->next) {
+      struct neighbor_list_entry *entry;
+      int mprs = 0, candidates = 0;
+
+      for (entry = nbr2->neighbor_2_nblist.next; entry != &nbr2->neighbor_2_nblist; entry = entry->next) {
+        candidates++;
+        mprs += entry->neighbor->is_mpr;
+      }
+      if (mprs < MIN(candidates, olsr_cnf->mpr_coverage)) {
+        uncovered++;
+      }
+    }
+  }
+  return uncovered;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds = argc > 1 ? atoi(argv[1]) : 200;
+  int coverage, i;
+
+  debug_handle = fopen("/dev/null", "w");
+  olsr_cnf->ip_version = AF_INET;
+  olsr_cnf->ipsize = sizeof(struct in_addr);
+
+  olsr_init_neighbor_table();
+  olsr_init_two_hop_table();
+
+  for (i = 0; i < BENCH_NBR; i++) {
+    union olsr_ip_addr addr = bench_addr(i);
+
+    nbrs[i] = olsr_insert_neighbor_table(&addr);
+    nbrs[i]->status = SYM;
+    nbrs[i]->willingness = WILL_DEFAULT;
+  }
+
+  srand(11);
+  for (i = 0; i < BENCH_NBR2; i++) {
+    int link;
+
+    for (link = 0; link < BENCH_LINKS; link++) {
+      bench_link_2hop(nbrs[rand() % BENCH_NBR], i);
+    }
+  }
+
+  for (coverage = 1; coverage <= 2; coverage++) {
+    double start;
+    int mprs = 0, round;
+
+    olsr_cnf->mpr_coverage = coverage;
+
+    start = bench_now();
+    for (round = 0; round < rounds; round++) {
+      olsr_calculate_mpr();
+    }
+    start = bench_now() - start;
+
+    BENCH_CHECK(bench_uncovered() == 0);
+    for (i = 0; i < BENCH_NBR; i++) {
+      mprs += nbrs[i]->is_mpr;
+    }
+    printf("coverage %d: %d MPRs, %.3f ms per full calculation (%d 1 hop, %d 2 hop neighbors)\n",
+           coverage, mprs, start * 1000 / rounds, BENCH_NBR, BENCH_NBR2);
+  }
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,174 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * Daemon globals and functions the benchmark and test programs
+ * need, but which live in sources they do not link.
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "log.h"
+#include "scheduler.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+static struct olsrd_config bench_cnf;
+struct olsrd_config *olsr_cnf = &bench_cnf;
+
+FILE *debug_handle;
+
+uint32_t now_times;
+
+bool changes_topology;
+bool changes_neighborhood;
+
+double
+bench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void
+olsr_exit(const char *msg, int val)
+{
+  fprintf(stderr, "olsr_exit: %s\n", msg);
+  exit(val);
+}
+
+void *
+olsr_malloc(size_t size, const char *id __attribute__ ((unused)))
+{
+  void *ptr = calloc(1, size);
+
+  if (ptr == NULL) {
+    olsr_exit("out of memory", EXIT_FAILURE);
+  }
+  return ptr;
+}
+
+#if SYSLOG_NUMBERING
+unsigned int olsr_syslog_ctr;
+
+void
+olsr_syslog_real(int level __attribute__ ((unused)), const char *format __attribute__ ((unused)), ...)
+{
+}
+#else
+void
+olsr_syslog(int level __attribute__ ((unused)), const char *format __attribute__ ((unused)), ...)
+{
+}
+#endif
+
+const char *
+olsr_wallclock_string(void)
+{
+  return "00:00:00.000000";
+}
+
+uint32_t
+olsr_getTimestamp(uint32_t s)
+{
+  return now_times + s;
+}
+
+int32_t
+olsr_getTimeDue(uint32_t s)
+{
+  return (int32_t) (s - now_times);
+}
+
+bool
+olsr_isTimedOut(uint32_t s)
+{
+  return (int32_t) (s - now_times) <= 0;
+}
+
+timer_cb_func bench_timer_cb;
+
+/*
+ * Timers never fire, the programs drive the code directly.
+ * The last callback started or set is kept in bench_timer_cb.
+ */
+struct timer_entry *
+olsr_start_timer(unsigned int rel_time __attribute__ ((unused)), uint8_t jitter_pct __attribute__ ((unused)),
+                 bool periodical __attribute__ ((unused)), timer_cb_func cb_func,
+                 void *context __attribute__ ((unused)), struct olsr_cookie_info *ci __attribute__ ((unused)))
+{
+  bench_timer_cb = cb_func;
+  return NULL;
+}
+
+void
+olsr_set_timer(struct timer_entry **timer_ptr, unsigned int rel_time __attribute__ ((unused)),
+               uint8_t jitter_pct __attribute__ ((unused)), bool periodical __attribute__ ((unused)),
+               timer_cb_func cb_func, void *context __attribute__ ((unused)),
+               struct olsr_cookie_info *ci __attribute__ ((unused)))
+{
+  bench_timer_cb = cb_func;
+  *timer_ptr = NULL;
+}
+
+void
+olsr_change_timer(struct timer_entry *timer __attribute__ ((unused)), unsigned int rel_time __attribute__ ((unused)),
+                  uint8_t jitter_pct __attribute__ ((unused)), bool periodical __attribute__ ((unused)))
+{
+}
+
+void
+olsr_stop_timer(struct timer_entry *timer __attribute__ ((unused)))
+{
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,153 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * bench_tc - TC edge parsing with the runtime and the LQ_STATIC binding
+ *
+ * Runs the per-edge work of olsr_input_tc() over 64-edge TC bodies:
+ * read the neighbor address, deserialize its LQ pair and calculate
+ * the edge cost. The Makefile builds this file twice, bench_tc with
+ * the runtime handler tree (etx_ff) and bench_tc_static with
+ * LQ_STATIC=ff. Both print the sum of all costs, which has to be
+ * the same.
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "tc_set.h"
+#include "link_set.h"
+#include "mid_set.h"
+#include "mpr.h"
+#include "lq_plugin.h"
+#include "parser.h"
+
+#include <string.h>
+
+#define BENCH_EDGES   64
+#define BENCH_ROUNDS  200000
+
+#define BENCH_STR(x) #x
+#define BENCH_XSTR(x) BENCH_STR(x)
+
+/* Stubs for the link set, MPR and the parser used by the handlers */
+struct list_node link_entry_head;
+
+union olsr_ip_addr *
+mid_lookup_main_addr(const union olsr_ip_addr *adr __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+struct link_entry *
+lookup_link_entry(const union olsr_ip_addr *remote __attribute__ ((unused)),
+                  const union olsr_ip_addr *remote_main __attribute__ ((unused)),
+                  const struct interface *local __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+void
+olsr_packetparser_add_function(packetparser_function * function __attribute__ ((unused)))
+{
+}
+
+void
+olsr_mpr_request_full(void)
+{
+}
+
+void
+signal_link_changes(bool val __attribute__ ((unused)))
+{
+}
+
+int
+main(void)
+{
+  static uint8_t body[BENCH_EDGES * 8];
+  static char lq_algorithm[] = "etx_ff";
+  struct tc_edge_entry *edge;
+  const uint8_t *curr;
+  unsigned long long sum = 0;
+  double start, elapsed;
+  int i, round;
+
+  olsr_cnf->ip_version = AF_INET;
+  olsr_cnf->ipsize = sizeof(struct in_addr);
+  olsr_cnf->lq_algorithm = lq_algorithm;
+  init_lq_handler_tree();
+
+  edge = olsr_malloc(sizeof(struct tc_edge_entry) + active_lq_handler->tc_lq_size, "bench tc edge");
+  for (i = 0; i < (int)sizeof(body); i++) {
+    body[i] = (uint8_t) (i * 37 + 11);
+  }
+
+  start = bench_now();
+  for (round = 0; round < BENCH_ROUNDS; round++) {
+    curr = body;
+    for (i = 0; i < BENCH_EDGES; i++) {
+      union olsr_ip_addr addr;
+
+      pkt_get_ipaddress(&curr, &addr);
+      olsr_deserialize_tc_lq_pair(&curr, edge);
+      sum += olsr_calc_tc_cost(edge) + addr.v4.s_addr;
+    }
+  }
+  elapsed = bench_now() - start;
+
+#ifdef LQ_STATIC
+  printf("LQ_STATIC=%s:    ", BENCH_XSTR(LQ_STATIC));
+#else
+  printf("runtime handler: ");
+#endif
+  printf("%.2f ns/edge, %.0f Medges/s, cost sum %llu\n", elapsed * 1e9 / ((double)BENCH_ROUNDS * BENCH_EDGES),
+         (double)BENCH_ROUNDS * BENCH_EDGES / elapsed / 1e6, sum);
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,100 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * The mantissa/exponent conversion as it was before it became table
+ * driven, kept as the reference for test_mantissa and bench_mantissa.
+ */
+
+#include "mantissa_ref.h"
+
+uint8_t
+ref_reltime_to_me(const olsr_reltime interval)
+{
+  uint8_t a, b;
+  const unsigned int unscaled_interval = interval / 125 * 2;
+
+  b = 0;
+  while (unscaled_interval >= (1U << b)) {
+    b++;
+  }
+
+  if (b == 0) {
+    a = 1;
+    b = 0;
+  } else {
+    b--;
+    if (b > 15) {
+      a = 15;
+      b = 15;
+    } else {
+      if (b >= 5) {
+        a = (interval - (125 << (b - 1))) / (125 << (b - 5));
+      } else {
+        a = (interval - (125 << (b - 1))) * (1 << (5 - b)) / 125;
+      }
+
+      b += a >> 4;
+      a &= 0x0f;
+    }
+  }
+
+  return (a << 4) | (b & 0x0F);
+}
+
+olsr_reltime
+ref_me_to_reltime(const uint8_t me)
+{
+  const uint8_t a = me >> 4;
+  const uint8_t b = me & 0x0F;
+
+  if (b >= 8) {
+    return ((16 + a) << (b - 8)) * 1000;
+  }
+  return ((16 + a) * 1000) >> (8 - b);
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
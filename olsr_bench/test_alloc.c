@@ -0,0 +1,361 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * test_alloc - count heap allocations of the HELLO processing path
+ *
+ * Feeds LQ HELLO messages of 20 neighbors, each announcing 50 2 hop
+ * neighbors, through olsr_input_hello() and then expires all 2 hop
+ * links again, as their timers would. After a few warm up rounds the
+ * messages, 2 hop entries and neighbor lists must come from the cookie
+ * pools only, so no further malloc(), calloc() or realloc() may be
+ * called by the daemon code.
+ *
+ * The program is linked with --wrap for the allocation functions.
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "interfaces.h"
+#include "lq_plugin.h"
+#include "link_set.h"
+#include "mid_set.h"
+#include "mpr_selector_set.h"
+#include "neighbor_table.h"
+#include "net_olsr.h"
+#include "parser.h"
+#include "process_package.h"
+#include "routing_table.h"
+#include "tc_set.h"
+#include "two_hop_neighbor_table.h"
+#include "build_msg.h"
+#include "duplicate_handler.h"
+#include "rebuild_packet.h"
+#include "mantissa.h"
+
+#include <string.h>
+
+#define TEST_NBR      20
+#define TEST_NBR2     50
+#define TEST_WARMUP   3
+#define TEST_ROUNDS   20
+
+void *__real_malloc(size_t);
+void *__real_calloc(size_t, size_t);
+void *__real_realloc(void *, size_t);
+void *__wrap_malloc(size_t);
+void *__wrap_calloc(size_t, size_t);
+void *__wrap_realloc(void *, size_t);
+
+static bool counting = false;
+static unsigned int allocations = 0;
+
+void *
+__wrap_malloc(size_t size)
+{
+  allocations += counting;
+  return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+  allocations += counting;
+  return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+  allocations += counting;
+  return __real_realloc(ptr, size);
+}
+
+/* Functions of sources the test does not link */
+struct interface *ifnet;
+static struct interface test_if;
+static char test_if_name[] = "test0";
+static struct if_config_options test_if_cnf;
+static struct olsr_if test_olsr_if;
+
+void
+olsr_parser_add_function(parse_function *function __attribute__ ((unused)), uint32_t type __attribute__ ((unused)))
+{
+}
+
+void
+olsr_packetparser_add_function(packetparser_function * function __attribute__ ((unused)))
+{
+}
+
+bool
+olsr_validate_address(const union olsr_ip_addr *adr __attribute__ ((unused)))
+{
+  return true;
+}
+
+struct interface *
+if_ifwithaddr(const union olsr_ip_addr *adr)
+{
+  return ipequal(adr, &test_if.ip_addr) ? &test_if : NULL;
+}
+
+struct interface *
+if_ifwithname(const char *if_name)
+{
+  return strcmp(if_name, test_if.int_name) == 0 ? &test_if : NULL;
+}
+
+struct rt_path *
+olsr_insert_routing_table(union olsr_ip_addr *dst __attribute__ ((unused)), int plen __attribute__ ((unused)),
+                          union olsr_ip_addr *originator __attribute__ ((unused)), int origin __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+void
+olsr_delete_routing_table(union olsr_ip_addr *dst __attribute__ ((unused)), int plen __attribute__ ((unused)),
+                          union olsr_ip_addr *originator __attribute__ ((unused)))
+{
+}
+
+bool
+olsr_input_tc(union olsr_message *msg __attribute__ ((unused)), struct interface *input_if __attribute__ ((unused)),
+              union olsr_ip_addr *from_addr __attribute__ ((unused)))
+{
+  return false;
+}
+
+bool
+olsr_input_hna(union olsr_message *msg __attribute__ ((unused)), struct interface *in_if __attribute__ ((unused)),
+               union olsr_ip_addr *from_addr __attribute__ ((unused)))
+{
+  return false;
+}
+
+struct tc_entry *tc_myself;
+
+struct tc_edge_entry *
+olsr_lookup_tc_edge(struct tc_entry *tc __attribute__ ((unused)), union olsr_ip_addr *edge_addr __attribute__ ((unused)))
+{
+  return NULL;
+}
+
+void
+olsr_delete_tc_edge_entry(struct tc_edge_entry *tc_edge __attribute__ ((unused)))
+{
+}
+
+void
+set_empty_tc_timer(uint32_t empty_tc_new __attribute__ ((unused)))
+{
+}
+
+void
+olsr_process_changes(void)
+{
+}
+
+void
+mid_chgestruct(struct mid_message *mmsg __attribute__ ((unused)), const union olsr_message *m __attribute__ ((unused)))
+{
+}
+
+void
+olsr_handle_mid_collision(union olsr_ip_addr *mid __attribute__ ((unused)), union olsr_ip_addr *orig __attribute__ ((unused)))
+{
+}
+
+/* An LQ HELLO of neighbor nbr, in wire format */
+static uint8_t hellos[TEST_NBR][MAXMESSAGESIZE];
+
+static union olsr_ip_addr
+test_addr(uint32_t id)
+{
+  union olsr_ip_addr addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.v4.s_addr = htonl(0x0a000000 | id);
+  return addr;
+}
+
+static uint8_t *
+test_put_link(uint8_t *curr, uint8_t link_code, const union olsr_ip_addr *addrs, int count)
+{
+  uint16_t size = 4 + count * (olsr_cnf->ipsize + 4);
+  int i;
+
+  *curr++ = link_code;
+  *curr++ = 0;
+  *curr++ = size >> 8;
+  *curr++ = size & 0xff;
+  for (i = 0; i < count; i++) {
+    memcpy(curr, &addrs[i], olsr_cnf->ipsize);
+    curr += olsr_cnf->ipsize;
+
+    /* link quality and neighbor link quality, both perfect */
+    *curr++ = 255;
+    *curr++ = 255;
+    *curr++ = 0;
+    *curr++ = 0;
+  }
+  return curr;
+}
+
+static void
+test_build_hello(int nbr)
+{
+  union olsr_ip_addr two_hop[TEST_NBR2];
+  union olsr_ip_addr orig = test_addr(0x10000 + nbr);
+  uint8_t *curr = hellos[nbr];
+  uint16_t size;
+  int i;
+
+  for (i = 0; i < TEST_NBR2; i++) {
+    two_hop[i] = test_addr(0x20000 + (nbr * TEST_NBR2 / 2 + i) % (TEST_NBR * TEST_NBR2));
+  }
+
+  *curr++ = LQ_HELLO_MESSAGE;
+  *curr++ = reltime_to_me(20 * MSEC_PER_SEC);
+  curr += 2;                           /* size, filled in below */
+  memcpy(curr, &orig, olsr_cnf->ipsize);
+  curr += olsr_cnf->ipsize;
+  *curr++ = 1;                         /* ttl */
+  *curr++ = 0;                         /* hop count */
+  *curr++ = 0;                         /* sequence number */
+  *curr++ = 0;
+  *curr++ = 0;                         /* reserved */
+  *curr++ = 0;
+  *curr++ = reltime_to_me(2 * MSEC_PER_SEC);
+  *curr++ = WILL_DEFAULT;
+
+  curr = test_put_link(curr, CREATE_LINK_CODE(SYM_NEIGH, SYM_LINK), &test_if.ip_addr, 1);
+  curr = test_put_link(curr, CREATE_LINK_CODE(SYM_NEIGH, UNSPEC_LINK), two_hop, TEST_NBR2);
+
+  size = curr - hellos[nbr];
+  hellos[nbr][2] = size >> 8;
+  hellos[nbr][3] = size & 0xff;
+}
+
+/* Run one round, returns the number of 2 hop links created */
+static int
+test_round(void)
+{
+  struct neighbor_entry *nbr;
+  int nbr2_links = 0, i;
+
+  now_times += MSEC_PER_SEC;
+
+  for (i = 0; i < TEST_NBR; i++) {
+    union olsr_ip_addr from = test_addr(0x10000 + i);
+
+    olsr_input_hello((union olsr_message *)hellos[i], &test_if, &from);
+  }
+
+  /* let all 2 hop links time out */
+  OLSR_FOR_ALL_NBR_ENTRIES(nbr) {
+    while (nbr->neighbor_2_list.next != &nbr->neighbor_2_list) {
+      olsr_expire_nbr2_list(nbr->neighbor_2_list.next);
+      nbr2_links++;
+    }
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(nbr);
+
+  return nbr2_links;
+}
+
+int
+main(void)
+{
+  int round, links = 0;
+
+  debug_handle = fopen("/dev/null", "w");
+  olsr_cnf->ip_version = AF_INET;
+  olsr_cnf->ipsize = sizeof(struct in_addr);
+  olsr_cnf->lq_level = 2;
+  olsr_cnf->lq_aging = 0.05;
+  olsr_cnf->mpr_coverage = 1;
+
+  test_if.ip_addr = test_addr(1);
+  test_if.int_name = test_if_name;
+  ifnet = &test_if;
+  test_olsr_if.name = test_if.int_name;
+  test_olsr_if.interf = &test_if;
+  test_olsr_if.cnf = &test_if_cnf;
+  olsr_cnf->interfaces = &test_olsr_if;
+  olsr_cnf->main_addr = test_if.ip_addr;
+
+  init_lq_handler_tree();
+  olsr_init_link_set();
+  olsr_init_neighbor_table();
+  olsr_init_two_hop_table();
+  olsr_init_mprs_set();
+  olsr_init_mid_set();
+  olsr_init_package_process();
+
+  for (round = 0; round < TEST_NBR; round++) {
+    test_build_hello(round);
+  }
+
+  for (round = 0; round < TEST_WARMUP; round++) {
+    test_round();
+  }
+
+  counting = true;
+  for (round = 0; round < TEST_ROUNDS; round++) {
+    links += test_round();
+  }
+  counting = false;
+
+  printf("%d rounds, %d 2 hop links created and expired, %u heap allocations\n", TEST_ROUNDS, links, allocations);
+  BENCH_CHECK(links == TEST_ROUNDS * TEST_NBR * TEST_NBR2);
+  BENCH_CHECK(allocations == 0);
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
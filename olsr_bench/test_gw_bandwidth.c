@@ -0,0 +1,553 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * test_gw_bandwidth - simulation of the bandwidth weighted gateway handler
+ *
+ * 300 nodes are placed at random in a unit square and linked when
+ * closer than 0.11, with etx_ff style link costs. Six of them are
+ * gateways with 100/50/20/10/4/2 Mbit/s uplinks. For every other node
+ * that reaches all gateways, the path costs of the gateways are fed
+ * into the real gateway code (gateway.c and its handlers) and a
+ * selection is triggered. The chosen gateway must have the lowest
+ * score, and the load on the gateways is reported for several weights.
+ *
+ * Then the path costs get +-15% noise for 100 rounds and the gateway
+ * switches are counted: for an undamped selection every round, for the
+ * 10 s re-evaluation timer with and without damping, and for -gwhyst,
+ * where several SPF runs and HNA refreshes happen between two timer
+ * rounds. Last, the damping rules are checked directly: three timer
+ * rounds before a switch, no matter how many SPF runs and HNA refreshes
+ * happen in between, immediate replacement of a lost gateway, and no
+ * replacement of a gateway set by the user.
+ */
+
+#include "bench.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "gateway.h"
+#include "gateway_bandwidth_handler.h"
+#include "tc_set.h"
+#include "lq_plugin.h"
+#include "kernel_tunnel.h"
+#include "kernel_routes.h"
+#include "interfaces.h"
+#include "duplicate_set.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SIM_NODES     300
+#define SIM_RANGE     0.11
+#define SIM_GATEWAYS  6
+#define SIM_ROUNDS    100
+#define SIM_WEIGHT    16384
+#define SIM_EVENTS    4                /* SPF runs per timer round with -gwhyst */
+
+static const uint32_t sim_uplink[SIM_GATEWAYS] = { 100000, 50000, 20000, 10000, 4000, 2000 };
+
+static olsr_linkcost link_cost[SIM_NODES][SIM_NODES];
+static olsr_linkcost gw_dist[SIM_GATEWAYS][SIM_NODES];
+static int gw_node[SIM_GATEWAYS];
+static int clients[SIM_NODES];
+static int client_count;
+
+static struct tc_entry sim_tc[SIM_GATEWAYS];
+static union olsr_ip_addr sim_addr[SIM_GATEWAYS];
+static struct gateway_entry *sim_gw[SIM_GATEWAYS];
+static timer_cb_func sim_bw_timer;
+
+/* Stubs for the TC set, the tunnel code and the table print */
+struct avl_tree tc_tree;
+
+struct tc_entry *
+olsr_lookup_tc_entry(union olsr_ip_addr *adr)
+{
+  int g;
+
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    if (ipequal(adr, &sim_addr[g])) {
+      return &sim_tc[g];
+    }
+  }
+  return NULL;
+}
+
+int
+olsr_os_init_iptunnel(void)
+{
+  return 0;
+}
+
+void
+olsr_os_cleanup_iptunnel(void)
+{
+}
+
+struct olsr_iptunnel_entry *
+olsr_os_add_ipip_tunnel(union olsr_ip_addr *target __attribute__ ((unused)),
+                        bool transportV4 __attribute__ ((unused)))
+{
+  static struct olsr_iptunnel_entry tunnel;
+
+  return &tunnel;
+}
+
+void
+olsr_os_del_ipip_tunnel(struct olsr_iptunnel_entry *t __attribute__ ((unused)))
+{
+}
+
+void
+olsr_os_inetgw_tunnel_route(uint32_t if_idx __attribute__ ((unused)), bool ipv4 __attribute__ ((unused)),
+                            bool set __attribute__ ((unused)))
+{
+}
+
+int
+olsr_add_ifchange_handler(void (*f) (int, struct interface *, enum olsr_ifchg_flag) __attribute__ ((unused)))
+{
+  return 0;
+}
+
+int
+olsr_remove_ifchange_handler(void (*f) (int, struct interface *, enum olsr_ifchg_flag) __attribute__ ((unused)))
+{
+  return 0;
+}
+
+int
+olsr_os_ifip(int ifindex __attribute__ ((unused)), union olsr_ip_addr *ip __attribute__ ((unused)),
+             bool create __attribute__ ((unused)))
+{
+  return 0;
+}
+
+int
+olsr_seqno_diff(uint16_t seqno1, uint16_t seqno2)
+{
+  return (int16_t) (seqno1 - seqno2);
+}
+
+const char *
+get_linkcost_text(olsr_linkcost cost __attribute__ ((unused)), bool route __attribute__ ((unused)),
+                  struct lqtextbuffer *buffer)
+{
+  buffer->buf[0] = 0;
+  return buffer->buf;
+}
+
+/* Deterministic random numbers in [0, 1) */
+static uint32_t rnd_state = 7;
+
+static double
+sim_random(void)
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return ((rnd_state >> 8) & 0xffffff) / 16777216.0;
+}
+
+static void
+sim_build_network(void)
+{
+  double x[SIM_NODES], y[SIM_NODES];
+  int i, j, g;
+
+  for (i = 0; i < SIM_NODES; i++) {
+    x[i] = sim_random();
+    y[i] = sim_random();
+  }
+  for (i = 0; i < SIM_NODES; i++) {
+    for (j = 0; j < SIM_NODES; j++) {
+      double d = sqrt((x[i] - x[j]) * (x[i] - x[j]) + (y[i] - y[j]) * (y[i] - y[j])) / SIM_RANGE;
+      double p;
+
+      link_cost[i][j] = ROUTE_COST_BROKEN;
+      if (i != j && d < 1) {
+        /* delivery ratio, the cost is 1024 / (lq * nlq) like etx_ff */
+        p = 1 - d * d * 0.7;
+        if (p < 0.3) {
+          p = 0.3;
+        }
+        link_cost[i][j] = (olsr_linkcost) (1024 / (p * p));
+      }
+    }
+  }
+
+  /* gateways on distinct nodes */
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    bool taken;
+
+    do {
+      gw_node[g] = sim_random() * SIM_NODES;
+      taken = false;
+      for (i = 0; i < g; i++) {
+        taken |= gw_node[i] == gw_node[g];
+      }
+    } while (taken);
+  }
+}
+
+/* Dijkstra on the dense matrix */
+static void
+sim_spf(int src, olsr_linkcost *dist)
+{
+  bool done[SIM_NODES];
+  int i, n;
+
+  for (i = 0; i < SIM_NODES; i++) {
+    dist[i] = ROUTE_COST_BROKEN;
+    done[i] = false;
+  }
+  dist[src] = 0;
+
+  for (n = 0; n < SIM_NODES; n++) {
+    int u = -1;
+
+    for (i = 0; i < SIM_NODES; i++) {
+      if (!done[i] && dist[i] != ROUTE_COST_BROKEN && (u < 0 || dist[i] < dist[u])) {
+        u = i;
+      }
+    }
+    if (u < 0) {
+      break;
+    }
+    done[u] = true;
+    for (i = 0; i < SIM_NODES; i++) {
+      if (link_cost[u][i] != ROUTE_COST_BROKEN && dist[u] + link_cost[u][i] < dist[i]) {
+        dist[i] = dist[u] + link_cost[u][i];
+      }
+    }
+  }
+}
+
+/* Path costs seen by a client, each scaled by 1 +- noise */
+static void
+sim_set_costs(int client, double noise)
+{
+  int g;
+
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    sim_tc[g].path_cost = gw_dist[g][client] * (1 - noise + 2 * noise * sim_random());
+  }
+  olsr_update_gateway_costs();
+}
+
+static uint64_t
+sim_score(unsigned int weight, int g)
+{
+  return (uint64_t)sim_tc[g].path_cost + (uint64_t)weight * GW_BANDWIDTH_REFERENCE / sim_uplink[g];
+}
+
+static int
+sim_current(void)
+{
+  struct gateway_entry *gw = olsr_get_ipv4_inet_gateway(NULL);
+  int g;
+
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    if (gw == sim_gw[g]) {
+      return g;
+    }
+  }
+  return -1;
+}
+
+/* Refresh the HNA of a gateway, keeping the uplink set by the simulation */
+static void
+sim_refresh_hna(int g)
+{
+  union olsr_ip_addr mask;
+
+  memset(&mask, 0, sizeof(mask));
+  mask.v6.s6_addr[GW_HNA_FLAGS] = GW_HNA_FLAG_IPV4;
+  olsr_update_gateway_entry(&sim_addr[g], &mask, 0, sim_gw[g]->seqno + 1);
+  sim_gw[g]->uplink = sim_uplink[g];
+}
+
+/* Start over without a gateway, with the given handler settings */
+static void
+sim_reset(unsigned int weight, unsigned int damping, unsigned int hysteresis)
+{
+  union olsr_ip_addr none;
+
+  memset(&none, 0, sizeof(none));
+  olsr_set_inet_gateway(&none, true, false, false);
+  olsr_gw_bandwidth_configure(weight, damping);
+  olsr_gw_bandwidth_init();
+  olsr_set_gateway_hysteresis(hysteresis);
+}
+
+static void
+sim_selection(unsigned int weight)
+{
+  int load[SIM_GATEWAYS];
+  uint64_t path_cost = 0;
+  double worst = 0;
+  int c, g;
+
+  memset(load, 0, sizeof(load));
+  for (c = 0; c < client_count; c++) {
+    uint64_t best = UINT64_MAX;
+    int chosen;
+
+    sim_reset(weight, 0, 0);
+    sim_set_costs(clients[c], 0);
+    olsr_trigger_inetgw_selection(true, false);
+
+    chosen = sim_current();
+    BENCH_CHECK(chosen >= 0);
+    for (g = 0; g < SIM_GATEWAYS; g++) {
+      if (sim_score(weight, g) < best) {
+        best = sim_score(weight, g);
+      }
+    }
+    BENCH_CHECK(sim_score(weight, chosen) == best);
+
+    load[chosen]++;
+    path_cost += sim_tc[chosen].path_cost;
+  }
+
+  printf("  weight %5u: clients", weight);
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    double share = (double)sim_uplink[g] / 1000 / load[g];
+
+    printf(" %3d", load[g]);
+    if (load[g] && (worst == 0 || share < worst)) {
+      worst = share;
+    }
+  }
+  printf(", worst %.2f Mbit/s per client, mean path cost %.0f\n", worst, (double)path_cost / client_count);
+}
+
+enum sim_trigger {
+  SIM_CHOOSEGW,
+  SIM_TIMER,
+  SIM_GWHYST
+};
+
+/* Average number of gateway switches per client over SIM_ROUNDS noisy rounds */
+static double
+sim_flaps(enum sim_trigger trigger, unsigned int damping, unsigned int hysteresis)
+{
+  int switches = 0;
+  int c, e, round;
+
+  rnd_state = 3;
+  for (c = 0; c < client_count; c++) {
+    int current;
+
+    sim_reset(SIM_WEIGHT, damping, hysteresis);
+    sim_set_costs(clients[c], 0.15);
+    olsr_trigger_inetgw_selection(true, false);
+    current = sim_current();
+
+    for (round = 1; round < SIM_ROUNDS; round++) {
+      sim_set_costs(clients[c], 0.15);
+      switch (trigger) {
+      case SIM_CHOOSEGW:
+        olsr_trigger_inetgw_selection(true, false);
+        break;
+      case SIM_TIMER:
+        sim_bw_timer(NULL);
+        break;
+      case SIM_GWHYST:
+        /* SPF runs and HNA refreshes between two timer rounds */
+        for (e = 0; e < SIM_EVENTS; e++) {
+          olsr_trigger_gatewayloss_check();
+          sim_refresh_hna(e % SIM_GATEWAYS);
+          sim_set_costs(clients[c], 0.15);
+        }
+        sim_bw_timer(NULL);
+        break;
+      }
+      if (sim_current() != current) {
+        current = sim_current();
+        switches++;
+      }
+    }
+  }
+  return (double)switches / client_count;
+}
+
+/* Set the path costs of all gateways directly */
+static void
+sim_costs(olsr_linkcost c0, olsr_linkcost c1, olsr_linkcost c2)
+{
+  int g;
+
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    sim_tc[g].path_cost = 100000;
+  }
+  sim_tc[0].path_cost = c0;
+  sim_tc[1].path_cost = c1;
+  sim_tc[2].path_cost = c2;
+  olsr_update_gateway_costs();
+}
+
+static void
+sim_check_damping(void)
+{
+  int i;
+
+  /* gateway 0 has twice the uplink of gateway 1, worth 164 path cost */
+  sim_reset(SIM_WEIGHT, 0, 10);
+  sim_costs(1000, 2000, 2000);
+  olsr_trigger_inetgw_selection(true, false);
+  BENCH_CHECK(sim_current() == 0);
+
+  /* gateway 1 is now clearly better, SPF runs and HNA refreshes do not switch ... */
+  sim_costs(1000, 500, 2000);
+  for (i = 0; i < 10; i++) {
+    olsr_trigger_gatewayloss_check();
+    olsr_trigger_inetgw_selection(true, false);
+    sim_refresh_hna(i % SIM_GATEWAYS);
+  }
+  BENCH_CHECK(sim_current() == 0);
+
+  /* ... the switch takes three timer rounds, whatever happens in between */
+  for (i = 0; i < 2; i++) {
+    sim_bw_timer(NULL);
+    olsr_trigger_gatewayloss_check();
+    olsr_trigger_gatewayloss_check();
+    sim_refresh_hna(1);
+    BENCH_CHECK(sim_current() == 0);
+  }
+  sim_bw_timer(NULL);
+  BENCH_CHECK(sim_current() == 1);
+
+  /* a lost gateway is replaced right away */
+  sim_costs(1000, ROUTE_COST_BROKEN, 2000);
+  olsr_trigger_gatewayloss_check();
+  BENCH_CHECK(sim_current() == 0);
+
+  /* a better gateway never replaces one set by the user ... */
+  olsr_set_inet_gateway(&sim_addr[2], true, false, true);
+  BENCH_CHECK(sim_current() == 2);
+  sim_costs(500, 3000, 2000);
+  olsr_trigger_gatewayloss_check();
+  olsr_trigger_gatewayloss_check();
+  olsr_trigger_gatewayloss_check();
+  sim_bw_timer(NULL);
+  sim_bw_timer(NULL);
+  sim_bw_timer(NULL);
+  BENCH_CHECK(sim_current() == 2);
+
+  /* ... unless it is lost */
+  sim_costs(500, 3000, ROUTE_COST_BROKEN);
+  olsr_trigger_gatewayloss_check();
+  BENCH_CHECK(sim_current() == 0);
+
+  printf("damping: three timer rounds before a switch, lost and user gateways handled\n");
+}
+
+int
+main(void)
+{
+  double undamped, timer, timer_damped, gwhyst;
+  int c, g;
+
+  olsr_cnf->ip_version = AF_INET;
+  olsr_cnf->ipsize = sizeof(struct in_addr);
+
+  olsr_gw_bandwidth_configure(SIM_WEIGHT, 0);
+  BENCH_CHECK(olsr_init_gateways() == 0);
+  olsr_trigger_inetgw_startup();
+  sim_bw_timer = bench_timer_cb;
+  BENCH_CHECK(sim_bw_timer != NULL);
+
+  sim_build_network();
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    sim_spf(gw_node[g], gw_dist[g]);
+  }
+  for (c = 0; c < SIM_NODES; c++) {
+    bool reachable = true;
+
+    for (g = 0; g < SIM_GATEWAYS; g++) {
+      reachable &= c != gw_node[g] && gw_dist[g][c] != ROUTE_COST_BROKEN;
+    }
+    if (reachable) {
+      clients[client_count++] = c;
+    }
+  }
+  BENCH_CHECK(client_count > 0);
+
+  /* announce the gateways, the uplink is set directly */
+  for (g = 0; g < SIM_GATEWAYS; g++) {
+    union olsr_ip_addr mask;
+
+    sim_addr[g].v4.s_addr = htonl(0x0a000001 + g);
+    memset(&mask, 0, sizeof(mask));
+    mask.v6.s6_addr[GW_HNA_FLAGS] = GW_HNA_FLAG_IPV4;
+    olsr_update_gateway_entry(&sim_addr[g], &mask, 0, 1);
+    sim_gw[g] = olsr_find_gateway_entry(&sim_addr[g]);
+    BENCH_CHECK(sim_gw[g] != NULL);
+    sim_gw[g]->uplink = sim_uplink[g];
+  }
+
+  printf("%d nodes, %d clients, uplinks 100/50/20/10/4/2 Mbit/s\n", SIM_NODES, client_count);
+  sim_selection(0);
+  sim_selection(4096);
+  sim_selection(16384);
+  sim_selection(65536);
+
+  undamped = sim_flaps(SIM_CHOOSEGW, 0, 0);
+  timer = sim_flaps(SIM_TIMER, 0, 0);
+  timer_damped = sim_flaps(SIM_TIMER, 10, 0);
+  gwhyst = sim_flaps(SIM_GWHYST, 0, 10);
+  printf("switches per client in %d rounds with +-15%% cost noise, weight %d:\n", SIM_ROUNDS, SIM_WEIGHT);
+  printf("  undamped selection %.2f, timer %.2f, timer with 10%% damping %.2f,\n", undamped, timer, timer_damped);
+  printf("  -gwhyst 10 with %d SPF runs per timer round %.2f\n", SIM_EVENTS, gwhyst);
+  BENCH_CHECK(timer < undamped);
+  BENCH_CHECK(timer_damped < timer);
+  BENCH_CHECK(gwhyst < timer);
+
+  sim_check_damping();
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,108 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * test_mantissa - compare the mantissa/exponent conversion with the
+ * original loop based implementation
+ *
+ * Checks all 256 codes of me_to_reltime(), and reltime_to_me() for
+ * every interval below 2^24 ms, one in 251 intervals above and the
+ * intervals next to every code boundary. With -a every one of the
+ * 2^32 intervals is checked.
+ *
+ * Usage: test_mantissa [-a]
+ */
+
+#include "bench.h"
+#include "mantissa_ref.h"
+
+#include <string.h>
+
+static unsigned int mismatches = 0;
+
+static void
+test_interval(olsr_reltime interval)
+{
+  if (reltime_to_me(interval) != ref_reltime_to_me(interval)) {
+    if (mismatches++ < 10) {
+      printf("reltime_to_me(%u) = 0x%02x, expected 0x%02x\n", interval, reltime_to_me(interval),
+             ref_reltime_to_me(interval));
+    }
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  bool all = argc > 1 && strcmp(argv[1], "-a") == 0;
+  uint64_t interval, step;
+  unsigned int me;
+
+  for (me = 0; me < 256; me++) {
+    olsr_reltime boundary = ref_me_to_reltime(me);
+
+    if (me_to_reltime(me) != boundary) {
+      if (mismatches++ < 10) {
+        printf("me_to_reltime(0x%02x) = %u, expected %u\n", me, me_to_reltime(me), boundary);
+      }
+    }
+    test_interval(boundary - 1);
+    test_interval(boundary);
+    test_interval(boundary + 1);
+  }
+
+  for (interval = 0; interval <= UINT32_MAX; interval += step) {
+    step = all || interval < (1 << 24) ? 1 : 251;
+    test_interval(interval);
+  }
+  test_interval(UINT32_MAX);
+
+  printf("256 codes and %s intervals checked, %u mismatches\n", all ? "all" : "sampled", mismatches);
+  BENCH_CHECK(mismatches == 0);
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -42,12 +42,60 @@
 #include "defs.h"
 #include "olsr_cookie.h"
 #include "log.h"
+#include "scheduler.h"
+#include "common/autobuf.h"
 
 #include <assert.h>
+#include <stdint.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
 
 /* Root directory of the cookies we have in the system */
 static struct olsr_cookie_info *cookies[COOKIE_ID_MAX] = { 0 };
 
+/*
+ * Bytes held by all memory cookies, and the limit for it. Whole slabs
+ * are counted, heap blocks with their brand, including the free list.
+ */
+static size_t cookie_mem_usage = 0;
+static size_t cookie_mem_budget = 0;
+
+/* Size of a slab, one page */
+static size_t cookie_slab_size = 0;
+
+/* Offset of the first block in a slab */
+#define COOKIE_SLAB_HEADER \
+  ((sizeof(struct olsr_cookie_slab) + COOKIE_SLAB_ALIGN - 1) & ~(size_t)(COOKIE_SLAB_ALIGN - 1))
+
+LISTNODE2STRUCT(list2slab, struct olsr_cookie_slab, cs_node);
+
+static void olsr_cookie_slab_release(struct olsr_cookie_info *, struct olsr_cookie_slab *);
+
+/*
+ * Get the slab size, which is the page size of the system.
+ */
+static size_t
+olsr_cookie_slab_size(void)
+{
+  if (cookie_slab_size == 0) {
+#ifndef WIN32
+    long pagesize = sysconf(_SC_PAGESIZE);
+
+    /* masking a block address needs a power of two */
+    if (pagesize > 0 && (pagesize & (pagesize - 1)) == 0) {
+      cookie_slab_size = pagesize;
+    } else
+#endif
+      cookie_slab_size = COOKIE_SLAB_SIZE;
+  }
+  return cookie_slab_size;
+}
+
 /*
  * Allocate a cookie for the next available cookie id.
  */
@@ -79,9 +127,11 @@ olsr_alloc_cookie(const char *cookie_name, olsr_cookie_type cookie_type)
     ci->ci_name = strdup(cookie_name);
   }
 
-  /* Init the free list */
+  /* Init the free list and the slab lists */
   if (cookie_type == OLSR_COOKIE_TYPE_MEMORY) {
     list_head_init(&ci->ci_free_list);
+    list_head_init(&ci->ci_slab_partial);
+    list_head_init(&ci->ci_slab_full);
   }
 
   return ci;
@@ -109,6 +159,22 @@ olsr_free_cookie(struct olsr_cookie_info *ci)
       memory_list = ci->ci_free_list.next;
       list_remove(memory_list);
       free(memory_list);
+      cookie_mem_usage -= ci->ci_size + sizeof(struct olsr_cookie_mem_brand);
+    }
+
+    /* And all the slabs */
+    while (!list_is_empty(&ci->ci_slab_partial)) {
+      memory_list = ci->ci_slab_partial.next;
+      list_remove(memory_list);
+      olsr_cookie_slab_release(ci, list2slab(memory_list));
+    }
+    while (!list_is_empty(&ci->ci_slab_full)) {
+      memory_list = ci->ci_slab_full.next;
+      list_remove(memory_list);
+      olsr_cookie_slab_release(ci, list2slab(memory_list));
+    }
+    if (ci->ci_slab_spare) {
+      olsr_cookie_slab_release(ci, ci->ci_slab_spare);
     }
   }
 
@@ -146,7 +212,139 @@ olsr_cookie_set_memory_size(struct olsr_cookie_info *ci, size_t size)
   }
 
   assert(ci->ci_type == OLSR_COOKIE_TYPE_MEMORY);
+  assert(ci->ci_usage == 0);
   ci->ci_size = size;
+
+  /*
+   * Blocks which fit at least COOKIE_SLAB_MIN_BLOCKS times into
+   * a slab are allocated from slabs, others from the heap.
+   */
+  ci->ci_slab_stride = (size + sizeof(struct olsr_cookie_mem_brand) + COOKIE_SLAB_ALIGN - 1) & ~(size_t)(COOKIE_SLAB_ALIGN - 1);
+  ci->ci_slab_blocks = (olsr_cookie_slab_size() - COOKIE_SLAB_HEADER) / ci->ci_slab_stride;
+  ci->ci_slab = ci->ci_slab_blocks >= COOKIE_SLAB_MIN_BLOCKS;
+}
+
+/*
+ * Get a new slab from the OS.
+ * Returns NULL if the system is out of memory.
+ */
+static struct olsr_cookie_slab *
+olsr_cookie_slab_new(struct olsr_cookie_info *ci)
+{
+  struct olsr_cookie_slab *slab;
+
+#ifdef WIN32
+  slab = _aligned_malloc(cookie_slab_size, cookie_slab_size);
+#else
+  /* mmap() returns page aligned memory, which is aligned to the slab size */
+  slab = mmap(NULL, cookie_slab_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (slab == MAP_FAILED) {
+    slab = NULL;
+  }
+#endif
+
+  if (!slab) {
+    return NULL;
+  }
+
+  slab->cs_ci = ci;
+  slab->cs_free = NULL;
+  slab->cs_used = 0;
+  slab->cs_carved = 0;
+  list_node_init(&slab->cs_node);
+  ci->ci_slab_count++;
+  cookie_mem_usage += cookie_slab_size;
+
+  return slab;
+}
+
+/*
+ * Give an empty slab back to the OS.
+ */
+static void
+olsr_cookie_slab_release(struct olsr_cookie_info *ci, struct olsr_cookie_slab *slab)
+{
+#ifdef WIN32
+  _aligned_free(slab);
+#else
+  munmap(slab, cookie_slab_size);
+#endif
+  ci->ci_slab_count--;
+  cookie_mem_usage -= cookie_slab_size;
+}
+
+/*
+ * Carve a block out of the first slab with free blocks.
+ */
+static void *
+olsr_cookie_slab_alloc(struct olsr_cookie_info *ci)
+{
+  struct olsr_cookie_slab *slab;
+  void *ptr;
+
+  if (list_is_empty(&ci->ci_slab_partial)) {
+    if (ci->ci_slab_spare) {
+      slab = ci->ci_slab_spare;
+      ci->ci_slab_spare = NULL;
+    } else {
+      slab = olsr_cookie_slab_new(ci);
+      if (!slab) {
+        return NULL;
+      }
+    }
+    list_add_after(&ci->ci_slab_partial, &slab->cs_node);
+  }
+  slab = list2slab(ci->ci_slab_partial.next);
+
+  if (slab->cs_free) {
+    ptr = slab->cs_free;
+    slab->cs_free = *(void **)ptr;
+  } else {
+    ptr = (unsigned char *)slab + COOKIE_SLAB_HEADER + slab->cs_carved * ci->ci_slab_stride;
+    slab->cs_carved++;
+  }
+  memset(ptr, 0, ci->ci_size);
+
+  /* Move the slab out of the way once it is full */
+  if (++slab->cs_used == ci->ci_slab_blocks) {
+    list_remove(&slab->cs_node);
+    list_add_before(&ci->ci_slab_full, &slab->cs_node);
+  }
+
+  return ptr;
+}
+
+/*
+ * Return a block to its slab.
+ * Keep one empty slab for reuse, release the others.
+ */
+static void
+olsr_cookie_slab_free(struct olsr_cookie_info *ci, void *ptr)
+{
+  struct olsr_cookie_slab *slab;
+
+  slab = (struct olsr_cookie_slab *)((uintptr_t)ptr & ~(uintptr_t)(cookie_slab_size - 1));
+
+  /* The block has to belong to a slab of this cookie */
+  assert(slab->cs_ci == ci && slab->cs_used > 0);
+
+  if (slab->cs_used == ci->ci_slab_blocks) {
+    /* Refill the fuller slabs first, to give the others a chance to drain */
+    list_remove(&slab->cs_node);
+    list_add_before(&ci->ci_slab_partial, &slab->cs_node);
+  }
+
+  *(void **)ptr = slab->cs_free;
+  slab->cs_free = ptr;
+
+  if (--slab->cs_used == 0) {
+    list_remove(&slab->cs_node);
+    if (!ci->ci_slab_spare) {
+      ci->ci_slab_spare = slab;
+    } else {
+      olsr_cookie_slab_release(ci, slab);
+    }
+  }
 }
 
 /*
@@ -202,10 +400,48 @@ olsr_cookie_name(olsr_cookie_t cookie_id)
 }
 
 /*
- * Allocate a fixed amount of memory based on a passed in cookie type.
+ * Set the maximum number of blocks a cookie may hand out.
+ * Only enforced by olsr_cookie_try_malloc(), 0 means no limit.
  */
-void *
-olsr_cookie_malloc(struct olsr_cookie_info *ci)
+void
+olsr_cookie_set_budget(struct olsr_cookie_info *ci, unsigned int max_blocks)
+{
+  assert(ci->ci_type == OLSR_COOKIE_TYPE_MEMORY);
+  ci->ci_budget = max_blocks;
+}
+
+/*
+ * Set the maximum number of bytes all memory cookies together may
+ * hand out. Only enforced by olsr_cookie_try_malloc(), 0 means no limit.
+ */
+void
+olsr_cookie_set_global_budget(size_t bytes)
+{
+  cookie_mem_budget = bytes;
+}
+
+/*
+ * Check if either the budget of a cookie or the global budget
+ * is close to being exhausted.
+ */
+bool
+olsr_cookie_under_pressure(const struct olsr_cookie_info *ci)
+{
+  if (ci->ci_budget && (uint64_t)ci->ci_usage * 100 >= (uint64_t)ci->ci_budget * COOKIE_PRESSURE_PERCENT) {
+    return true;
+  }
+  if (cookie_mem_budget && (uint64_t)cookie_mem_usage * 100 >= (uint64_t)cookie_mem_budget * COOKIE_PRESSURE_PERCENT) {
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Get a block from the slabs, the free list or the heap.
+ * Returns NULL if the system is out of memory.
+ */
+static void *
+olsr_cookie_get_block(struct olsr_cookie_info *ci)
 {
   void *ptr;
   struct olsr_cookie_mem_brand *branding;
@@ -213,21 +449,24 @@ olsr_cookie_malloc(struct olsr_cookie_info *ci)
   bool reuse = false;
 
   /*
+   * Small blocks come from the slabs.
    * Check first if we have reusable memory.
    */
-  if (!ci->ci_free_list_usage) {
+  if (ci->ci_slab) {
+    ptr = olsr_cookie_slab_alloc(ci);
+    if (!ptr) {
+      return NULL;
+    }
+  } else if (!ci->ci_free_list_usage) {
 
     /*
      * No reusable memory block on the free_list.
      */
     ptr = calloc(1, ci->ci_size + sizeof(struct olsr_cookie_mem_brand));
-
     if (!ptr) {
-      const char *const err_msg = strerror(errno);
-      OLSR_PRINTF(1, "OUT OF MEMORY: %s\n", err_msg);
-      olsr_syslog(OLSR_LOG_ERR, "olsrd: out of memory!: %s\n", err_msg);
-      olsr_exit(ci->ci_name, EXIT_FAILURE);
+      return NULL;
     }
+    cookie_mem_usage += ci->ci_size + sizeof(struct olsr_cookie_mem_brand);
   } else {
 
     /*
@@ -261,6 +500,60 @@ olsr_cookie_malloc(struct olsr_cookie_info *ci)
   return ptr;
 }
 
+/*
+ * Allocate a fixed amount of memory based on a passed in cookie type.
+ * Budgets are not enforced, running out of memory is fatal.
+ */
+void *
+olsr_cookie_malloc(struct olsr_cookie_info *ci)
+{
+  void *ptr;
+
+  ptr = olsr_cookie_get_block(ci);
+  if (!ptr) {
+    const char *const err_msg = strerror(errno);
+    OLSR_PRINTF(1, "OUT OF MEMORY: %s\n", err_msg);
+    olsr_syslog(OLSR_LOG_ERR, "olsrd: out of memory!: %s\n", err_msg);
+    olsr_exit(ci->ci_name, EXIT_FAILURE);
+  }
+
+  return ptr;
+}
+
+/*
+ * Get the number of bytes the next allocation of a cookie adds to
+ * the memory held, 0 if a free block is at hand.
+ */
+static size_t
+olsr_cookie_growth(struct olsr_cookie_info *ci)
+{
+  if (ci->ci_slab) {
+    return list_is_empty(&ci->ci_slab_partial) && !ci->ci_slab_spare ? cookie_slab_size : 0;
+  }
+  return ci->ci_free_list_usage ? 0 : ci->ci_size + sizeof(struct olsr_cookie_mem_brand);
+}
+
+/*
+ * Allocate a fixed amount of memory based on a passed in cookie type.
+ * Returns NULL if the cookie or the global budget is exhausted or if
+ * the system is out of memory. The caller has to cope with that.
+ */
+void *
+olsr_cookie_try_malloc(struct olsr_cookie_info *ci)
+{
+  void *ptr = NULL;
+
+  if ((!ci->ci_budget || ci->ci_usage < ci->ci_budget)
+      && (!cookie_mem_budget || cookie_mem_usage + olsr_cookie_growth(ci) <= cookie_mem_budget)) {
+    ptr = olsr_cookie_get_block(ci);
+  }
+
+  if (!ptr) {
+    ci->ci_refused++;
+  }
+  return ptr;
+}
+
 /*
  * Free a memory block owned by a given cookie.
  * Run some corruption checks.
@@ -288,7 +581,10 @@ olsr_cookie_free(struct olsr_cookie_info *ci, void *ptr)
    * point. Keep at least ten percent of the active used blocks or at least
    * ten blocks on the free list.
    */
-  if ((ci->ci_free_list_usage < COOKIE_FREE_LIST_THRESHOLD) || (ci->ci_free_list_usage < ci->ci_usage / COOKIE_FREE_LIST_THRESHOLD)) {
+  if (ci->ci_slab) {
+    olsr_cookie_slab_free(ci, ptr);
+    reuse = true;
+  } else if ((ci->ci_free_list_usage < COOKIE_FREE_LIST_THRESHOLD) || (ci->ci_free_list_usage < ci->ci_usage / COOKIE_FREE_LIST_THRESHOLD)) {
 
     free_list_node = (struct list_node *)ptr;
     list_node_init(free_list_node);
@@ -302,6 +598,7 @@ olsr_cookie_free(struct olsr_cookie_info *ci, void *ptr)
      * No interest in reusing memory.
      */
     free(ptr);
+    cookie_mem_usage -= ci->ci_size + sizeof(struct olsr_cookie_mem_brand);
   }
 
   /* Stats keeping */
@@ -313,6 +610,90 @@ olsr_cookie_free(struct olsr_cookie_info *ci, void *ptr)
 
 }
 
+/*
+ * Print the memory usage of all memory cookies
+ * and how well their slabs are used.
+ */
+void
+olsr_print_cookie_usage(void)
+{
+#ifndef NODEBUG
+  int ci_index;
+
+  OLSR_PRINTF(1, "\n--- %s ------------------------------------------------- COOKIES\n\n", olsr_wallclock_string());
+  OLSR_PRINTF(1, "%-24s %-6s %-8s %-6s %-8s %s\n", "Name", "Size", "Usage", "Slabs", "Blocks", "Util");
+
+  for (ci_index = 1; ci_index < COOKIE_ID_MAX; ci_index++) {
+    struct olsr_cookie_info *ci = cookies[ci_index];
+
+    if (!ci || ci->ci_type != OLSR_COOKIE_TYPE_MEMORY) {
+      continue;
+    }
+
+    if (ci->ci_slab) {
+      unsigned int blocks = ci->ci_slab_count * ci->ci_slab_blocks;
+
+      OLSR_PRINTF(1, "%-24s %-6lu %-8u %-6u %-8u %u%%\n", ci->ci_name, (unsigned long)ci->ci_size, ci->ci_usage,
+                  ci->ci_slab_count, blocks, blocks ? ci->ci_usage * 100 / blocks : 0);
+    } else {
+      OLSR_PRINTF(1, "%-24s %-6lu %-8u %-6s %-8u -\n", ci->ci_name, (unsigned long)ci->ci_size, ci->ci_usage, "-",
+                  ci->ci_usage + ci->ci_free_list_usage);
+    }
+
+    if (ci->ci_budget || ci->ci_refused) {
+      OLSR_PRINTF(1, "%-24s budget %u blocks, %u refused%s\n", "", ci->ci_budget, ci->ci_refused,
+                  olsr_cookie_under_pressure(ci) ? ", under pressure" : "");
+    }
+  }
+
+  if (cookie_mem_budget) {
+    OLSR_PRINTF(1, "\nIn use %lu of %lu bytes budget\n", (unsigned long)cookie_mem_usage, (unsigned long)cookie_mem_budget);
+  }
+#endif
+}
+
+/*
+ * Append the usage of all cookies in the metrics exposition format.
+ */
+void
+olsr_cookie_print_metrics(struct autobuf *abuf)
+{
+  static const char *const type_names[OLSR_COOKIE_TYPE_MAX] = { "", "memory", "timer" };
+  int ci_index;
+
+  abuf_puts(abuf, "# HELP olsr_cookie_usage Blocks or timers in use.\n# TYPE olsr_cookie_usage gauge\n");
+  for (ci_index = 1; ci_index < COOKIE_ID_MAX; ci_index++) {
+    const struct olsr_cookie_info *ci = cookies[ci_index];
+
+    if (ci) {
+      abuf_appendf(abuf, "olsr_cookie_usage{cookie=\"%s\",type=\"%s\"} %u\n", ci->ci_name, type_names[ci->ci_type], ci->ci_usage);
+    }
+  }
+
+  abuf_puts(abuf, "# HELP olsr_cookie_changes_total Allocations and releases.\n# TYPE olsr_cookie_changes_total counter\n");
+  for (ci_index = 1; ci_index < COOKIE_ID_MAX; ci_index++) {
+    const struct olsr_cookie_info *ci = cookies[ci_index];
+
+    if (ci) {
+      abuf_appendf(abuf, "olsr_cookie_changes_total{cookie=\"%s\",type=\"%s\"} %u\n", ci->ci_name, type_names[ci->ci_type],
+                   ci->ci_changes);
+    }
+  }
+
+  abuf_puts(abuf, "# HELP olsr_cookie_refused_total Allocations refused by the memory budget.\n"
+            "# TYPE olsr_cookie_refused_total counter\n");
+  for (ci_index = 1; ci_index < COOKIE_ID_MAX; ci_index++) {
+    const struct olsr_cookie_info *ci = cookies[ci_index];
+
+    if (ci && ci->ci_type == OLSR_COOKIE_TYPE_MEMORY) {
+      abuf_appendf(abuf, "olsr_cookie_refused_total{cookie=\"%s\"} %u\n", ci->ci_name, ci->ci_refused);
+    }
+  }
+
+  abuf_appendf(abuf, "# HELP olsr_memory_bytes Bytes held by memory cookies, including slab and brand overhead.\n# TYPE olsr_memory_bytes gauge\n"
+               "olsr_memory_bytes %lu\n", (unsigned long)cookie_mem_usage);
+}
+
 /*
  * Local Variables:
  * c-basic-offset: 2
@@ -44,7 +44,10 @@
 #ifndef _OLSR_COOKIE_H
 #define _OLSR_COOKIE_H
 
-#define COOKIE_ID_MAX  25       /* maximum number of cookies in the system */
+#define COOKIE_ID_MAX  40       /* maximum number of cookies in the system */
+
+struct olsr_cookie_slab;
+struct autobuf;
 
 typedef enum olsr_cookie_type_ {
   OLSR_COOKIE_TYPE_MIN,
@@ -67,10 +70,41 @@ struct olsr_cookie_info {
   unsigned int ci_changes;             /* Stats, resource churn */
   struct list_node ci_free_list;       /* List head for recyclable blocks */
   unsigned int ci_free_list_usage;     /* Length of free list */
+  bool ci_slab;                        /* Blocks are carved out of slabs */
+  size_t ci_slab_stride;               /* Block size including brand */
+  unsigned int ci_slab_blocks;         /* Blocks per slab */
+  unsigned int ci_slab_count;          /* Slabs allocated, including the spare */
+  struct list_node ci_slab_partial;    /* Slabs with free blocks */
+  struct list_node ci_slab_full;       /* Slabs without free blocks */
+  struct olsr_cookie_slab *ci_slab_spare;       /* Empty slab kept for reuse */
+  unsigned int ci_budget;              /* Max blocks in use, 0 for no limit */
+  unsigned int ci_refused;             /* Stats, allocations refused */
 };
 
 #define COOKIE_FREE_LIST_THRESHOLD 10   /* Blocks / Percent  */
 
+/*
+ * A budget is under pressure once this share of it is in use.
+ */
+#define COOKIE_PRESSURE_PERCENT 90
+
+/*
+ * Small fixed size blocks are carved out of slabs of one page each.
+ * A slab is aligned to its size, so the owning slab of a block
+ * is found by masking the block address.
+ */
+#define COOKIE_SLAB_SIZE      4096      /* if the page size is unknown */
+#define COOKIE_SLAB_ALIGN     8
+#define COOKIE_SLAB_MIN_BLOCKS 8        /* larger blocks use calloc() */
+
+struct olsr_cookie_slab {
+  struct list_node cs_node;            /* Partial or full list of the cookie */
+  struct olsr_cookie_info *cs_ci;      /* Owner, checked on free */
+  void *cs_free;                       /* First free block */
+  unsigned int cs_used;                /* Blocks in use */
+  unsigned int cs_carved;              /* Blocks ever handed out */
+};
+
 /*
  * Small brand which gets appended on the end of every block allocation.
  * Helps to detect memory corruption, like overruns, double frees.
@@ -89,8 +123,15 @@ extern void olsr_cookie_set_memory_size(struct olsr_cookie_info *, size_t);
 extern void olsr_cookie_usage_incr(olsr_cookie_t);
 extern void olsr_cookie_usage_decr(olsr_cookie_t);
 
+extern void olsr_cookie_set_budget(struct olsr_cookie_info *, unsigned int);
+extern void olsr_cookie_set_global_budget(size_t);
+extern bool olsr_cookie_under_pressure(const struct olsr_cookie_info *);
+
 extern void *olsr_cookie_malloc(struct olsr_cookie_info *);
+extern void *olsr_cookie_try_malloc(struct olsr_cookie_info *);
 extern void olsr_cookie_free(struct olsr_cookie_info *, void *);
+extern void olsr_print_cookie_usage(void);
+extern void olsr_cookie_print_metrics(struct autobuf *);
 
 #endif /* _OLSR_COOKIE_H */
 
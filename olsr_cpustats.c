@@ -0,0 +1,317 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#if defined linux && !defined _GNU_SOURCE
+#define _GNU_SOURCE                     /* dladdr(3) */
+#endif
+
+#include "olsr_cpustats.h"
+#include "olsr.h"
+#include "defs.h"
+#include "log.h"
+#include "scheduler.h"
+#include "olsr_cookie.h"
+#include "common/autobuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#ifndef WIN32
+#include <dlfcn.h>
+#endif
+
+bool olsr_cpu_accounting = false;
+
+static const char *const cpu_kind_names[CPU_KIND_MAX] = {
+  "parser", "preproc", "pktparser", "ptf", "pcf", "socket", "timer"
+};
+
+/* upper bounds of the latency buckets */
+static const uint32_t cpu_bucket_usec[CPU_STATS_BUCKETS] = { 1, 4, 16, 64, 256, 1024, 4096, 16384 };
+
+static struct avl_tree cpu_account_tree;
+static struct olsr_cookie_info *cpu_account_mem_cookie = NULL;
+
+/**
+ * Switch the callback accounting on or off.
+ *
+ * @param enable true to time all callbacks
+ */
+void
+olsr_cpustats_set(bool enable)
+{
+  olsr_cpu_accounting = enable;
+}
+
+/**
+ * @return a monotonic timestamp in nanoseconds
+ */
+uint64_t
+olsr_cpu_now(void)
+{
+#if defined CLOCK_MONOTONIC
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+/*
+ * The accounting tree is keyed by the address of the callback,
+ * or of the timer cookie and the callback.
+ */
+static int
+avl_comp_cpu_account(const void *key1, const void *key2)
+{
+  const struct olsr_cpu_id *id1 = key1;
+  const struct olsr_cpu_id *id2 = key2;
+
+  if (id1->key != id2->key) {
+    return id1->key < id2->key ? -1 : 1;
+  }
+  return id1->func < id2->func ? -1 : id1->func > id2->func;
+}
+
+/*
+ * Name a new account after the plugin and symbol of its function,
+ * timers after their cookie too. This is done once per callback,
+ * dladdr() is not cheap.
+ */
+static void
+cpu_account_name(struct olsr_cpu_account *acc, const void *func, const char *label)
+{
+  const char *owner = "olsrd";
+  const char *symbol = NULL;
+  char addr[2 * sizeof(void *) + 4];
+
+#ifndef WIN32
+  Dl_info info, core;
+
+  if (dladdr(func, &info) != 0) {
+    /* functions outside the daemon belong to a plugin */
+    if (info.dli_fname && dladdr((const void *)&olsr_cpu_account, &core) != 0 && info.dli_fbase != core.dli_fbase) {
+      owner = strrchr(info.dli_fname, '/') ? strrchr(info.dli_fname, '/') + 1 : info.dli_fname;
+    }
+
+    /*
+     * Only exported functions have a dynamic symbol (the daemon is
+     * linked with -export-dynamic), static ones are named by their
+     * offset into the object, see addr2line(1).
+     */
+    symbol = info.dli_sname;
+    if (symbol == NULL) {
+      snprintf(addr, sizeof(addr), "+%#lx", (unsigned long)((const char *)func - (const char *)info.dli_fbase));
+      symbol = addr;
+    }
+  }
+#endif
+
+  if (symbol == NULL) {
+    snprintf(addr, sizeof(addr), "%p", func);
+    symbol = addr;
+  }
+  if (label) {
+    snprintf(acc->name, sizeof(acc->name), "%s:%s/%s", owner, label, symbol);
+  } else {
+    snprintf(acc->name, sizeof(acc->name), "%s:%s", owner, symbol);
+  }
+}
+
+/**
+ * Charge a callback invocation to its account.
+ * Use OLSR_CPU_START/OLSR_CPU_STOP instead of calling this directly.
+ *
+ * @param start timestamp taken before the call
+ * @param kind the type of callback
+ * @param key the callback, or the cookie of a timer
+ * @param func the function called, to find its owner
+ * @param label name of the cookie to prefix the symbol with, may be NULL
+ */
+void
+olsr_cpu_account(uint64_t start, enum olsr_cpu_kind kind, void *key, const void *func, const char *label)
+{
+  struct olsr_cpu_account *acc;
+  struct olsr_cpu_id id;
+  struct avl_node *node;
+  uint64_t elapsed = olsr_cpu_now() - start;
+  int i;
+
+  if (cpu_account_mem_cookie == NULL) {
+    cpu_account_mem_cookie = olsr_alloc_cookie("CPU account", OLSR_COOKIE_TYPE_MEMORY);
+    olsr_cookie_set_memory_size(cpu_account_mem_cookie, sizeof(struct olsr_cpu_account));
+    avl_init(&cpu_account_tree, avl_comp_cpu_account);
+  }
+
+  id.key = key;
+  id.func = func;
+  node = avl_find(&cpu_account_tree, &id);
+  if (node) {
+    acc = node2cpu_account(node);
+  } else {
+    acc = olsr_cookie_malloc(cpu_account_mem_cookie);
+    acc->id = id;
+    acc->node.key = &acc->id;
+    acc->kind = kind;
+    cpu_account_name(acc, func, label);
+    avl_insert(&cpu_account_tree, &acc->node, AVL_DUP_NO);
+  }
+
+  acc->calls++;
+  acc->total_ns += elapsed;
+  if (elapsed > acc->max_ns) {
+    acc->max_ns = elapsed;
+  }
+
+  for (i = 0; i < CPU_STATS_BUCKETS && elapsed > (uint64_t)cpu_bucket_usec[i] * 1000; i++);
+  acc->buckets[i]++;
+}
+
+static int
+cpu_account_cmp_total(const void *p1, const void *p2)
+{
+  const struct olsr_cpu_account *acc1 = *(const struct olsr_cpu_account * const *)p1;
+  const struct olsr_cpu_account *acc2 = *(const struct olsr_cpu_account * const *)p2;
+
+  return acc1->total_ns < acc2->total_ns ? 1 : acc1->total_ns > acc2->total_ns ? -1 : 0;
+}
+
+/**
+ * Print the callbacks which used the most time,
+ * with a latency histogram each.
+ */
+void
+olsr_print_cpustats(void)
+{
+#ifndef NODEBUG
+  struct olsr_cpu_account **top;
+  struct avl_node *node;
+  unsigned int count = 0, i;
+  int b;
+
+  if (cpu_account_mem_cookie == NULL || cpu_account_tree.count == 0) {
+    return;
+  }
+
+  top = olsr_malloc(cpu_account_tree.count * sizeof(*top), "CPU stats");
+  for (node = avl_walk_first(&cpu_account_tree); node; node = avl_walk_next(node)) {
+    top[count++] = node2cpu_account(node);
+  }
+  qsort(top, count, sizeof(*top), cpu_account_cmp_total);
+
+  OLSR_PRINTF(1, "\n--- %s ----------------------------------------------------- CPU\n\n", olsr_wallclock_string());
+  OLSR_PRINTF(1, "%-40s %-9s %-10s %-10s %-8s %-8s\n", "Callback", "Kind", "Calls", "Total ms", "Avg us", "Max us");
+  OLSR_PRINTF(1, "%-40s <=1us <=4us <=16us <=64us <=256us <=1ms <=4ms <=16ms more\n", "");
+
+  for (i = 0; i < count && i < CPU_STATS_TOP; i++) {
+    const struct olsr_cpu_account *acc = top[i];
+
+    OLSR_PRINTF(1, "%-40s %-9s %-10llu %-10llu %-8llu %-8llu\n", acc->name, cpu_kind_names[acc->kind],
+                (unsigned long long)acc->calls, (unsigned long long)(acc->total_ns / 1000000),
+                (unsigned long long)(acc->total_ns / acc->calls / 1000), (unsigned long long)(acc->max_ns / 1000));
+    OLSR_PRINTF(1, "%-40s", "");
+    for (b = 0; b <= CPU_STATS_BUCKETS; b++) {
+      OLSR_PRINTF(1, " %llu", (unsigned long long)acc->buckets[b]);
+    }
+    OLSR_PRINTF(1, "\n");
+  }
+
+  free(top);
+#endif
+}
+
+/**
+ * Append the callback accounting in the metrics exposition format.
+ *
+ * @param abuf the output buffer
+ */
+void
+olsr_cpustats_print_metrics(struct autobuf *abuf)
+{
+  struct avl_node *node;
+
+  if (cpu_account_mem_cookie == NULL) {
+    return;
+  }
+
+  abuf_puts(abuf, "# HELP olsr_callback_seconds_total Time spent in a callback, including nested callbacks.\n"
+            "# TYPE olsr_callback_seconds_total counter\n");
+  for (node = avl_walk_first(&cpu_account_tree); node; node = avl_walk_next(node)) {
+    const struct olsr_cpu_account *acc = node2cpu_account(node);
+
+    abuf_appendf(abuf, "olsr_callback_seconds_total{kind=\"%s\",callback=\"%s\"} %llu.%09llu\n", cpu_kind_names[acc->kind],
+                 acc->name, (unsigned long long)(acc->total_ns / 1000000000), (unsigned long long)(acc->total_ns % 1000000000));
+  }
+
+  abuf_puts(abuf, "# HELP olsr_callback_duration_microseconds Duration of a callback.\n"
+            "# TYPE olsr_callback_duration_microseconds histogram\n");
+  for (node = avl_walk_first(&cpu_account_tree); node; node = avl_walk_next(node)) {
+    const struct olsr_cpu_account *acc = node2cpu_account(node);
+    uint64_t cumulative = 0;
+    int b;
+
+    for (b = 0; b < CPU_STATS_BUCKETS; b++) {
+      cumulative += acc->buckets[b];
+      abuf_appendf(abuf, "olsr_callback_duration_microseconds_bucket{kind=\"%s\",callback=\"%s\",le=\"%u\"} %llu\n",
+                   cpu_kind_names[acc->kind], acc->name, cpu_bucket_usec[b], (unsigned long long)cumulative);
+    }
+    abuf_appendf(abuf, "olsr_callback_duration_microseconds_bucket{kind=\"%s\",callback=\"%s\",le=\"+Inf\"} %llu\n",
+                 cpu_kind_names[acc->kind], acc->name, (unsigned long long)acc->calls);
+    abuf_appendf(abuf, "olsr_callback_duration_microseconds_sum{kind=\"%s\",callback=\"%s\"} %llu\n",
+                 cpu_kind_names[acc->kind], acc->name, (unsigned long long)(acc->total_ns / 1000));
+    abuf_appendf(abuf, "olsr_callback_duration_microseconds_count{kind=\"%s\",callback=\"%s\"} %llu\n",
+                 cpu_kind_names[acc->kind], acc->name, (unsigned long long)acc->calls);
+  }
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
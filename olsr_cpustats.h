@@ -0,0 +1,123 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#ifndef _OLSR_CPUSTATS_H
+#define _OLSR_CPUSTATS_H
+
+#include "olsr_types.h"
+#include "common/avl.h"
+
+/*
+ * CPU accounting of callbacks.
+ *
+ * With -cpustats every call of a parse function, preprocessor, packet
+ * parser, packet transform function, pcf, socket handler and timer is
+ * timed and charged to the callback, timers to their cookie and callback.
+ * The owner of a callback is the plugin it lives in. Times are inclusive, the
+ * socket handler of an interface includes the parse functions it runs.
+ */
+
+#define CPU_STATS_BUCKETS 8            /* latency histogram, see cpu_bucket_usec */
+#define CPU_STATS_TOP     10           /* callbacks shown by olsr_print_cpustats() */
+
+enum olsr_cpu_kind {
+  CPU_KIND_PARSER,
+  CPU_KIND_PREPROCESSOR,
+  CPU_KIND_PACKETPARSER,
+  CPU_KIND_PTF,
+  CPU_KIND_PCF,
+  CPU_KIND_SOCKET,
+  CPU_KIND_TIMER,
+  CPU_KIND_MAX
+};
+
+struct olsr_cpu_id {
+  const void *key;                     /* the callback or the timer cookie */
+  const void *func;                    /* the callback */
+};
+
+struct olsr_cpu_account {
+  struct avl_node node;                /* keyed by id */
+  struct olsr_cpu_id id;
+  enum olsr_cpu_kind kind;
+  char name[80];                       /* owner:function or owner:cookie/function */
+  uint64_t calls;
+  uint64_t total_ns;
+  uint64_t max_ns;
+  uint64_t buckets[CPU_STATS_BUCKETS + 1];     /* the last one is +Inf */
+};
+
+AVLNODE2STRUCT(node2cpu_account, struct olsr_cpu_account, node);
+
+extern bool olsr_cpu_accounting;
+
+/*
+ * Time a callback if accounting is active:
+ *
+ *   start = OLSR_CPU_START();
+ *   entry->function(...);
+ *   OLSR_CPU_STOP(start, CPU_KIND_PARSER, entry->function, entry->function, NULL);
+ */
+#define OLSR_CPU_START() (olsr_cpu_accounting ? olsr_cpu_now() : 0)
+
+#define OLSR_CPU_STOP(start, kind, key, func, label) do {              \
+    if (start) {                                                        \
+      olsr_cpu_account((start), (kind), (void *)(key), (const void *)(func), (label)); \
+    }                                                                   \
+  } while (0)
+
+void olsr_cpustats_set(bool);
+uint64_t olsr_cpu_now(void);
+void olsr_cpu_account(uint64_t, enum olsr_cpu_kind, void *, const void *, const char *);
+void olsr_print_cpustats(void);
+
+struct autobuf;
+void olsr_cpustats_print_metrics(struct autobuf *);
+
+#endif /* _OLSR_CPUSTATS_H */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
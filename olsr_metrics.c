@@ -0,0 +1,432 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#include "olsr_metrics.h"
+#include "olsr.h"
+#include "defs.h"
+#include "log.h"
+#include "scheduler.h"
+#include "interfaces.h"
+#include "net_olsr.h"
+#include "olsr_cookie.h"
+#include "olsr_cpustats.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef WIN32
+#define close(x) closesocket(x)
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+uint64_t olsr_metric_counters[METRIC_COUNTER_MAX];
+uint64_t olsr_metric_messages[256];
+
+static const struct {
+  const char *name;
+  const char *help;
+} metric_counter_names[METRIC_COUNTER_MAX] = {
+  [METRIC_PARSE_ERRORS] = {"olsr_parse_errors_total", "Malformed packets and messages received."},
+  [METRIC_DUPLICATES] = {"olsr_duplicates_total", "Messages not forwarded because they were seen before."},
+  [METRIC_FORWARDS] = {"olsr_forwards_total", "Messages forwarded."},
+  [METRIC_SPF_RUNS] = {"olsr_spf_runs_total", "Routing table calculations."},
+  [METRIC_ROUTE_ADDS] = {"olsr_route_adds_total", "Routes added to the kernel."},
+  [METRIC_ROUTE_CHANGES] = {"olsr_route_changes_total", "Routes replaced in the kernel."},
+  [METRIC_ROUTE_DELETES] = {"olsr_route_deletes_total", "Routes deleted from the kernel."},
+  [METRIC_ROUTE_ERRORS] = {"olsr_route_errors_total", "Failed kernel route operations."},
+  [METRIC_TIMERS_WALKED] = {"olsr_timers_walked_total", "Timers checked by the timer wheel."},
+  [METRIC_TIMERS_FIRED] = {"olsr_timers_fired_total", "Timer callbacks run."},
+};
+
+static struct olsr_histogram metric_histograms[HISTOGRAM_MAX] = {
+  [HISTOGRAM_SPF_USEC] = {"olsr_spf_duration_microseconds", "Duration of a routing table calculation.",
+                          {100, 250, 500, 1000, 2500, 5000, 10000, 50000}, {0}, 0},
+  [HISTOGRAM_RX_PACKET_SIZE] = {"olsr_rx_packet_bytes", "Size of received packets.",
+                                {64, 128, 256, 512, 768, 1024, 1280, 1500}, {0}, 0},
+};
+
+static uint16_t metrics_port = 0;
+static int metrics_sock = -1;
+
+/* a connected scraper and its pending response */
+struct metrics_client {
+  int fd;
+  unsigned int serial;                 /* order of the accept */
+  struct autobuf out;
+  size_t sent;
+};
+
+/* connected scrapers, the oldest is dropped if all slots are busy */
+static struct metrics_client metrics_clients[METRICS_MAX_CLIENTS];
+static unsigned int metrics_serial = 0;
+
+static void metrics_accept(int, void *, unsigned int);
+static void metrics_client_io(int, void *, unsigned int);
+
+/**
+ * Count a value into a histogram.
+ *
+ * @param id the histogram
+ * @param value the observed value
+ */
+void
+olsr_metric_observe(enum olsr_metric_histogram id, uint32_t value)
+{
+  struct olsr_histogram *h = &metric_histograms[id];
+  int i;
+
+  for (i = 0; i < METRICS_HISTOGRAM_BUCKETS && value > h->bounds[i]; i++);
+  h->buckets[i]++;
+  h->sum += value;
+}
+
+/**
+ * Set the local TCP port of the metrics endpoint, 0 disables it.
+ *
+ * @param port the port
+ */
+void
+olsr_metrics_set_port(uint16_t port)
+{
+  metrics_port = port;
+}
+
+/**
+ * Open the metrics endpoint on the loopback address
+ * if a port was configured.
+ *
+ * @return the listening socket, -1 if not active
+ */
+int
+olsr_metrics_init(void)
+{
+  struct sockaddr_in sin;
+  int yes = 1, i;
+
+  if (metrics_port == 0) {
+    return -1;
+  }
+
+  for (i = 0; i < METRICS_MAX_CLIENTS; i++) {
+    metrics_clients[i].fd = -1;
+  }
+
+  if ((metrics_sock = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+    perror("metrics socket");
+    olsr_exit("metrics socket", EXIT_FAILURE);
+  }
+
+  if (setsockopt(metrics_sock, SOL_SOCKET, SO_REUSEADDR, (char *)&yes, sizeof(yes)) < 0) {
+    perror("SO_REUSEADDR failed");
+  }
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sin.sin_port = htons(metrics_port);
+
+  if (bind(metrics_sock, (struct sockaddr *)&sin, sizeof(sin)) == -1) {
+    perror("metrics bind");
+    olsr_exit("metrics bind", EXIT_FAILURE);
+  }
+
+  if (listen(metrics_sock, METRICS_MAX_CLIENTS) == -1) {
+    perror("metrics listen");
+    olsr_exit("metrics listen", EXIT_FAILURE);
+  }
+
+  add_olsr_socket(metrics_sock, &metrics_accept, NULL, NULL, SP_PR_READ);
+
+  OLSR_PRINTF(1, "Metrics on 127.0.0.1:%u\n", metrics_port);
+  return metrics_sock;
+}
+
+/*
+ * Drop a scraper connection.
+ */
+static void
+metrics_client_close(struct metrics_client *client)
+{
+  remove_olsr_socket(client->fd, &metrics_client_io, NULL);
+  close(client->fd);
+  client->fd = -1;
+
+  if (client->out.buf != NULL) {
+    abuf_free(&client->out);
+  }
+}
+
+/**
+ * Close the metrics endpoint and all scraper connections.
+ */
+void
+olsr_metrics_shutdown(void)
+{
+  int i;
+
+  if (metrics_sock == -1) {
+    return;
+  }
+
+  for (i = 0; i < METRICS_MAX_CLIENTS; i++) {
+    if (metrics_clients[i].fd != -1) {
+      metrics_client_close(&metrics_clients[i]);
+    }
+  }
+
+  remove_olsr_socket(metrics_sock, &metrics_accept, NULL);
+  close(metrics_sock);
+  metrics_sock = -1;
+}
+
+static void
+metrics_accept(int fd, void *data __attribute__ ((unused)), unsigned int flags __attribute__ ((unused)))
+{
+  struct sockaddr_in pin;
+  socklen_t addrlen = sizeof(pin);
+  struct metrics_client *client = NULL;
+  int conn, i;
+
+  if ((conn = accept(fd, (struct sockaddr *)&pin, &addrlen)) == -1) {
+    perror("metrics accept");
+    return;
+  }
+
+#ifdef WIN32
+  {
+    unsigned long on = 1;
+    ioctlsocket(conn, FIONBIO, &on);
+  }
+#else
+  fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) | O_NONBLOCK);
+#endif
+
+  /* take a free slot, or the one of the oldest scraper */
+  for (i = 0; i < METRICS_MAX_CLIENTS; i++) {
+    if (metrics_clients[i].fd == -1) {
+      client = &metrics_clients[i];
+      break;
+    }
+    if (client == NULL || metrics_serial - metrics_clients[i].serial > metrics_serial - client->serial) {
+      client = &metrics_clients[i];
+    }
+  }
+  if (client->fd != -1) {
+    metrics_client_close(client);
+  }
+
+  client->fd = conn;
+  client->serial = metrics_serial++;
+  client->out.buf = NULL;
+  client->sent = 0;
+  add_olsr_socket(conn, &metrics_client_io, NULL, client, SP_PR_READ);
+}
+
+/*
+ * Send as much of the pending response as the socket takes,
+ * the connection is closed after the last byte.
+ */
+static void
+metrics_client_flush(struct metrics_client *client)
+{
+  ssize_t n;
+
+  n = send(client->fd, client->out.buf + client->sent, (size_t)client->out.len - client->sent, MSG_NOSIGNAL);
+  if (n < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return;
+    }
+    OLSR_PRINTF(1, "metrics send: %s\n", strerror(errno));
+    metrics_client_close(client);
+    return;
+  }
+
+  client->sent += n;
+  if (client->sent == (size_t)client->out.len) {
+    metrics_client_close(client);
+  }
+}
+
+/*
+ * Answer any request with all metrics, the response
+ * is written out whenever the socket becomes writable.
+ */
+static void
+metrics_client_io(int fd, void *data, unsigned int flags)
+{
+  struct metrics_client *client = data;
+  char request[1024];
+
+  if (flags & SP_PR_READ) {
+    ssize_t n = recv(fd, request, sizeof(request), 0);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      metrics_client_close(client);
+      return;
+    }
+
+    /* the request is not parsed, answer on the first bytes of it */
+    if (n > 0 && client->out.buf == NULL) {
+      if (abuf_init(&client->out, 4096) != 0) {
+        metrics_client_close(client);
+        return;
+      }
+      abuf_puts(&client->out, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n");
+      olsr_metrics_print(&client->out);
+
+      client->sent = 0;
+      enable_olsr_socket(fd, &metrics_client_io, NULL, SP_PR_WRITE);
+      flags |= SP_PR_WRITE;
+    }
+  }
+
+  if ((flags & SP_PR_WRITE) && client->fd != -1 && client->out.buf != NULL) {
+    metrics_client_flush(client);
+  }
+}
+
+/*
+ * Append a HELP and TYPE header.
+ */
+static void
+metrics_header(struct autobuf *abuf, const char *name, const char *type, const char *help)
+{
+  abuf_appendf(abuf, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void
+metrics_print_interfaces(struct autobuf *abuf)
+{
+  static const struct {
+    const char *name;
+    const char *help;
+    size_t offset;
+  } if_counters[] = {
+    {"olsr_interface_rx_packets_total", "Packets received on an interface.", offsetof(struct olsr_if_counters, rx_packets)},
+    {"olsr_interface_rx_bytes_total", "Bytes received on an interface.", offsetof(struct olsr_if_counters, rx_bytes)},
+    {"olsr_interface_tx_packets_total", "Packets sent on an interface.", offsetof(struct olsr_if_counters, tx_packets)},
+    {"olsr_interface_tx_bytes_total", "Bytes sent on an interface.", offsetof(struct olsr_if_counters, tx_bytes)},
+  };
+  struct interface *ifp;
+  unsigned int i;
+
+  for (i = 0; i < ARRAYSIZE(if_counters); i++) {
+    metrics_header(abuf, if_counters[i].name, "counter", if_counters[i].help);
+    for (ifp = ifnet; ifp; ifp = ifp->int_next) {
+      const uint64_t *value = (const uint64_t *)((const char *)&ifp->counters + if_counters[i].offset);
+
+      abuf_appendf(abuf, "%s{interface=\"%s\"} %llu\n", if_counters[i].name, ifp->int_name, (unsigned long long)*value);
+    }
+  }
+}
+
+static void
+metrics_print_histogram(struct autobuf *abuf, const struct olsr_histogram *h)
+{
+  uint64_t cumulative = 0;
+  int i;
+
+  metrics_header(abuf, h->name, "histogram", h->help);
+  for (i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+    cumulative += h->buckets[i];
+    abuf_appendf(abuf, "%s_bucket{le=\"%u\"} %llu\n", h->name, h->bounds[i], (unsigned long long)cumulative);
+  }
+  cumulative += h->buckets[METRICS_HISTOGRAM_BUCKETS];
+  abuf_appendf(abuf, "%s_bucket{le=\"+Inf\"} %llu\n", h->name, (unsigned long long)cumulative);
+  abuf_appendf(abuf, "%s_sum %llu\n%s_count %llu\n", h->name, (unsigned long long)h->sum, h->name,
+               (unsigned long long)cumulative);
+}
+
+/**
+ * Append all metrics in the text exposition format.
+ *
+ * @param abuf the output buffer
+ */
+void
+olsr_metrics_print(struct autobuf *abuf)
+{
+  const struct net_tx_stats *tx_stats = net_get_tx_stats();
+  int i;
+
+  for (i = 0; i < METRIC_COUNTER_MAX; i++) {
+    metrics_header(abuf, metric_counter_names[i].name, "counter", metric_counter_names[i].help);
+    abuf_appendf(abuf, "%s %llu\n", metric_counter_names[i].name, (unsigned long long)olsr_metric_counters[i]);
+  }
+
+  metrics_header(abuf, "olsr_messages_total", "counter", "Messages received by message type.");
+  for (i = 0; i < 256; i++) {
+    if (olsr_metric_messages[i]) {
+      abuf_appendf(abuf, "olsr_messages_total{type=\"%d\"} %llu\n", i, (unsigned long long)olsr_metric_messages[i]);
+    }
+  }
+
+  metrics_print_interfaces(abuf);
+
+  metrics_header(abuf, "olsr_tx_syscalls_total", "counter", "System calls used to send packets.");
+  abuf_appendf(abuf, "olsr_tx_syscalls_total %u\n", tx_stats->syscalls);
+  metrics_header(abuf, "olsr_tx_errors_total", "counter", "Packets dropped by failed send calls.");
+  abuf_appendf(abuf, "olsr_tx_errors_total %u\n", tx_stats->errors);
+
+  for (i = 0; i < HISTOGRAM_MAX; i++) {
+    metrics_print_histogram(abuf, &metric_histograms[i]);
+  }
+
+  olsr_cookie_print_metrics(abuf);
+  olsr_cpustats_print_metrics(abuf);
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,111 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#ifndef _OLSR_METRICS_H
+#define _OLSR_METRICS_H
+
+#include "olsr_types.h"
+#include "common/autobuf.h"
+
+/*
+ * Runtime counters and histograms, served in the Prometheus text
+ * exposition format on a local TCP port.
+ *
+ * Counters are plain increments on the hot paths and always active,
+ * the socket only exists with -metrics <port>. Per interface packet
+ * counters live in struct interface, memory usage is read from the
+ * cookies when a scrape comes in.
+ */
+
+#define METRICS_MAX_CLIENTS 4          /* concurrent scrapes, the oldest is dropped */
+#define METRICS_HISTOGRAM_BUCKETS 8
+
+enum olsr_metric_counter {
+  METRIC_PARSE_ERRORS,                 /* malformed packets and messages */
+  METRIC_DUPLICATES,                   /* messages not forwarded again */
+  METRIC_FORWARDS,                     /* messages forwarded */
+  METRIC_SPF_RUNS,                     /* routing table calculations */
+  METRIC_ROUTE_ADDS,                   /* routes added to the kernel */
+  METRIC_ROUTE_CHANGES,                /* routes replaced in the kernel */
+  METRIC_ROUTE_DELETES,                /* routes deleted from the kernel */
+  METRIC_ROUTE_ERRORS,                 /* failed kernel route operations */
+  METRIC_TIMERS_WALKED,                /* timers checked by the timer wheel */
+  METRIC_TIMERS_FIRED,                 /* timer callbacks run */
+  METRIC_COUNTER_MAX
+};
+
+enum olsr_metric_histogram {
+  HISTOGRAM_SPF_USEC,                  /* duration of a routing table calculation */
+  HISTOGRAM_RX_PACKET_SIZE,            /* size of received packets */
+  HISTOGRAM_MAX
+};
+
+struct olsr_histogram {
+  const char *name;
+  const char *help;
+  uint32_t bounds[METRICS_HISTOGRAM_BUCKETS];  /* ascending upper bounds */
+  uint64_t buckets[METRICS_HISTOGRAM_BUCKETS + 1];     /* the last one is +Inf */
+  uint64_t sum;
+};
+
+extern uint64_t olsr_metric_counters[METRIC_COUNTER_MAX];
+extern uint64_t olsr_metric_messages[256];
+
+#define OLSR_METRIC_INC(id)     (olsr_metric_counters[(id)]++)
+#define OLSR_METRIC_ADD(id, n)  (olsr_metric_counters[(id)] += (n))
+#define OLSR_METRIC_MESSAGE(type) (olsr_metric_messages[(uint8_t)(type)]++)
+
+void olsr_metric_observe(enum olsr_metric_histogram, uint32_t);
+
+void olsr_metrics_set_port(uint16_t);
+int olsr_metrics_init(void);
+void olsr_metrics_shutdown(void);
+void olsr_metrics_print(struct autobuf *);
+
+#endif /* _OLSR_METRICS_H */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,241 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+/*
+ * olsr_snapdump - print the link state snapshot written by olsrd -snapshot
+ *
+ * Usage: olsr_snapdump <snapshot file>
+ */
+
+#include "olsr_snapshot.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_RETRIES 1000
+
+static const char *
+addr_str(int family, const union olsr_ip_addr *addr, char *buf)
+{
+  return inet_ntop(family, addr, buf, INET6_ADDRSTRLEN);
+}
+
+/*
+ * Check a table lies within the copied snapshot.
+ */
+static bool
+table_valid(const struct olsr_snapshot_header *hdr, enum olsr_snapshot_table table, uint32_t record_size, uint32_t len)
+{
+  const struct olsr_snapshot_section *section = &hdr->ss_tables[table];
+
+  return section->ss_record_size == record_size && section->ss_offset <= len
+    && section->ss_count <= (len - section->ss_offset) / record_size;
+}
+
+/*
+ * Copy a consistent snapshot out of the mapping.
+ * Returns the number of bytes copied or 0 if the writer kept interfering.
+ */
+static uint32_t
+copy_snapshot(const struct olsr_snapshot_header *snap, char *buf, uint32_t size)
+{
+  const struct olsr_snapshot_header *hdr = (const struct olsr_snapshot_header *)buf;
+  int retries;
+
+  for (retries = 0; retries < SNAPSHOT_RETRIES; retries++) {
+    uint32_t seq, len, table;
+
+    seq = snap->ss_seq;
+    __sync_synchronize();
+
+    if ((seq & 1) == 0) {
+      /* copy the header first to learn the used length */
+      memcpy(buf, snap, sizeof(*hdr));
+      len = sizeof(*hdr);
+      for (table = 0; table < SNAPSHOT_TABLE_MAX; table++) {
+        const struct olsr_snapshot_section *section = &hdr->ss_tables[table];
+        uint64_t end = (uint64_t)section->ss_offset + (uint64_t)section->ss_count * section->ss_record_size;
+
+        if (end > len && end <= size) {
+          len = end;
+        }
+      }
+      memcpy(buf, snap, len);
+
+      __sync_synchronize();
+      if (seq == snap->ss_seq) {
+        return len;
+      }
+    }
+    usleep(1000);
+  }
+  return 0;
+}
+
+static void
+print_snapshot(const struct olsr_snapshot_header *hdr, uint32_t len)
+{
+  const char *base = (const char *)hdr;
+  const struct olsr_snapshot_section *section;
+  char buf1[INET6_ADDRSTRLEN], buf2[INET6_ADDRSTRLEN];
+  int family = hdr->ss_family;
+  uint32_t i;
+
+  printf("Snapshot %u at %u.%03u\n", hdr->ss_seq / 2, hdr->ss_time / 1000, hdr->ss_time % 1000);
+
+  section = &hdr->ss_tables[SNAPSHOT_LINKS];
+  if (table_valid(hdr, SNAPSHOT_LINKS, sizeof(struct olsr_snapshot_link), len)) {
+    const struct olsr_snapshot_link *sl = (const struct olsr_snapshot_link *)(base + section->ss_offset);
+
+    printf("\nLinks: %u\n", section->ss_count);
+    for (i = 0; i < section->ss_count; i++, sl++) {
+      printf("%-16s %-16s %10u if %d\n", addr_str(family, &sl->sl_local, buf1), addr_str(family, &sl->sl_neighbor, buf2),
+             sl->sl_cost, sl->sl_if_index);
+    }
+  }
+
+  section = &hdr->ss_tables[SNAPSHOT_NEIGHBORS];
+  if (table_valid(hdr, SNAPSHOT_NEIGHBORS, sizeof(struct olsr_snapshot_neighbor), len)) {
+    const struct olsr_snapshot_neighbor *sn = (const struct olsr_snapshot_neighbor *)(base + section->ss_offset);
+
+    printf("\nNeighbors: %u\n", section->ss_count);
+    for (i = 0; i < section->ss_count; i++, sn++) {
+      printf("%-16s %s %s will %u links %u\n", addr_str(family, &sn->sn_addr, buf1), sn->sn_status ? "SYM" : "NOT_SYM",
+             sn->sn_is_mpr ? "MPR" : "-", sn->sn_willingness, sn->sn_linkcount);
+    }
+  }
+
+  section = &hdr->ss_tables[SNAPSHOT_EDGES];
+  if (table_valid(hdr, SNAPSHOT_EDGES, sizeof(struct olsr_snapshot_edge), len)) {
+    const struct olsr_snapshot_edge *se = (const struct olsr_snapshot_edge *)(base + section->ss_offset);
+
+    printf("\nTopology edges: %u\n", section->ss_count);
+    for (i = 0; i < section->ss_count; i++, se++) {
+      printf("%-16s %-16s %10u\n", addr_str(family, &se->se_from, buf1), addr_str(family, &se->se_to, buf2), se->se_cost);
+    }
+  }
+
+  section = &hdr->ss_tables[SNAPSHOT_ROUTES];
+  if (table_valid(hdr, SNAPSHOT_ROUTES, sizeof(struct olsr_snapshot_route), len)) {
+    const struct olsr_snapshot_route *sr = (const struct olsr_snapshot_route *)(base + section->ss_offset);
+
+    printf("\nRoutes: %u\n", section->ss_count);
+    for (i = 0; i < section->ss_count; i++, sr++) {
+      printf("%s/%u via %s cost %u hops %u if %d\n", addr_str(family, &sr->sr_dst, buf1), sr->sr_prefix_len,
+             addr_str(family, &sr->sr_gateway, buf2), sr->sr_cost, sr->sr_hops, sr->sr_if_index);
+    }
+  }
+
+  for (i = 0; i < SNAPSHOT_TABLE_MAX; i++) {
+    if (hdr->ss_tables[i].ss_truncated) {
+      printf("... %u records of table %u did not fit\n", hdr->ss_tables[i].ss_truncated, i);
+    }
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  const struct olsr_snapshot_header *snap;
+  struct stat st;
+  uint32_t len;
+  char *buf;
+  int fd;
+
+  if (argc != 2) {
+    fprintf(stderr, "Usage: olsr_snapdump <snapshot file>\n");
+    return EXIT_FAILURE;
+  }
+
+  fd = open(argv[1], O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "Cannot open %s: %s\n", argv[1], strerror(errno));
+    return EXIT_FAILURE;
+  }
+  if ((size_t)st.st_size < sizeof(*snap)) {
+    fprintf(stderr, "%s is not a snapshot file\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  snap = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (snap == MAP_FAILED) {
+    fprintf(stderr, "Cannot map %s: %s\n", argv[1], strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  if (memcmp(snap->ss_magic, OLSR_SNAPSHOT_MAGIC, sizeof(snap->ss_magic)) != 0
+      || snap->ss_version != OLSR_SNAPSHOT_VERSION || snap->ss_size > (size_t)st.st_size) {
+    fprintf(stderr, "%s is not a snapshot file of this version\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  buf = malloc(snap->ss_size);
+  if (buf == NULL) {
+    fprintf(stderr, "Cannot allocate %u bytes\n", snap->ss_size);
+    return EXIT_FAILURE;
+  }
+
+  len = copy_snapshot(snap, buf, snap->ss_size);
+  if (len == 0) {
+    fprintf(stderr, "No consistent snapshot in %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  print_snapshot((const struct olsr_snapshot_header *)buf, len);
+  free(buf);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,268 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#include "olsr_snapshot.h"
+#include "olsr.h"
+#include "defs.h"
+#include "scheduler.h"
+#include "link_set.h"
+#include "neighbor_table.h"
+#include "tc_set.h"
+#include "routing_table.h"
+#include "interfaces.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#if defined __GNUC__
+#define OLSR_SNAPSHOT_BARRIER() __sync_synchronize()
+#else
+#define OLSR_SNAPSHOT_BARRIER() do { } while (0)
+#endif
+
+#define SNAPSHOT_ALIGN(x) (((x) + 7) & ~7U)
+
+static struct olsr_snapshot_header *olsr_snapshot = NULL;
+
+/* write position while publishing */
+static uint32_t snapshot_fill;
+
+/**
+ * Create the snapshot file and map it.
+ *
+ * @param path the snapshot file
+ * @param size the size of the mapping in bytes
+ * @return 0 on success, -1 on failure
+ */
+int
+olsr_snapshot_open(const char *path, uint32_t size)
+{
+#ifdef WIN32
+  fprintf(stderr, "Cannot publish snapshots of %u bytes to %s, not supported on this platform\n", size, path);
+  return -1;
+#else
+  struct olsr_snapshot_header *snap;
+  int fd;
+
+  size = SNAPSHOT_ALIGN(size);
+  if (size < sizeof(struct olsr_snapshot_header)) {
+    size = SNAPSHOT_ALIGN(sizeof(struct olsr_snapshot_header));
+  }
+
+  /* the daemon runs as root, never follow a link planted at the path */
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open snapshot file %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  if (ftruncate(fd, size) < 0) {
+    fprintf(stderr, "Cannot size snapshot file %s: %s\n", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  snap = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (snap == MAP_FAILED) {
+    fprintf(stderr, "Cannot map snapshot file %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  snap->ss_version = OLSR_SNAPSHOT_VERSION;
+  snap->ss_size = size;
+  snap->ss_seq = 0;
+  snap->ss_tables[SNAPSHOT_LINKS].ss_record_size = sizeof(struct olsr_snapshot_link);
+  snap->ss_tables[SNAPSHOT_NEIGHBORS].ss_record_size = sizeof(struct olsr_snapshot_neighbor);
+  snap->ss_tables[SNAPSHOT_EDGES].ss_record_size = sizeof(struct olsr_snapshot_edge);
+  snap->ss_tables[SNAPSHOT_ROUTES].ss_record_size = sizeof(struct olsr_snapshot_route);
+
+  /* readers check the magic last */
+  OLSR_SNAPSHOT_BARRIER();
+  memcpy(snap->ss_magic, OLSR_SNAPSHOT_MAGIC, sizeof(snap->ss_magic));
+
+  olsr_snapshot = snap;
+  return 0;
+#endif
+}
+
+/**
+ * Stop publishing and unmap the snapshot.
+ * The file keeps the last snapshot.
+ */
+void
+olsr_snapshot_close(void)
+{
+#ifndef WIN32
+  if (olsr_snapshot) {
+    munmap(olsr_snapshot, olsr_snapshot->ss_size);
+    olsr_snapshot = NULL;
+  }
+#endif
+}
+
+/*
+ * Start a table at the current write position.
+ */
+static void
+snapshot_begin(enum olsr_snapshot_table table)
+{
+  struct olsr_snapshot_section *section = &olsr_snapshot->ss_tables[table];
+
+  snapshot_fill = SNAPSHOT_ALIGN(snapshot_fill);
+  section->ss_offset = snapshot_fill;
+  section->ss_count = 0;
+  section->ss_truncated = 0;
+}
+
+/*
+ * Reserve the next record of a table.
+ * Returns NULL and counts the record as truncated if the mapping is full.
+ */
+static void *
+snapshot_record(enum olsr_snapshot_table table)
+{
+  struct olsr_snapshot_section *section = &olsr_snapshot->ss_tables[table];
+  void *record;
+
+  if (olsr_snapshot->ss_size - snapshot_fill < section->ss_record_size) {
+    section->ss_truncated++;
+    return NULL;
+  }
+
+  record = (char *)olsr_snapshot + snapshot_fill;
+  snapshot_fill += section->ss_record_size;
+  section->ss_count++;
+  return record;
+}
+
+/**
+ * Copy links, neighbors, tc edges and routes into the snapshot.
+ * Called at the end of olsr_process_changes().
+ */
+void
+olsr_snapshot_publish(void)
+{
+  struct olsr_snapshot_header *snap = olsr_snapshot;
+  struct link_entry *link;
+  struct neighbor_entry *nbr;
+  struct tc_entry *tc;
+  struct tc_edge_entry *tc_edge;
+  struct rt_entry *rt;
+
+  if (snap == NULL) {
+    return;
+  }
+
+  /* odd sequence: readers retry */
+  snap->ss_seq++;
+  OLSR_SNAPSHOT_BARRIER();
+
+  snap->ss_time = now_times;
+  snap->ss_family = olsr_cnf->ip_version;
+  snapshot_fill = sizeof(struct olsr_snapshot_header);
+
+  snapshot_begin(SNAPSHOT_LINKS);
+  OLSR_FOR_ALL_LINK_ENTRIES(link) {
+    struct olsr_snapshot_link *sl = snapshot_record(SNAPSHOT_LINKS);
+    if (sl) {
+      sl->sl_local = link->local_iface_addr;
+      sl->sl_neighbor = link->neighbor_iface_addr;
+      sl->sl_cost = link->linkcost;
+      sl->sl_if_index = link->inter ? link->inter->if_index : -1;
+    }
+  } OLSR_FOR_ALL_LINK_ENTRIES_END(link);
+
+  snapshot_begin(SNAPSHOT_NEIGHBORS);
+  OLSR_FOR_ALL_NBR_ENTRIES(nbr) {
+    struct olsr_snapshot_neighbor *sn = snapshot_record(SNAPSHOT_NEIGHBORS);
+    if (sn) {
+      sn->sn_addr = nbr->neighbor_main_addr;
+      sn->sn_status = nbr->status;
+      sn->sn_willingness = nbr->willingness;
+      sn->sn_is_mpr = nbr->is_mpr;
+      sn->sn_reserved = 0;
+      sn->sn_linkcount = nbr->linkcount;
+    }
+  } OLSR_FOR_ALL_NBR_ENTRIES_END(nbr);
+
+  snapshot_begin(SNAPSHOT_EDGES);
+  OLSR_FOR_ALL_TC_ENTRIES(tc) {
+    OLSR_FOR_ALL_TC_EDGE_ENTRIES(tc, tc_edge) {
+      struct olsr_snapshot_edge *se = snapshot_record(SNAPSHOT_EDGES);
+      if (se) {
+        se->se_from = tc->addr;
+        se->se_to = tc_edge->T_dest_addr;
+        se->se_cost = tc_edge->cost;
+      }
+    } OLSR_FOR_ALL_TC_EDGE_ENTRIES_END(tc, tc_edge);
+  } OLSR_FOR_ALL_TC_ENTRIES_END(tc);
+
+  snapshot_begin(SNAPSHOT_ROUTES);
+  OLSR_FOR_ALL_RT_ENTRIES(rt) {
+    struct olsr_snapshot_route *sr = snapshot_record(SNAPSHOT_ROUTES);
+    if (sr) {
+      sr->sr_dst = rt->rt_dst.prefix;
+      sr->sr_gateway = rt->rt_nexthop.gateway;
+      sr->sr_cost = rt->rt_metric.cost;
+      sr->sr_hops = rt->rt_metric.hops;
+      sr->sr_if_index = rt->rt_nexthop.iif_index;
+      sr->sr_prefix_len = rt->rt_dst.prefix_len;
+      memset(sr->sr_reserved, 0, sizeof(sr->sr_reserved));
+    }
+  } OLSR_FOR_ALL_RT_ENTRIES_END(rt);
+
+  /* even sequence: snapshot is consistent */
+  OLSR_SNAPSHOT_BARRIER();
+  snap->ss_seq++;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
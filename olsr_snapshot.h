@@ -0,0 +1,140 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#ifndef _OLSR_SNAPSHOT_H
+#define _OLSR_SNAPSHOT_H
+
+#include "olsr_types.h"
+
+/*
+ * Read-only snapshot of the link state in a shared file mapping.
+ *
+ * After every olsr_process_changes() the links, neighbors, tc edges
+ * and routes are copied into flat, pointer free tables, so external
+ * tools can read them without asking the daemon to format anything.
+ *
+ * There is a single writer. ss_seq is odd while the tables are
+ * rewritten. A reader copies what it needs and retries if ss_seq was
+ * odd before or changed after the copy:
+ *
+ *   do {
+ *     seq = snap->ss_seq;
+ *     __sync_synchronize();
+ *     ... copy the tables ...
+ *     __sync_synchronize();
+ *   } while ((seq & 1) || seq != snap->ss_seq);
+ */
+
+#define OLSR_SNAPSHOT_MAGIC    "OLSRSNP1"
+#define OLSR_SNAPSHOT_VERSION  1
+#define OLSR_SNAPSHOT_SIZE     (4*1024*1024)   /* default mapping size */
+
+enum olsr_snapshot_table {
+  SNAPSHOT_LINKS,
+  SNAPSHOT_NEIGHBORS,
+  SNAPSHOT_EDGES,
+  SNAPSHOT_ROUTES,
+  SNAPSHOT_TABLE_MAX
+};
+
+struct olsr_snapshot_link {
+  union olsr_ip_addr sl_local;         /* local interface address */
+  union olsr_ip_addr sl_neighbor;      /* neighbor interface address */
+  uint32_t sl_cost;                    /* olsr_linkcost of the link */
+  int32_t sl_if_index;                 /* kernel index of the local interface */
+};
+
+struct olsr_snapshot_neighbor {
+  union olsr_ip_addr sn_addr;          /* main address */
+  uint8_t sn_status;                   /* SYM or NOT_SYM */
+  uint8_t sn_willingness;
+  uint8_t sn_is_mpr;
+  uint8_t sn_reserved;
+  uint32_t sn_linkcount;
+};
+
+struct olsr_snapshot_edge {
+  union olsr_ip_addr se_from;          /* originator of the tc */
+  union olsr_ip_addr se_to;            /* advertised neighbor */
+  uint32_t se_cost;                    /* olsr_linkcost of the edge */
+};
+
+struct olsr_snapshot_route {
+  union olsr_ip_addr sr_dst;           /* destination prefix */
+  union olsr_ip_addr sr_gateway;       /* nexthop in the kernel FIB */
+  uint32_t sr_cost;                    /* olsr_linkcost of the path */
+  uint32_t sr_hops;
+  int32_t sr_if_index;                 /* kernel index of the outgoing interface */
+  uint8_t sr_prefix_len;
+  uint8_t sr_reserved[3];
+};
+
+struct olsr_snapshot_section {
+  uint32_t ss_offset;                  /* from the start of the mapping */
+  uint32_t ss_count;                   /* records in the table */
+  uint32_t ss_record_size;             /* sizeof the record struct */
+  uint32_t ss_truncated;               /* records which did not fit */
+};
+
+struct olsr_snapshot_header {
+  char ss_magic[8];                    /* OLSR_SNAPSHOT_MAGIC */
+  uint32_t ss_version;                 /* OLSR_SNAPSHOT_VERSION */
+  uint32_t ss_size;                    /* size of the mapping */
+  volatile uint32_t ss_seq;            /* odd while being written */
+  uint32_t ss_time;                    /* now_times of the snapshot */
+  uint32_t ss_family;                  /* AF_INET or AF_INET6 */
+  uint32_t ss_reserved;
+  struct olsr_snapshot_section ss_tables[SNAPSHOT_TABLE_MAX];
+};
+
+int olsr_snapshot_open(const char *, uint32_t);
+void olsr_snapshot_close(void);
+void olsr_snapshot_publish(void);
+
+#endif /* _OLSR_SNAPSHOT_H */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -67,6 +67,7 @@
 #include "net_olsr.h"
 #include "lq_plugin.h"
 #include "gateway.h"
+#include "olsr_metrics.h"
 
 struct timer_entry *spf_backoff_timer = NULL;
 
@@ -308,6 +309,7 @@ olsr_calculate_routing_table(bool force)
 #ifdef SPF_PROFILING
   struct timeval t1, t2, t3, t4, t5, spf_init, spf_run, route, kernel, total;
 #endif
+  struct timeval spf_start, spf_end, spf_duration;
   struct avl_tree cand_tree;
   struct avl_node *rtp_tree_node;
   struct list_node path_list;          /* head of the path_list */
@@ -328,6 +330,9 @@ olsr_calculate_routing_table(bool force)
     spf_backoff_timer = olsr_start_timer(1000, 5, OLSR_TIMER_ONESHOT, &olsr_expire_spf_backoff, NULL, 0);
   }
 
+  OLSR_METRIC_INC(METRIC_SPF_RUNS);
+  gettimeofday(&spf_start, NULL);
+
 #ifdef SPF_PROFILING
   gettimeofday(&t1, NULL);
 #endif
@@ -489,6 +494,7 @@ olsr_calculate_routing_table(bool force)
   }
 #if defined linux
   /* check gateway tunnels */
+  olsr_update_gateway_costs();
   olsr_trigger_gatewayloss_check();
 #endif
 
@@ -504,6 +510,10 @@ olsr_calculate_routing_table(bool force)
 
   olsr_update_kernel_routes();
 
+  gettimeofday(&spf_end, NULL);
+  timersub(&spf_end, &spf_start, &spf_duration);
+  olsr_metric_observe(HISTOGRAM_SPF_USEC, spf_duration.tv_sec * 1000000 + spf_duration.tv_usec);
+
 #ifdef SPF_PROFILING
   gettimeofday(&t5, NULL);
 #endif
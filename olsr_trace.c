@@ -0,0 +1,188 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#include "olsr_trace.h"
+#include "olsr.h"
+#include "defs.h"
+#include "scheduler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#if defined __GNUC__
+#define OLSR_TRACE_BARRIER() __sync_synchronize()
+#else
+#define OLSR_TRACE_BARRIER() do { } while (0)
+#endif
+
+struct olsr_trace_ring *olsr_trace_ring = NULL;
+
+static size_t olsr_trace_map_size;
+
+/**
+ * Create the trace file and map the ring buffer.
+ *
+ * @param path the trace file
+ * @param records the number of ring entries, rounded up to a power of 2
+ * @return 0 on success, -1 on failure
+ */
+int
+olsr_trace_open(const char *path, uint32_t records)
+{
+#ifdef WIN32
+  fprintf(stderr, "Cannot trace %u records to %s, not supported on this platform\n", records, path);
+  return -1;
+#else
+  struct olsr_trace_ring *ring;
+  uint32_t size;
+  int fd;
+
+  for (size = 1; size < records && size < 0x80000000; size <<= 1);
+
+  olsr_trace_map_size = sizeof(struct olsr_trace_ring) + size * sizeof(struct olsr_trace_entry);
+
+  /* the daemon runs as root, never follow a link planted at the path */
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open trace file %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  if (ftruncate(fd, olsr_trace_map_size) < 0) {
+    fprintf(stderr, "Cannot size trace file %s: %s\n", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  ring = mmap(NULL, olsr_trace_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ring == MAP_FAILED) {
+    fprintf(stderr, "Cannot map trace file %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  ring->tr_version = OLSR_TRACE_VERSION;
+  ring->tr_entry_size = sizeof(struct olsr_trace_entry);
+  ring->tr_size = size;
+  ring->tr_head = 0;
+
+  /* readers check the magic last */
+  OLSR_TRACE_BARRIER();
+  memcpy(ring->tr_magic, OLSR_TRACE_MAGIC, sizeof(ring->tr_magic));
+
+  olsr_trace_ring = ring;
+  return 0;
+#endif
+}
+
+/**
+ * Stop tracing and unmap the ring buffer.
+ * The trace file stays for offline decoding.
+ */
+void
+olsr_trace_close(void)
+{
+#ifndef WIN32
+  if (olsr_trace_ring) {
+    msync(olsr_trace_ring, olsr_trace_map_size, MS_ASYNC);
+    munmap(olsr_trace_ring, olsr_trace_map_size);
+    olsr_trace_ring = NULL;
+  }
+#endif
+}
+
+/**
+ * Append an event to the ring buffer.
+ * Use the OLSR_TRACE macro instead of calling this directly.
+ *
+ * @param level the debug level of the event
+ * @param event the event id
+ * @param addr1 first address argument or NULL
+ * @param addr2 second address argument or NULL
+ * @param arg1 first numeric argument
+ * @param arg2 second numeric argument
+ */
+void
+olsr_trace_record(uint8_t level, uint16_t event, const union olsr_ip_addr *addr1, const union olsr_ip_addr *addr2,
+                  uint32_t arg1, uint32_t arg2)
+{
+  struct olsr_trace_ring *ring = olsr_trace_ring;
+  uint32_t head = ring->tr_head;
+  struct olsr_trace_entry *entry = &ring->tr_entries[head & (ring->tr_size - 1)];
+
+  /* invalidate the entry for readers */
+  entry->te_seq = 0;
+  OLSR_TRACE_BARRIER();
+
+  entry->te_time = now_times;
+  entry->te_event = event;
+  entry->te_level = level;
+  entry->te_family = olsr_cnf->ip_version == AF_INET ? AF_INET : AF_INET6;
+  entry->te_arg[0] = arg1;
+  entry->te_arg[1] = arg2;
+  if (addr1) {
+    entry->te_addr[0] = *addr1;
+  } else {
+    memset(&entry->te_addr[0], 0, sizeof(entry->te_addr[0]));
+  }
+  if (addr2) {
+    entry->te_addr[1] = *addr2;
+  } else {
+    memset(&entry->te_addr[1], 0, sizeof(entry->te_addr[1]));
+  }
+
+  /* publish */
+  OLSR_TRACE_BARRIER();
+  entry->te_seq = head + 1;
+  ring->tr_head = head + 1;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
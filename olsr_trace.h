@@ -0,0 +1,133 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#ifndef _OLSR_TRACE_H
+#define _OLSR_TRACE_H
+
+#include "olsr_types.h"
+
+/*
+ * Binary tracing of hot path events.
+ *
+ * Instead of formatting a debug line with OLSR_PRINTF, a fixed size
+ * record with the raw event arguments is appended to a ring buffer
+ * in a shared file mapping. olsr_tracedump formats the records offline,
+ * also while the daemon is running.
+ *
+ * There is a single writer. A record is invalidated, written and then
+ * published by storing its sequence number, so a reader can detect
+ * records overwritten while it copied them.
+ */
+
+#define OLSR_TRACE_MAGIC     "OLSRTRC1"
+#define OLSR_TRACE_VERSION   1
+#define OLSR_TRACE_RECORDS   65536      /* default ring size, must be a power of 2 */
+
+enum olsr_trace_event {
+  TRACE_NONE,
+  TRACE_TC_INPUT,                      /* originator, sender, seqno, ansn */
+  TRACE_TC_NONSYM,                     /* sender */
+  TRACE_TC_IGNORED,                    /* originator */
+  TRACE_TC_RESTART,                    /* originator */
+  TRACE_TC_EXPIRE,                     /* originator */
+  TRACE_TC_EDGE_EXPIRE,                /* originator */
+  TRACE_TC_EVICT,                      /* originator */
+  TRACE_MID_NONSYM,                    /* sender */
+  TRACE_MID_NEW,                       /* main address, alias */
+  TRACE_MID_UPDATE,                    /* main address */
+  TRACE_HNA_NONSYM,                    /* sender */
+  TRACE_WILLINGNESS,                   /* neighbor, old, new */
+  TRACE_EVENT_MAX
+};
+
+struct olsr_trace_entry {
+  uint32_t te_seq;                     /* ring index + 1, 0 while being written */
+  uint32_t te_time;                    /* now_times of the event */
+  uint16_t te_event;                   /* enum olsr_trace_event */
+  uint8_t te_level;                    /* debug level of the event */
+  uint8_t te_family;                   /* AF_INET or AF_INET6 */
+  uint32_t te_arg[2];                  /* raw arguments */
+  union olsr_ip_addr te_addr[2];       /* raw addresses */
+};
+
+struct olsr_trace_ring {
+  char tr_magic[8];                    /* OLSR_TRACE_MAGIC */
+  uint32_t tr_version;                 /* OLSR_TRACE_VERSION */
+  uint32_t tr_entry_size;              /* sizeof(struct olsr_trace_entry) */
+  uint32_t tr_size;                    /* number of entries, a power of 2 */
+  volatile uint32_t tr_head;           /* entries ever written */
+  struct olsr_trace_entry tr_entries[0];
+};
+
+extern struct olsr_trace_ring *olsr_trace_ring;
+
+/*
+ * Record an event if tracing is active and the debug level allows it.
+ * Evaluates to true if tracing is active, so the caller can skip
+ * the equivalent OLSR_PRINTF.
+ */
+#define OLSR_TRACE(lvl, event, addr1, addr2, arg1, arg2)                \
+  (olsr_trace_ring != NULL ?                                            \
+   ((olsr_cnf->debug_level >= (lvl) ?                                   \
+     olsr_trace_record((lvl), (event), (addr1), (addr2), (arg1), (arg2)) : (void)0), true) : false)
+
+/*
+ * Trace an event, or print it if tracing is not active.
+ */
+#define OLSR_TRACE_PRINTF(lvl, event, addr1, addr2, arg1, arg2, format, args...) do { \
+    if (!OLSR_TRACE((lvl), (event), (addr1), (addr2), (arg1), (arg2))) {  \
+      OLSR_PRINTF((lvl), (format), ##args);                             \
+    }                                                                   \
+  } while (0)
+
+int olsr_trace_open(const char *, uint32_t);
+void olsr_trace_close(void);
+void olsr_trace_record(uint8_t, uint16_t, const union olsr_ip_addr *, const union olsr_ip_addr *, uint32_t, uint32_t);
+
+#endif /* _OLSR_TRACE_H */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,215 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon(olsrd)
+ * Copyright (c) 2004, Andreas Tonnesen(andreto@olsr.org)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+/*
+ * olsr_tracedump - format the binary trace written by olsrd -trace
+ *
+ * Usage: olsr_tracedump [-f] <trace file>
+ *   -f  keep following the trace while olsrd is running
+ */
+
+#include "olsr_trace.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct trace_format {
+  const char *name;
+  const char *format;                  /* %A/%B: addresses, %1/%2: arguments */
+};
+
+static const struct trace_format trace_formats[TRACE_EVENT_MAX] = {
+  [TRACE_NONE] = {"none", ""},
+  [TRACE_TC_INPUT] = {"tc_input", "Processing TC from %A via %B, seq 0x%x1, ansn %2"},
+  [TRACE_TC_NONSYM] = {"tc_nonsym", "Received TC from NON SYM neighbor %A"},
+  [TRACE_TC_IGNORED] = {"tc_ignored", "Ignored to much LQTC's for %A, restarting"},
+  [TRACE_TC_RESTART] = {"tc_restart", "Detected node restart for %A"},
+  [TRACE_TC_EXPIRE] = {"tc_expire", "TC: expire node entry %A"},
+  [TRACE_TC_EDGE_EXPIRE] = {"tc_edge_expire", "TC: expire edge entry %A"},
+  [TRACE_TC_EVICT] = {"tc_evict", "TC: memory pressure, evicting %A"},
+  [TRACE_MID_NONSYM] = {"mid_nonsym", "Received MID from NON SYM neighbor %A"},
+  [TRACE_MID_NEW] = {"mid_new", "MID new: (%A, %B)"},
+  [TRACE_MID_UPDATE] = {"mid_update", "MID: update %A"},
+  [TRACE_HNA_NONSYM] = {"hna_nonsym", "Received HNA from NON SYM neighbor %A"},
+  [TRACE_WILLINGNESS] = {"willingness", "Willingness for %A changed from %1 to %2 - UPDATING"},
+};
+
+static void
+print_entry(const struct olsr_trace_entry *entry)
+{
+  const char *format;
+  char buf[INET6_ADDRSTRLEN];
+
+  printf("%u.%03u [%u] ", entry->te_time / 1000, entry->te_time % 1000, entry->te_level);
+
+  if (entry->te_event >= TRACE_EVENT_MAX || !trace_formats[entry->te_event].name) {
+    printf("unknown event %u: %u %u\n", entry->te_event, entry->te_arg[0], entry->te_arg[1]);
+    return;
+  }
+
+  for (format = trace_formats[entry->te_event].format; *format; format++) {
+    if (*format != '%') {
+      putchar(*format);
+      continue;
+    }
+    switch (*++format) {
+    case 'A':
+    case 'B':
+      inet_ntop(entry->te_family, &entry->te_addr[*format - 'A'], buf, sizeof(buf));
+      fputs(buf, stdout);
+      break;
+    case 'x':
+      printf("%04x", entry->te_arg[*++format - '1']);
+      break;
+    case '1':
+    case '2':
+      printf("%u", entry->te_arg[*format - '1']);
+      break;
+    default:
+      putchar(*format);
+      break;
+    }
+  }
+  putchar('\n');
+}
+
+/*
+ * Print the entries [from, to) which have not been overwritten yet.
+ * Returns the index to continue with.
+ */
+static uint32_t
+dump_entries(const struct olsr_trace_ring *ring, uint32_t from, uint32_t to)
+{
+  uint32_t lost = 0;
+
+  if (to - from > ring->tr_size) {
+    lost = to - from - ring->tr_size;
+    from = to - ring->tr_size;
+  }
+
+  for (; from != to; from++) {
+    const struct olsr_trace_entry *slot = &ring->tr_entries[from & (ring->tr_size - 1)];
+    struct olsr_trace_entry entry;
+
+    /* copy and check the entry was not rewritten meanwhile */
+    entry = *slot;
+    __sync_synchronize();
+    if (entry.te_seq != from + 1 || slot->te_seq != from + 1) {
+      lost++;
+      continue;
+    }
+    print_entry(&entry);
+  }
+
+  if (lost) {
+    printf("... %u entries overwritten\n", lost);
+  }
+  return to;
+}
+
+int
+main(int argc, char *argv[])
+{
+  const struct olsr_trace_ring *ring;
+  struct stat st;
+  bool follow = false;
+  uint32_t next;
+  int fd;
+
+  if (argc == 3 && strcmp(argv[1], "-f") == 0) {
+    follow = true;
+    argv++;
+    argc--;
+  }
+  if (argc != 2) {
+    fprintf(stderr, "Usage: olsr_tracedump [-f] <trace file>\n");
+    return EXIT_FAILURE;
+  }
+
+  fd = open(argv[1], O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "Cannot open %s: %s\n", argv[1], strerror(errno));
+    return EXIT_FAILURE;
+  }
+  if ((size_t)st.st_size < sizeof(*ring)) {
+    fprintf(stderr, "%s is not a trace file\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  ring = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ring == MAP_FAILED) {
+    fprintf(stderr, "Cannot map %s: %s\n", argv[1], strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  if (memcmp(ring->tr_magic, OLSR_TRACE_MAGIC, sizeof(ring->tr_magic)) != 0
+      || ring->tr_version != OLSR_TRACE_VERSION || ring->tr_entry_size != sizeof(struct olsr_trace_entry)
+      || ring->tr_size == 0 || (ring->tr_size & (ring->tr_size - 1)) != 0
+      || (size_t)st.st_size < sizeof(*ring) + ring->tr_size * sizeof(struct olsr_trace_entry)) {
+    fprintf(stderr, "%s is not a trace file of this version\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  next = dump_entries(ring, 0, ring->tr_head);
+  while (follow) {
+    fflush(stdout);
+    usleep(100000);
+    next = dump_entries(ring, next, ring->tr_head);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
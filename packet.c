@@ -49,6 +49,7 @@
 #include "build_msg.h"
 #include "net_olsr.h"
 #include "lq_plugin.h"
+#include "mid_set.h"
 
 static bool sending_tc = false;
 
@@ -71,7 +72,7 @@ olsr_free_hello_packet(struct hello_message *message)
   while (nb) {
     struct hello_neighbor *prev_nb = nb;
     nb = nb->next;
-    free(prev_nb);
+    olsr_free_hello_neighbor(prev_nb);
   }
 }
 
@@ -302,7 +303,7 @@ olsr_free_tc_packet(struct tc_message *message)
   while (mprs != NULL) {
     struct tc_mpr_addr *prev_mprs = mprs;
     mprs = mprs->next;
-    free(prev_mprs);
+    olsr_free_tc_mpr_addr(prev_mprs);
   }
 }
 
@@ -414,7 +415,7 @@ olsr_free_mid_packet(struct mid_message *message)
   while (tmp_adr) {
     tmp_adr2 = tmp_adr;
     tmp_adr = tmp_adr->next;
-    free(tmp_adr2);
+    olsr_cookie_free(mid_alias_mem_cookie, tmp_adr2);
   }
 }
 
@@ -54,6 +54,8 @@
 #include "print_packet.h"
 #include "net_olsr.h"
 #include "duplicate_handler.h"
+#include "olsr_metrics.h"
+#include "olsr_cpustats.h"
 
 #ifdef WIN32
 #undef EWOULDBLOCK
@@ -281,12 +283,21 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
 
   count = size - ((char *)m - (char *)olsr);
 
+  if (in_if) {
+    in_if->counters.rx_packets++;
+    in_if->counters.rx_bytes += size;
+  }
+  olsr_metric_observe(HISTOGRAM_RX_PACKET_SIZE, size);
+
   /* minimum packet size is 4 */
-  if (count < 4)
+  if (count < 4) {
+    OLSR_METRIC_INC(METRIC_PARSE_ERRORS);
     return;
+  }
 
   if (ntohs(olsr->olsr_packlen) !=(uint16_t) size) {
     struct ipaddr_str buf;
+    OLSR_METRIC_INC(METRIC_PARSE_ERRORS);
     OLSR_PRINTF(1, "Size error detected in received packet.\nRecieved %d, in packet %d\n", size, ntohs(olsr->olsr_packlen));
 
     olsr_syslog(OLSR_LOG_ERR, " packet length error in  packet received from %s!", olsr_ip_to_string(&buf, from_addr));
@@ -298,7 +309,9 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
   // call packetparser
   packetparser = packetparser_functions;
   while (packetparser) {
+    uint64_t start = OLSR_CPU_START();
     packetparser->function(olsr, in_if, from_addr);
+    OLSR_CPU_STOP(start, CPU_KIND_PACKETPARSER, packetparser->function, packetparser->function, NULL);
     packetparser = packetparser->next;
   }
 
@@ -326,8 +339,10 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
     bool validated;
 
     /* minimum message size is 8 + ipsize */
-    if (count < 8 + olsr_cnf->ipsize)
+    if (count < 8 + olsr_cnf->ipsize) {
+      OLSR_METRIC_INC(METRIC_PARSE_ERRORS);
       break;
+    }
 
     if (olsr_cnf->ip_version == AF_INET) {
       msgsize = ntohs(m->v4.olsr_msgsize);
@@ -342,6 +357,7 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
     if (msgsize < 8 + olsr_cnf->ipsize) {
       struct ipaddr_str buf;
       union olsr_ip_addr *msgorig = (union olsr_ip_addr *) &m->v4.originator;
+      OLSR_METRIC_INC(METRIC_PARSE_ERRORS);
       OLSR_PRINTF(1, "Error, OLSR message from %s (type %d) is to small (%d bytes)"
           ", ignoring all further content of the packet\n",
           olsr_ip_to_string(&buf, msgorig), m->v4.olsr_msgtype, msgsize);
@@ -354,6 +370,7 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
     if ((msgsize % 4) != 0) {
       struct ipaddr_str buf;
       union olsr_ip_addr *msgorig = (union olsr_ip_addr *) &m->v4.originator;
+      OLSR_METRIC_INC(METRIC_PARSE_ERRORS);
       OLSR_PRINTF(1, "Error, OLSR message from %s (type %d) must be"
           " longword aligned, but has a length of %d bytes\n",
           olsr_ip_to_string(&buf, msgorig), m->v4.olsr_msgtype, msgsize);
@@ -366,6 +383,7 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
     if (msgsize > count) {
       struct ipaddr_str buf;
       union olsr_ip_addr *msgorig = (union olsr_ip_addr *) &m->v4.originator;
+      OLSR_METRIC_INC(METRIC_PARSE_ERRORS);
       OLSR_PRINTF(1, "Error, OLSR message from %s (type %d) says"
           " length=%d, but only %d bytes left\n",
           olsr_ip_to_string(&buf, msgorig), m->v4.olsr_msgtype, msgsize, count);
@@ -376,6 +394,7 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
     }
 
     count -= msgsize;
+    OLSR_METRIC_MESSAGE(m->v4.olsr_msgtype);
 
     /*RFC 3626 section 3.4:
      *  2    If the time to live of the message is less than or equal to
@@ -407,8 +426,10 @@ parse_packet(struct olsr *olsr, int size, struct interface *in_if, union olsr_ip
 
       /* Promiscuous or exact match */
       if ((entry->type == PROMISCUOUS) || (entry->type == m->v4.olsr_msgtype)) {
+        uint64_t start = OLSR_CPU_START();
         if (!entry->function(m, in_if, from_addr))
           forward = false;
+        OLSR_CPU_STOP(start, CPU_KIND_PARSER, entry->function, entry->function, NULL);
       }
       entry = entry->next;
     }
@@ -433,7 +454,7 @@ olsr_input(int fd, void *data __attribute__ ((unused)), unsigned int flags __att
   struct interface *olsr_in_if;
   union olsr_ip_addr from_addr;
   struct preprocessor_function_entry *entry;
-  char *packet;
+  char *packet, *rxbuf;
 
   cpu_overload_exit = 0;
 
@@ -449,8 +470,14 @@ olsr_input(int fd, void *data __attribute__ ((unused)), unsigned int flags __att
       break;
     }
 
+    /* with scatter-gather output forwarded messages keep a reference on the receive buffer */
+    rxbuf = net_get_rxbuffer();
+    if (rxbuf == NULL) {
+      rxbuf = inbuf;
+    }
+
     fromlen = sizeof(struct sockaddr_storage);
-    cc = olsr_recvfrom(fd, inbuf, sizeof(inbuf_aligned), 0, (struct sockaddr *)&from, &fromlen);
+    cc = olsr_recvfrom(fd, rxbuf, sizeof(inbuf_aligned), 0, (struct sockaddr *)&from, &fromlen);
 
     if (cc <= 0) {
       if (cc < 0 && errno != EWOULDBLOCK) {
@@ -491,10 +518,12 @@ olsr_input(int fd, void *data __attribute__ ((unused)), unsigned int flags __att
     }
     // call preprocessors
     entry = preprocessor_functions;
-    packet = &inbuf[0];
+    packet = &rxbuf[0];
 
     while (entry) {
+      uint64_t start = OLSR_CPU_START();
       packet = entry->function(packet, olsr_in_if, &from_addr, &cc);
+      OLSR_CPU_STOP(start, CPU_KIND_PREPROCESSOR, entry->function, entry->function, NULL);
       // discard package ?
       if (packet == NULL) {
         return;
@@ -55,6 +55,8 @@
 #include "net_olsr.h"
 #include "lq_plugin.h"
 #include "log.h"
+#include "mpr.h"
+#include "olsr_trace.h"
 
 #include <stddef.h>
 
@@ -127,6 +129,7 @@ process_message_neighbors(struct neighbor_entry *neighbor, const struct hello_me
 
             if (walker->neighbor == neighbor) {
               walker->path_linkcost = LINK_COST_BROKEN;
+              olsr_mpr_changed_2hop(two_hop_neighbor);
             }
           }
         }
@@ -136,7 +139,7 @@ process_message_neighbors(struct neighbor_entry *neighbor, const struct hello_me
           changes_neighborhood = true;
           changes_topology = true;
 
-          two_hop_neighbor = olsr_malloc(sizeof(struct neighbor_2_entry), "Process HELLO");
+          two_hop_neighbor = olsr_cookie_malloc(nbr2_mem_cookie);
 
           two_hop_neighbor->neighbor_2_nblist.next = &two_hop_neighbor->neighbor_2_nblist;
 
@@ -231,6 +234,7 @@ process_message_neighbors(struct neighbor_entry *neighbor, const struct hello_me
 
               walker->saved_path_linkcost = new_path_linkcost;
 
+              olsr_mpr_changed_2hop(two_hop_neighbor);
               changes_neighborhood = true;
               changes_topology = true;
             }
@@ -251,8 +255,8 @@ process_message_neighbors(struct neighbor_entry *neighbor, const struct hello_me
 static void
 linking_this_2_entries(struct neighbor_entry *neighbor, struct neighbor_2_entry *two_hop_neighbor, olsr_reltime vtime)
 {
-  struct neighbor_list_entry *list_of_1_neighbors = olsr_malloc(sizeof(struct neighbor_list_entry), "Link entries 1");
-  struct neighbor_2_list_entry *list_of_2_neighbors = olsr_malloc(sizeof(struct neighbor_2_list_entry), "Link entries 2");
+  struct neighbor_list_entry *list_of_1_neighbors = olsr_cookie_malloc(nbr_list_mem_cookie);
+  struct neighbor_2_list_entry *list_of_2_neighbors = olsr_cookie_malloc(nbr2_list_mem_cookie);
 
   list_of_1_neighbors->neighbor = neighbor;
 
@@ -279,6 +283,8 @@ linking_this_2_entries(struct neighbor_entry *neighbor, struct neighbor_2_entry
 
   /*increment the pointer counter */
   two_hop_neighbor->neighbor_2_pointer++;
+
+  olsr_mpr_changed_2hop(two_hop_neighbor);
 }
 
 /**
@@ -479,12 +485,14 @@ olsr_hello_tap(struct hello_message *message, struct interface *in_if, const uni
   /* Check willingness */
   if (neighbor->willingness != message->willingness) {
     struct ipaddr_str buf;
-    OLSR_PRINTF(1, "Willingness for %s changed from %d to %d - UPDATING\n", olsr_ip_to_string(&buf, &neighbor->neighbor_main_addr),
-                neighbor->willingness, message->willingness);
+    OLSR_TRACE_PRINTF(1, TRACE_WILLINGNESS, &neighbor->neighbor_main_addr, NULL, neighbor->willingness, message->willingness,
+                      "Willingness for %s changed from %d to %d - UPDATING\n",
+                      olsr_ip_to_string(&buf, &neighbor->neighbor_main_addr), neighbor->willingness, message->willingness);
     /*
      *If willingness changed - recalculate
      */
     neighbor->willingness = message->willingness;
+    olsr_mpr_request_full();
     changes_neighborhood = true;
     changes_topology = true;
   }
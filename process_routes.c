@@ -53,6 +53,8 @@
 #include "tc_set.h"
 #include "olsr_cookie.h"
 #include "olsr_niit.h"
+#include "ipc_frontend.h"
+#include "olsr_metrics.h"
 
 #ifdef WIN32
 char *StrError(unsigned int ErrNo);
@@ -155,16 +157,18 @@ olsr_enqueue_rt(struct list_node *head_node, struct rt_entry *rt)
 /**
  * Process a route from the kernel deletion list.
  *
- *@return nada
+ *@return true if the route was deleted from the kernel
  */
-static void
+static bool
 olsr_delete_kernel_route(struct rt_entry *rt)
 {
+  bool deleted = false;
+
   if (rt->rt_metric.hops > 1) {
     /* multihop route */
     if (ip_is_linklocal(&rt->rt_dst.prefix)) {
       /* do not delete a route with a LL IP as a destination */
-      return;
+      return false;
     }
   }
 
@@ -174,9 +178,13 @@ olsr_delete_kernel_route(struct rt_entry *rt)
     if (error < 0) {
       const char *const err_msg = strerror(errno);
       const char *const routestr = olsr_rt_to_string(rt);
+      OLSR_METRIC_INC(METRIC_ROUTE_ERRORS);
       OLSR_PRINTF(1, "KERN: ERROR deleting %s: %s\n", routestr, err_msg);
 
       olsr_syslog(OLSR_LOG_ERR, "Delete route %s: %s", routestr, err_msg);
+    } else {
+      OLSR_METRIC_INC(METRIC_ROUTE_DELETES);
+      deleted = true;
     }
 #ifdef LINUX_NETLINK_ROUTING
     /* call NIIT handler (always)*/
@@ -185,15 +193,18 @@ olsr_delete_kernel_route(struct rt_entry *rt)
     }
 #endif
   }
+  return deleted;
 }
 
 /**
  * Process a route from the kernel addition list.
  *
+ *@param rt the route
+ *@param replace true if the route replaces one still in the kernel
  *@return nada
  */
 static void
-olsr_add_kernel_route(struct rt_entry *rt)
+olsr_add_kernel_route(struct rt_entry *rt, bool replace)
 {
   if (rt->rt_best->rtp_metric.hops > 1) {
     /* multihop route */
@@ -208,11 +219,13 @@ olsr_add_kernel_route(struct rt_entry *rt)
     if (error < 0) {
       const char *const err_msg = strerror(errno);
       const char *const routestr = olsr_rtp_to_string(rt->rt_best);
+      OLSR_METRIC_INC(METRIC_ROUTE_ERRORS);
       OLSR_PRINTF(1, "KERN: ERROR adding %s: %s\n", routestr, err_msg);
 
       olsr_syslog(OLSR_LOG_ERR, "Add route %s: %s", routestr, err_msg);
     } else {
       /* route addition has suceeded */
+      OLSR_METRIC_INC(replace ? METRIC_ROUTE_CHANGES : METRIC_ROUTE_ADDS);
 
       /* save the nexthop and metric in the route entry */
       rt->rt_nexthop = rt->rt_best->rtp_nexthop;
@@ -249,7 +262,10 @@ olsr_chg_kernel_routes(struct list_node *head_node)
    * such that nexthop routes are added first.
    */
   while (!list_is_empty(head_node)) {
+    bool replace;
+
     rt = changelist2rt(head_node->next);
+    replace = rt->rt_nexthop.iif_index > -1;
 
 /*deleting routes should not be required anymore as we use (NLM_F_CREATE | NLM_F_REPLACE) in linux rtnetlink*/
 #ifdef LINUX_NETLINK_ROUTING
@@ -258,14 +274,16 @@ olsr_chg_kernel_routes(struct list_node *head_node)
          || (olsr_addroute_function != olsr_ioctl_add_route) || (olsr_addroute6_function != olsr_ioctl_add_route6)
          || (olsr_delroute_function != olsr_ioctl_del_route) || (olsr_delroute6_function != olsr_ioctl_del_route6))
         && (rt->rt_nexthop.iif_index > -1)) {
-      olsr_delete_kernel_route(rt);
+      replace = !olsr_delete_kernel_route(rt);
     }
 #else
     /*no rtnetlink we have to delete routes*/
-    if (rt->rt_nexthop.iif_index > -1) olsr_delete_kernel_route(rt);
+    if (rt->rt_nexthop.iif_index > -1) replace = !olsr_delete_kernel_route(rt);
 #endif /*LINUX_NETLINK_ROUTING*/
 
-    olsr_add_kernel_route(rt);
+    /* a route deleted above is counted as a delete and an add */
+    olsr_add_kernel_route(rt, replace);
+    ipc_queue_route(rt, true);
 
     list_remove(&rt->rt_change_node);
   }
@@ -289,6 +307,7 @@ olsr_del_kernel_routes(struct list_node *head_node)
     if (rt->rt_nexthop.iif_index >= 0)
 #endif /*LINUX_NETLINK_ROUTING*/
       olsr_delete_kernel_route(rt);
+    ipc_queue_route(rt, false);
 
     list_remove(&rt->rt_change_node);
     olsr_cookie_free(rt_mem_cookie, rt);
@@ -92,7 +92,7 @@ mid_chgestruct(struct mid_message *mmsg, const union olsr_message *m)
     /*printf("Sequencenuber of MID from %s is %d\n", ip_to_string(&mmsg->addr), mmsg->mid_seqno); */
 
     for (i = 0; i < no_aliases; i++) {
-      alias = olsr_malloc(sizeof(struct mid_alias), "MID chgestruct");
+      alias = olsr_cookie_malloc(mid_alias_mem_cookie);
 
       alias->alias_addr.v4.s_addr = maddr->addr;
       alias->next = mmsg->mid_addr;
@@ -134,7 +134,7 @@ mid_chgestruct(struct mid_message *mmsg, const union olsr_message *m)
     /*printf("Sequencenuber of MID from %s is %d\n", ip_to_string(&mmsg->addr), mmsg->mid_seqno); */
 
     for (i = 0; i < no_aliases; i++) {
-      alias = olsr_malloc(sizeof(struct mid_alias), "MID chgestruct 2");
+      alias = olsr_cookie_malloc(mid_alias_mem_cookie);
 
       /*printf("Adding alias: %s\n", olsr_ip_to_string(&buf, (union olsr_ip_addr *)&maddr6->addr)); */
       alias->alias_addr.v6 = maddr6->addr;
@@ -588,6 +588,9 @@ olsr_insert_routing_table(union olsr_ip_addr *dst, int plen, union olsr_ip_addr
   tc = olsr_locate_tc_entry(originator);//先调用olsr _ locate_ tc_ entry函数根据源地址判断该 tc _entry是否可
 连接，因为tc _entry作为所有路由的连接点，如果它是不可连接的，则在最短路
 径优先计算时它不会被考虑。
+  if (!tc) {
+    return NULL;
+  }
 
 
   /*
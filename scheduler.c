@@ -46,6 +46,9 @@
 #include "olsr_cookie.h"
 #include "net_os.h"
 #include "mpr_selector_set.h"
+#include "net_olsr.h"
+#include "olsr_metrics.h"
+#include "olsr_cpustats.h"
 
 #include <sys/times.h>
 
@@ -68,6 +71,10 @@ static uint32_t timer_last_run;        /* remember the last timeslot walk */
 /* Memory cookie for the block based memory manager */
 static struct olsr_cookie_info *timer_mem_cookie = NULL;
 
+/* timer whose callback is running, freed by walk_timers() if the callback stops it */
+static struct timer_entry *timer_in_callback = NULL;
+static bool timer_in_callback_stopped;
+
 /* Head of all OLSR used sockets */
 static struct list_node socket_head = { &socket_head, &socket_head };
 
@@ -333,7 +340,11 @@ poll_sockets(void)
       flags |= SP_PR_WRITE;
     }
     if (flags != 0) {
-      entry->process_pollrate(entry->fd, entry->data, flags);
+      /* the handler may remove its own entry */
+      socket_handler_func handler = entry->process_pollrate;
+      uint64_t start = OLSR_CPU_START();
+      handler(entry->fd, entry->data, flags);
+      OLSR_CPU_STOP(start, CPU_KIND_SOCKET, handler, handler, NULL);
     }
   }
   OLSR_FOR_ALL_SOCKETS_END(entry);
@@ -422,7 +433,10 @@ handle_fds(uint32_t next_interval)
         flags |= SP_IMM_WRITE;
       }
       if (flags != 0) {
-        entry->process_immediate(entry->fd, entry->data, flags);
+        socket_handler_func handler = entry->process_immediate;
+        uint64_t start = OLSR_CPU_START();
+        handler(entry->fd, entry->data, flags);
+        OLSR_CPU_STOP(start, CPU_KIND_SOCKET, handler, handler, NULL);
       }
     }
     OLSR_FOR_ALL_SOCKETS_END(entry);
@@ -488,6 +502,9 @@ olsr_scheduler(void)
       link_changes = false;
     }
 
+    /* Send the packets queued by this iteration */
+    net_output_flush();
+
     /* Read incoming data and handle it immediiately */
     handle_fds(next_interval);
   }
@@ -599,6 +616,7 @@ walk_timers(uint32_t * last_run)
 
       /* Ready to fire ? */
       if (TIMED_OUT(timer->timer_clock)) {
+        uint64_t start;
 
         OLSR_PRINTF(7, "TIMER: fire %s timer %p, ctx %p, "
                    "at clocktick %u (%s)\n",
@@ -606,10 +624,21 @@ walk_timers(uint32_t * last_run)
                    timer, timer->timer_cb_context, (unsigned int)*last_run, olsr_wallclock_string());
 
         /* This timer is expired, call into the provided callback function */
+        start = OLSR_CPU_START();
+        timer_in_callback = timer;
+        timer_in_callback_stopped = false;
         timer->timer_cb(timer->timer_cb_context);
+        timer_in_callback = NULL;
 
+        /* the timer itself is not freed before this point */
+        OLSR_CPU_STOP(start, CPU_KIND_TIMER, timer->timer_cookie, timer->timer_cb, timer->timer_cookie->ci_name);
+
+        if (timer_in_callback_stopped) {
+          /* stopped by its own callback, the memory is ours to free now */
+          olsr_cookie_free(timer_mem_cookie, timer);
+        }
         /* Only act on actually running timers */
-        if (timer->timer_flags & OLSR_TIMER_RUNNING) {
+        else if (timer->timer_flags & OLSR_TIMER_RUNNING) {
           /*
            * Don't restart the periodic timer if the callback function has
            * stopped the timer.
@@ -642,6 +671,9 @@ walk_timers(uint32_t * last_run)
     wheel_slot_walks++;
   }
 
+  OLSR_METRIC_ADD(METRIC_TIMERS_WALKED, total_timers_walked);
+  OLSR_METRIC_ADD(METRIC_TIMERS_FIRED, total_timers_fired);
+
   OLSR_PRINTF(7, "TIMER: processed %4u/%d clockwheel slots, "
              "timers walked %4u/%u, timers fired %u\n",
              wheel_slot_walks, TIMER_WHEEL_SLOTS, total_timers_walked, timer_mem_cookie->ci_usage, total_timers_fired);
@@ -833,6 +865,11 @@ olsr_stop_timer(struct timer_entry *timer)
   timer->timer_flags &= ~OLSR_TIMER_RUNNING;
   olsr_cookie_usage_decr(timer->timer_cookie->ci_id);
 
+  if (timer == timer_in_callback) {
+    /* walk_timers() still looks at the timer after the callback returns */
+    timer_in_callback_stopped = true;
+    return;
+  }
   olsr_cookie_free(timer_mem_cookie, timer);
 }
 
@@ -882,7 +919,7 @@ olsr_set_timer(struct timer_entry **timer_ptr,
                unsigned int rel_time,
                uint8_t jitter_pct, bool periodical, timer_cb_func cb_func, void *context, struct olsr_cookie_info *cookie)
 {
-  if (cookie) {
+  if (!cookie) {
     cookie = def_timer_ci;
   }
 
@@ -52,6 +52,7 @@
 #include "net_olsr.h"
 #include "lq_plugin.h"
 #include "olsr_cookie.h"
+#include "olsr_trace.h"
 #include "duplicate_set.h"
 #include "gateway.h"
 
@@ -61,6 +62,20 @@
 struct avl_tree tc_tree;
 struct tc_entry *tc_myself;            /* Shortcut to ourselves */
 
+/* Memory budget of the lsdb, 0 means no limit */
+static unsigned int tc_vertex_budget = 0;
+static unsigned int tc_edge_budget = 0;
+static uint8_t tc_hop_limit = OLSR_TC_PRESSURE_HOP_LIMIT;
+
+/* Vertices in the order of their last refresh, oldest first */
+static struct list_node tc_lru_list;
+
+/* Sink for the lq data of refused edges */
+static struct tc_edge_entry *tc_edge_scratch;
+
+struct tc_pressure_stats tc_pressure;
+struct tc_digest_stats tc_digest;
+
 /* Some cookies for stats keeping */
 struct olsr_cookie_info *tc_edge_gc_timer_cookie = NULL;
 struct olsr_cookie_info *tc_validity_timer_cookie = NULL;
@@ -91,6 +106,96 @@ struct olsr_cookie_info *tc_mem_cookie = NULL;
 /* Enlarges the value window for upcoming ansn/seqno to be accepted */
 #define TC_SEQNO_WINDOW_MULT 8
 
+/**
+ * Set the memory budget of the lsdb.
+ * Must be called before olsr_init_tc().
+ *
+ * @param vertices maximum number of tc entries, 0 for no limit
+ * @param edges maximum number of tc edges, 0 for no limit
+ */
+void
+olsr_tc_set_budget(unsigned int vertices, unsigned int edges)
+{
+  tc_vertex_budget = vertices;
+  tc_edge_budget = edges;
+}
+
+/**
+ * Set the distance beyond which nothing new is learned under pressure.
+ *
+ * @param hop_limit the hop limit
+ */
+void
+olsr_tc_set_hop_limit(uint8_t hop_limit)
+{
+  tc_hop_limit = hop_limit;
+}
+
+/**
+ * Check if the lsdb is running out of its memory budget.
+ *
+ * @return true if no new lsdb entries from far away should be accepted
+ */
+bool
+olsr_tc_under_pressure(void)
+{
+  return olsr_cookie_under_pressure(tc_mem_cookie) || olsr_cookie_under_pressure(tc_edge_mem_cookie);
+}
+
+/*
+ * Evict the least recently refreshed vertex to make room.
+ * Ourselves and the vertex being processed are never evicted.
+ *
+ * @param keep the tc_entry to spare
+ * @return true if a vertex has been evicted
+ */
+static bool
+olsr_evict_tc_entry(struct tc_entry *keep)
+{
+  struct list_node *node;
+
+  for (node = tc_lru_list.next; node != &tc_lru_list; node = node->next) {
+    struct tc_entry *tc = lru2tc(node);
+
+    if (tc != keep && tc != tc_myself) {
+#ifndef NODEBUG
+      struct ipaddr_str buf;
+#endif
+      OLSR_TRACE_PRINTF(1, TRACE_TC_EVICT, &tc->addr, NULL, 0, 0, "TC: memory pressure, evicting %s\n",
+                        olsr_ip_to_string(&buf, &tc->addr));
+
+      olsr_delete_tc_entry(tc);
+      tc_pressure.evicted_vertices++;
+      changes_topology = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Allocate lsdb memory within the budget.
+ * Evicts up to OLSR_TC_EVICT_MAX of the least recently refreshed
+ * vertices if the budget is exhausted.
+ *
+ * @param ci the cookie to allocate from
+ * @param keep the tc_entry to spare from eviction
+ * @return the memory block or NULL
+ */
+static void *
+olsr_tc_malloc(struct olsr_cookie_info *ci, struct tc_entry *keep)
+{
+  void *ptr;
+  int evictions = 0;
+
+  while (!(ptr = olsr_cookie_try_malloc(ci))) {
+    if (evictions++ == OLSR_TC_EVICT_MAX || !olsr_evict_tc_entry(keep)) {
+      return NULL;
+    }
+  }
+  return ptr;
+}
+
 static bool
 olsr_seq_inrange_low(int beg, int end, uint16_t seq)
 {
@@ -149,9 +254,18 @@ olsr_add_tc_entry(union olsr_ip_addr *adr)
   OLSR_PRINTF(1, "TC: add entry %s\n", olsr_ip_to_string(&buf, adr));
 #endif
 
-  tc = olsr_cookie_malloc(tc_mem_cookie);
-  if (!tc) {
-    return NULL;
+  /*
+   * Our own entry is not subject to the budget.
+   */
+  if (ipequal(&olsr_cnf->main_addr, adr)) {
+    tc = olsr_cookie_malloc(tc_mem_cookie);
+  } else {
+    tc = olsr_tc_malloc(tc_mem_cookie, NULL);
+    if (!tc) {
+      tc_pressure.refused_vertices++;
+      return NULL;
+    }
+    list_add_before(&tc_lru_list, &tc->lru_node);
   }
 
   /* Fill entry */
@@ -188,6 +302,7 @@ olsr_init_tc(void)
   OLSR_PRINTF(5, "TC: init topo\n");
 
   avl_init(&tc_tree, avl_comp_default);//avl _init()ʼһavl
+  list_head_init(&tc_lru_list);
 
   /*
    * Get some cookies for getting stats to ease troubleshooting.
@@ -202,6 +317,11 @@ olsr_init_tc(void)
   olsr_cookie_set_memory_size(tc_mem_cookie, sizeof(struct tc_entry));//˱ϵĳʼ cookieлȡӦֵΪ˱
 //ϵԸֵ
 
+  olsr_cookie_set_budget(tc_mem_cookie, tc_vertex_budget);
+  olsr_cookie_set_budget(tc_edge_mem_cookie, tc_edge_budget);
+
+  tc_edge_scratch = olsr_malloc(sizeof(struct tc_edge_entry) + active_lq_handler->tc_lq_size, "TC edge scratch");
+
 
   /*
    * Add a TC entry for ourselves.
@@ -318,6 +438,9 @@ olsr_delete_tc_entry(struct tc_entry *tc)
 
   avl_delete(&tc_tree, &tc->vertex_node);//ֹͣӦĶʱtimersΪգ֤ݺ
 //ĳɾ
+  if (list_node_on_list(&tc->lru_node)) {
+    list_remove(&tc->lru_node);
+  }
 
   olsr_unlock_tc_entry(tc);//avlɾӦĽڵ㣬tc   _entryֵ1
 }
@@ -387,7 +510,8 @@ olsr_expire_tc_entry(void *context)
 
   tc = (struct tc_entry *)context;
 
-  OLSR_PRINTF(3, "TC: expire node entry %s\n", olsr_ip_to_string(&buf, &tc->addr));
+  OLSR_TRACE_PRINTF(3, TRACE_TC_EXPIRE, &tc->addr, NULL, 0, 0, "TC: expire node entry %s\n",
+                    olsr_ip_to_string(&buf, &tc->addr));
 
   tc->validity_timer = NULL;
 
@@ -408,7 +532,8 @@ olsr_expire_tc_edge_gc(void *context)
 
   tc = (struct tc_entry *)context;
 
-  OLSR_PRINTF(3, "TC: expire edge entry %s\n", olsr_ip_to_string(&buf, &tc->addr));
+  OLSR_TRACE_PRINTF(3, TRACE_TC_EDGE_EXPIRE, &tc->addr, NULL, 0, 0, "TC: expire edge entry %s\n",
+                    olsr_ip_to_string(&buf, &tc->addr));
 
   tc->edge_gc_timer = NULL;
 
@@ -456,9 +581,17 @@ olsr_add_tc_edge_entry(struct tc_entry *tc, union olsr_ip_addr *addr, uint16_t a
   struct tc_entry *tc_neighbor;
   struct tc_edge_entry *tc_edge, *tc_edge_inv;
 
-  tc_edge = olsr_cookie_malloc(tc_edge_mem_cookie);
-  if (!tc_edge) {
-    return NULL;
+  /*
+   * Our own edges are not subject to the budget.
+   */
+  if (tc == tc_myself) {
+    tc_edge = olsr_cookie_malloc(tc_edge_mem_cookie);
+  } else {
+    tc_edge = olsr_tc_malloc(tc_edge_mem_cookie, tc);
+    if (!tc_edge) {
+      tc_pressure.refused_edges++;
+      return NULL;
+    }
   }
 
   /* Fill entry */
@@ -532,6 +665,9 @@ olsr_delete_tc_edge_entry(struct tc_edge_entry *tc_edge)
 
   tc = tc_edge->tc;
   avl_delete(&tc->edge_tree, &tc_edge->edge_node);
+
+  /* the edges no longer reflect the last tc body */
+  tc->body_digest_valid = false;
   olsr_unlock_tc_entry(tc);
 
   /*
@@ -629,7 +765,8 @@ olsr_delete_revoked_tc_edges(struct tc_entry *tc, uint16_t ansn, union olsr_ip_a
  * @return 1 if entries are added 0 if not
  */
 static int
-olsr_tc_update_edge(struct tc_entry *tc, uint16_t ansn, const unsigned char **curr, union olsr_ip_addr *neighbor)
+olsr_tc_update_edge(struct tc_entry *tc, uint16_t ansn, const unsigned char **curr, union olsr_ip_addr *neighbor,
+                    bool refuse_new)
 {
   struct tc_edge_entry *tc_edge;
   int edge_change;
@@ -654,7 +791,19 @@ olsr_tc_update_edge(struct tc_entry *tc, uint16_t ansn, const unsigned char **cu
       return 0;
     }
 
-    tc_edge = olsr_add_tc_edge_entry(tc, neighbor, ansn);
+    if (refuse_new) {
+      tc_pressure.refused_edges++;
+    } else {
+      tc_edge = olsr_add_tc_edge_entry(tc, neighbor, ansn);
+    }
+
+    /*
+     * Skip the lq data of refused edges.
+     */
+    if (!tc_edge) {
+      olsr_deserialize_tc_lq_pair(curr, tc_edge_scratch);
+      return 0;
+    }
 
     olsr_deserialize_tc_lq_pair(curr, tc_edge);
     edge_change = 1;
@@ -737,6 +886,14 @@ olsr_print_tc_table(void)
 
     } OLSR_FOR_ALL_TC_EDGE_ENTRIES_END(tc, tc_edge);
   } OLSR_FOR_ALL_TC_ENTRIES_END(tc);
+
+  if (tc_vertex_budget || tc_edge_budget || tc_pressure.refused_vertices || tc_pressure.refused_edges) {
+    OLSR_PRINTF(1, "\nMemory pressure: %s, refused %u vertices %u edges, evicted %u vertices\n",
+                olsr_tc_under_pressure() ? "yes" : "no", tc_pressure.refused_vertices, tc_pressure.refused_edges,
+                tc_pressure.evicted_vertices);
+  }
+  OLSR_PRINTF(1, "\nTC bodies unchanged: %u, walked: %u, edge updates skipped: %u\n", tc_digest.skipped_walks,
+              tc_digest.full_walks, tc_digest.skipped_edges);
 #endif
 }
 
@@ -805,7 +962,9 @@ olsr_input_tc(union olsr_message * msg, struct interface * input_if __attribute_
   union olsr_ip_addr originator;
   const unsigned char *limit, *curr;
   struct tc_entry *tc;
-  bool emptyTC;
+  bool emptyTC, refuse_new, unchanged;
+  uint32_t digest, refused_edges;
+  uint16_t body_len;
 
   union olsr_ip_addr lower_border_ip, upper_border_ip;
   int borderSet = 0;
@@ -831,7 +990,8 @@ olsr_input_tc(union olsr_message * msg, struct interface * input_if __attribute_
 //ǶԳһھӣôðᱻ
 
   if (check_neighbor_link(from_addr) != SYM_LINK) {
-    OLSR_PRINTF(2, "Received TC from NON SYM neighbor %s\n", olsr_ip_to_string(&buf, from_addr));
+    OLSR_TRACE_PRINTF(2, TRACE_TC_NONSYM, from_addr, NULL, 0, 0, "Received TC from NON SYM neighbor %s\n",
+                      olsr_ip_to_string(&buf, from_addr));
     return false;
   }//һյTCϢϢͷVtimeֶμ"Ч
 //ʱ" 
@@ -852,6 +1012,9 @@ olsr_input_tc(union olsr_message * msg, struct interface * input_if __attribute_
   pkt_get_u8(&curr, &lower_border);
   pkt_get_u8(&curr, &upper_border);
 
+  limit = (unsigned char *)msg + size;
+  body_len = limit > curr ? limit - curr : 0;
+
   tc = olsr_lookup_tc_entry(&originator);
 
   if (vtime < (olsr_reltime)(olsr_cnf->min_tc_vtime*1000)) {
@@ -871,7 +1034,8 @@ olsr_input_tc(union olsr_message * msg, struct interface * input_if __attribute_
 //С32ϢѾӦúӡ
 
 
-      OLSR_PRINTF(1, "Ignored to much LQTC's for %s, restarting\n", olsr_ip_to_string(&buf, &originator));
+      OLSR_TRACE_PRINTF(1, TRACE_TC_IGNORED, &originator, NULL, 0, 0, "Ignored to much LQTC's for %s, restarting\n",
+                        olsr_ip_to_string(&buf, &originator));
 
     } else if (!olsr_seq_inrange_high(tc->msg_seq, (int)tc->msg_seq + TC_SEQNO_WINDOW * TC_SEQNO_WINDOW_MULT, msg_seq)
                || !olsr_seq_inrange_low(tc->ansn, (int)tc->ansn + TC_ANSN_WINDOW * TC_ANSN_WINDOW_MULT, ansn)) {
@@ -888,20 +1052,47 @@ olsr_input_tc(union olsr_message * msg, struct interface * input_if __attribute_
         return false;
       }
 
-      OLSR_PRINTF(2, "Detected node restart for %s\n", olsr_ip_to_string(&buf, &originator));
+      OLSR_TRACE_PRINTF(2, TRACE_TC_RESTART, &originator, NULL, 0, 0, "Detected node restart for %s\n",
+                        olsr_ip_to_string(&buf, &originator));
     }
   }
 
   /*
    * Generate a new tc_entry in the lsdb and store the sequence number.
    */
+  /*
+   * Under memory pressure do not learn anything new from far away.
+   */
+  refuse_new = msg_hops >= tc_hop_limit && olsr_tc_under_pressure();
+
   if (!tc) {
+    if (refuse_new) {
+      tc_pressure.refused_vertices++;
+      return true;
+    }
     tc = olsr_add_tc_entry(&originator);
+    if (!tc) {
+      return true;
+    }
+  } else if (list_node_on_list(&tc->lru_node)) {
+
+    /*
+     * Mark the entry as the most recently refreshed.
+     */
+    list_remove(&tc->lru_node);
+    list_add_before(&tc_lru_list, &tc->lru_node);
   }
 //˱вںTCϢ'Ϣַ'ֶͬ
 //ĿµĿұкţ֮֮ȡTCϢݰ
 //ͷϢtc _entry
 
+  /*
+   * A body (borders and edges) identical to the last one under the
+   * same ANSN would leave all edges as they are.
+   */
+  digest = olsr_buf_hash(curr - 2, body_len + 2);
+  unchanged = tc->body_digest_valid && tc->ansn == ansn && tc->body_digest == digest && tc->body_len == body_len;
+
   /*
    * Update the tc entry.
    */
@@ -911,17 +1102,28 @@ olsr_input_tc(union olsr_message * msg, struct interface * input_if __attribute_
   tc->ignored = 0;
   tc->err_seq_valid = false;
 
-  OLSR_PRINTF(1, "Processing TC from %s, seq 0x%04x\n", olsr_ip_to_string(&buf, &originator), tc->msg_seq);
+  OLSR_TRACE_PRINTF(1, TRACE_TC_INPUT, &originator, from_addr, tc->msg_seq, tc->ansn, "Processing TC from %s, seq 0x%04x\n",
+                    olsr_ip_to_string(&buf, &originator), tc->msg_seq);
+
+  if (unchanged) {
+    tc_digest.skipped_walks++;
+    tc_digest.skipped_edges += tc->edge_tree.count;
+
+    olsr_set_timer(&tc->validity_timer, vtime, OLSR_TC_VTIME_JITTER, OLSR_TIMER_ONESHOT, &olsr_expire_tc_entry, tc,
+                   tc_validity_timer_cookie);
+    return true;
+  }
+  tc_digest.full_walks++;
+  refused_edges = tc_pressure.refused_edges;
 
   /*
    * Now walk the edge advertisements contained in the packet.
    */
 
-  limit = (unsigned char *)msg + size;
   borderSet = 0;
   emptyTC = curr >= limit;
   while (curr < limit) {
-    if (olsr_tc_update_edge(tc, ansn, &curr, &upper_border_ip)) {
+    if (olsr_tc_update_edge(tc, ansn, &curr, &upper_border_ip, refuse_new)) {
       changes_topology = true;
     }
 
@@ -971,6 +1173,14 @@ olsr_input_tc(union olsr_message * msg, struct interface * input_if __attribute_
                    tc, tc_edge_gc_timer_cookie);
   }
 
+  /*
+   * Remember the body, unless edges were refused which a later
+   * copy of it may still bring in.
+   */
+  tc->body_digest = digest;
+  tc->body_len = body_len;
+  tc->body_digest_valid = refused_edges == tc_pressure.refused_edges;
+
   if (emptyTC && borderSet) {
     /* cleanup MIDs and HNAs if all edges have been erased by
      * an empty TC, then alert the duplicate set and kill the
@@ -88,6 +88,10 @@ struct tc_entry {
                                           (kindof emergency brake) */
   uint16_t err_seq;                    /* sequence number of an unplausible TC */
   bool err_seq_valid;                  /* do we have an error (unplauible seq/ansn) */
+  struct list_node lru_node;           /* refresh order, least recently refreshed first */
+  uint32_t body_digest;                /* hash of the last fully processed tc body */
+  uint16_t body_len;                   /* length of that body */
+  bool body_digest_valid;              /* edges still match body_digest */
 };
 
 /*
@@ -99,9 +103,40 @@ struct tc_entry {
 
 #define OLSR_TC_VTIME_JITTER 5          /* percent */
 
+/*
+ * Under memory pressure no new vertices and edges are accepted
+ * from originators further away than this.
+ */
+#define OLSR_TC_PRESSURE_HOP_LIMIT 8
+
+/*
+ * Vertices one allocation may evict. Other cookies share the global
+ * budget, evicting the lsdb cannot always make room for it.
+ */
+#define OLSR_TC_EVICT_MAX 4
+
+/*
+ * Memory pressure handling of the lsdb.
+ */
+struct tc_pressure_stats {
+  uint32_t refused_vertices;           /* new vertices refused */
+  uint32_t refused_edges;              /* new edges refused */
+  uint32_t evicted_vertices;           /* vertices evicted to make room */
+};
+
+/*
+ * Edge walks saved by the tc body digest.
+ */
+struct tc_digest_stats {
+  uint32_t skipped_walks;              /* tc messages with an unchanged body */
+  uint32_t full_walks;                 /* tc messages whose edges were walked */
+  uint32_t skipped_edges;              /* edge updates saved by skipped walks */
+};
+
 AVLNODE2STRUCT(vertex_tree2tc, struct tc_entry, vertex_node);
 AVLNODE2STRUCT(cand_tree2tc, struct tc_entry, cand_tree_node);
 LISTNODE2STRUCT(pathlist2tc, struct tc_entry, path_list_node);
+LISTNODE2STRUCT(lru2tc, struct tc_entry, lru_node);
 
 /*
  * macros for traversing vertices, edges and prefixes in the link state database.
@@ -140,12 +175,17 @@ LISTNODE2STRUCT(pathlist2tc, struct tc_entry, path_list_node);
 
 extern struct avl_tree tc_tree;
 extern struct tc_entry *tc_myself;
+extern struct tc_pressure_stats tc_pressure;
+extern struct tc_digest_stats tc_digest;
 
 void olsr_init_tc(void);
 void olsr_delete_all_tc_entries(void);
 void olsr_change_myself_tc(void);
 void olsr_print_tc_table(void);
 void olsr_time_out_tc_set(void);
+void olsr_tc_set_budget(unsigned int, unsigned int);
+void olsr_tc_set_hop_limit(uint8_t);
+bool olsr_tc_under_pressure(void);
 
 /* tc msg input parser */
 bool olsr_input_tc(union olsr_message *, struct interface *, union olsr_ip_addr *from);
@@ -46,9 +46,14 @@
 #include "neighbor_table.h"
 #include "net_olsr.h"
 #include "scheduler.h"
+#include "mpr.h"
+#include "lq_mpr.h"
 
 struct neighbor_2_entry two_hop_neighbortable[HASHSIZE];
 
+struct olsr_cookie_info *nbr2_mem_cookie = NULL;
+struct olsr_cookie_info *nbr_list_mem_cookie = NULL;
+
 /**
  *Initialize 2 hop neighbor table
  */
@@ -60,6 +65,12 @@ olsr_init_two_hop_table(void)
     two_hop_neighbortable[idx].next = &two_hop_neighbortable[idx];
     two_hop_neighbortable[idx].prev = &two_hop_neighbortable[idx];
   }
+
+  nbr2_mem_cookie = olsr_alloc_cookie("neighbor_2_entry", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(nbr2_mem_cookie, sizeof(struct neighbor_2_entry));
+
+  nbr_list_mem_cookie = olsr_alloc_cookie("neighbor_list_entry", OLSR_COOKIE_TYPE_MEMORY);
+  olsr_cookie_set_memory_size(nbr_list_mem_cookie, sizeof(struct neighbor_list_entry));
 }
 
 /**
@@ -85,7 +96,8 @@ olsr_delete_neighbor_pointer(struct neighbor_2_entry *two_hop_entry, struct neig
       /* dequeue */
       DEQUEUE_ELEM(entry_to_delete);
 
-      free(entry_to_delete);
+      olsr_lq_mpr_release(entry_to_delete);
+      olsr_cookie_free(nbr_list_mem_cookie, entry_to_delete);
     } else {
       entry = entry->next;
     }
@@ -114,12 +126,14 @@ olsr_delete_two_hop_neighbor_table(struct neighbor_2_entry *two_hop_neighbor)
     olsr_delete_neighbor_2_pointer(one_hop_entry, two_hop_neighbor);
     one_hop_list = one_hop_list->next;
     /* no need to dequeue */
-    free(entry_to_delete);
+    olsr_lq_mpr_release(entry_to_delete);
+    olsr_cookie_free(nbr_list_mem_cookie, entry_to_delete);
   }
 
   /* dequeue */
+  olsr_mpr_forget_2hop(two_hop_neighbor);
   DEQUEUE_ELEM(two_hop_neighbor);
-  free(two_hop_neighbor);
+  olsr_cookie_free(nbr2_mem_cookie, two_hop_neighbor);
 }
 
 /**
@@ -45,6 +45,8 @@
 #include "defs.h"
 #include "hashing.h"
 #include "lq_plugin.h"
+#include "olsr_cookie.h"
+#include "common/list.h"
 
 #define	NB2S_COVERED 	0x1     /* node has been covered by a MPR */
 
@@ -53,6 +55,7 @@ struct neighbor_list_entry {
   olsr_linkcost second_hop_linkcost;
   olsr_linkcost path_linkcost;
   olsr_linkcost saved_path_linkcost;
+  bool mpr_selected;                   /* selected as MPR for this 2 hop neighbor (LQ) */
   struct neighbor_list_entry *next;
   struct neighbor_list_entry *prev;
 };
@@ -60,14 +63,19 @@ struct neighbor_list_entry {
 struct neighbor_2_entry {
   union olsr_ip_addr neighbor_2_addr;
   uint8_t mpr_covered_count;           /*used in mpr calculation */
-  uint8_t processed;                   /*used in mpr calculation */
+  int mpr_id;                          /*used in mpr calculation */
   int16_t neighbor_2_pointer;          /* Neighbor count */
   struct neighbor_list_entry neighbor_2_nblist;
+  struct list_node mpr_dirty_node;     /* queued for incremental MPR update */
   struct neighbor_2_entry *prev;
   struct neighbor_2_entry *next;
 };
 
+LISTNODE2STRUCT(dirty2nbr2, struct neighbor_2_entry, mpr_dirty_node);
+
 extern struct neighbor_2_entry two_hop_neighbortable[HASHSIZE];
+extern struct olsr_cookie_info *nbr2_mem_cookie;
+extern struct olsr_cookie_info *nbr_list_mem_cookie;
 
 void olsr_init_two_hop_table(void);
 